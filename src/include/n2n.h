@@ -164,7 +164,9 @@ namespace N2N
 		/** There are not enough resources to complete the task. */
 		InsufficientResources = 6,
 		/** Vendor-defined error. */
-		Vendor = 7
+		Vendor = 7,
+		/** Optional method not implemented. */
+		NotImplemented = 8
 	};
 
 	/** Output stream operator for a StatusCode object. */
@@ -190,6 +192,8 @@ namespace N2N
 			return (s << "Insufficient resources");
 		case StatusCode::Vendor:
 			return (s << "Vendor-defined");
+		case StatusCode::NotImplemented:
+			return (s << "Not implemented");
 		}
 	}
 
@@ -255,6 +259,93 @@ namespace N2N
 		Latent
 	};
 
+	/**
+	 * @brief
+	 * Running similarity thresholds of searches, shared by all nodes.
+	 * @details
+	 * Every node searches its own partition of the enrollment set for
+	 * the same search IDs. Once a node has found `candidateListLength`
+	 * candidates for a search, no candidate with a lower similarity than
+	 * the lowest of those can place in the final candidate list. Nodes
+	 * publish that similarity here so that other nodes can skip work
+	 * and write less stage one data.
+	 *
+	 * @note
+	 * Thresholds are advisory. They may be read before another node
+	 * raises them, and are never available for some searches.
+	 */
+	class SearchThresholds
+	{
+	public:
+		/**
+		 * @brief
+		 * Obtain the running threshold of a search.
+		 *
+		 * @param[in] searchID
+		 * The ID of the search template.
+		 *
+		 * @return
+		 * Highest similarity published for `searchID` by any node,
+		 * or std::numeric_limits<double>::lowest() if none.
+		 */
+		virtual double
+		getThreshold(
+		    const std::string &searchID)
+		    const = 0;
+
+		/**
+		 * @brief
+		 * Publish the lowest similarity of a node's best candidates.
+		 *
+		 * @param[in] searchID
+		 * The ID of the search template.
+		 * @param[in] similarity
+		 * Lowest similarity of the `candidateListLength` most similar
+		 * candidates found for `searchID`. The threshold is only
+		 * changed if this is higher.
+		 */
+		virtual void
+		raiseThreshold(
+		    const std::string &searchID,
+		    const double similarity) = 0;
+
+		/** Destructor. */
+		virtual ~SearchThresholds() = default;
+	};
+
+	/**
+	 * @brief
+	 * Files written on behalf of the implementation.
+	 * @details
+	 * Provided by the testing application so that stage one data can
+	 * be written while searching continues, instead of blocking the
+	 * search on each file created.
+	 */
+	class AsyncWriter
+	{
+	public:
+		/**
+		 * @brief
+		 * Queue a file to be written.
+		 *
+		 * @param[in] path
+		 * Path of the file to create, or replace.
+		 * @param[in] data
+		 * Entire contents of the file. The writer takes ownership.
+		 *
+		 * @note
+		 * Returns before the file is written. Failures are handled by
+		 * the testing application.
+		 */
+		virtual void
+		write(
+		    const std::string &path,
+		    BiometricEvaluation::Memory::uint8Array &&data) = 0;
+
+		/** Destructor. */
+		virtual ~AsyncWriter() = default;
+	};
+
 	class Interface;
 	/**
 	 * @brief
@@ -447,6 +538,113 @@ namespace N2N
 		    BiometricEvaluation::IO::RecordStore
 		    &enrollmentTemplates) = 0;
 
+		/**
+		 * @brief
+		 * Add enrollment templates to a finalized enrollment set.
+		 * @details
+		 * Templates added are searched by every subsequent call to
+		 * identifyTemplateStageOne() and identifyTemplateStageTwo(),
+		 * exactly as if they had been provided to
+		 * finalizeEnrollment(). The time taken should be proportional
+		 * to the number of templates added, not to the size of the
+		 * enrollment set.
+		 *
+		 * @param[in] configurationDirectory
+		 * A read-only directory containing vendor-supplied
+		 * configuration parameters or run-time data files.
+		 * @param[in] enrollmentDirectory
+		 * The top-level directory populated by finalizeEnrollment()
+		 * and any previous calls to this method. Access permission
+		 * will be read-write until this method returns.
+		 * @param[in] nodeMemory
+		 * Amount of memory available to this process on each node, in
+		 * kibibytes. The number of nodes is the number passed to
+		 * the successful call to finalizeEnrollment().
+		 * @param[in] enrollmentTemplates
+		 * A read-only RecordStore of enrollment templates, as returned
+		 * by makeEnrollmentTemplate(). No key is already enrolled.
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 * StatusCode::InsufficientResources should be returned if
+		 * the enrollment set would no longer fit in `nodeMemory`.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * There was an error processing this request, and the
+		 * exception string may contain additional information.
+		 *
+		 * @note
+		 * This method is optional. The default implementation returns
+		 * StatusCode::NotImplemented, and the enrollment set must be
+		 * finalized again from scratch.
+		 * @note
+		 * This method must return within 90 minutes per 1-million
+		 * templates added.
+		 * @note
+		 * Reasonable multithreading is permitted. This method may be
+		 * called any number of times.
+		 */
+		virtual ReturnStatus
+		addToEnrollment(
+		    const std::string &configurationDirectory,
+		    const std::string &enrollmentDirectory,
+		    const uint64_t nodeMemory,
+		    BiometricEvaluation::IO::RecordStore &enrollmentTemplates)
+		{
+			static_cast<void>(configurationDirectory);
+			static_cast<void>(enrollmentDirectory);
+			static_cast<void>(nodeMemory);
+			static_cast<void>(enrollmentTemplates);
+			return (ReturnStatus{StatusCode::NotImplemented, ""});
+		}
+
+		/**
+		 * @brief
+		 * Remove enrollment templates from a finalized enrollment set.
+		 * @details
+		 * Templates removed must never again be returned as candidates,
+		 * including from stage one data written before this method was
+		 * called. Templates that remain should not need to be
+		 * processed again.
+		 *
+		 * @param[in] configurationDirectory
+		 * A read-only directory containing vendor-supplied
+		 * configuration parameters or run-time data files.
+		 * @param[in] enrollmentDirectory
+		 * The top-level directory populated by finalizeEnrollment()
+		 * and any calls to addToEnrollment(). Access permission will
+		 * be read-write until this method returns.
+		 * @param[in] templateIDs
+		 * Keys of enrollment templates to remove. IDs not enrolled
+		 * are ignored.
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * There was an error processing this request, and the
+		 * exception string may contain additional information.
+		 *
+		 * @note
+		 * This method is optional. The default implementation returns
+		 * StatusCode::NotImplemented, and the enrollment set must be
+		 * finalized again from scratch.
+		 * @note
+		 * Reasonable multithreading is permitted. This method may be
+		 * called any number of times.
+		 */
+		virtual ReturnStatus
+		removeFromEnrollment(
+		    const std::string &configurationDirectory,
+		    const std::string &enrollmentDirectory,
+		    const std::vector<std::string> &templateIDs)
+		{
+			static_cast<void>(configurationDirectory);
+			static_cast<void>(enrollmentDirectory);
+			static_cast<void>(templateIDs);
+			return (ReturnStatus{StatusCode::NotImplemented, ""});
+		}
+
 		/**
 		 * @brief
 		 * Prepare for calls to makeSearchTemplate().
@@ -577,6 +775,102 @@ namespace N2N
 		    const InputType &inputType,
 		    const uint8_t nodeNumber) = 0;
 
+		/**
+		 * @brief
+		 * Provide the number of threads each search may use.
+		 * @details
+		 * Called after initIdentificationStageOne(), before the
+		 * testing application fork()s search processes. When this
+		 * method is not called, searches are single-threaded.
+		 *
+		 * @param[in] threadsPerProcess
+		 * Number of threads, [1,65535], that each call to
+		 * identifyTemplateStageOne() or identifyTemplatesStageOne()
+		 * may use, including the calling thread. The testing
+		 * application chooses this so that the number of search
+		 * processes on a node times `threadsPerProcess` does not
+		 * exceed the node's processors.
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 *
+		 * @note
+		 * This method is optional. The default implementation ignores
+		 * `threadsPerProcess`, and searches remain single-threaded.
+		 */
+		virtual ReturnStatus
+		setThreadsPerProcess(
+		    const uint16_t threadsPerProcess)
+		{
+			static_cast<void>(threadsPerProcess);
+			return (ReturnStatus{});
+		}
+
+		/**
+		 * @brief
+		 * Provide running thresholds shared with all other nodes.
+		 * @details
+		 * Called after initIdentificationStageOne(), before the
+		 * testing application fork()s search processes. When this
+		 * method is not called, no thresholds are shared.
+		 *
+		 * @param[in] thresholds
+		 * Thresholds shared by every node and search process. Valid
+		 * until the final call to identifyTemplateStageOne().
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 *
+		 * @note
+		 * This method is optional. The default implementation ignores
+		 * `thresholds`.
+		 * @note
+		 * Output of identifyTemplateStageOne() may then depend on the
+		 * order in which nodes search, but candidates that could
+		 * place in the final candidate list must not be pruned.
+		 */
+		virtual ReturnStatus
+		setSearchThresholds(
+		    const std::shared_ptr<SearchThresholds> &thresholds)
+		{
+			static_cast<void>(thresholds);
+			return (ReturnStatus{});
+		}
+
+		/**
+		 * @brief
+		 * Provide a writer for stage one data.
+		 * @details
+		 * Called in each search process after initWorker(), before
+		 * the first call to identifyTemplateStageOne(). When this
+		 * method is not called, no writer is available.
+		 *
+		 * @param[in] writer
+		 * Writer of files within stageOneDataDirectory. Files queued
+		 * during a call to identifyTemplateStageOne() are written
+		 * before the testing application examines its
+		 * stageOneDataDirectory, and are durable before stage two
+		 * begins.
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 *
+		 * @note
+		 * This method is optional. The default implementation ignores
+		 * `writer`.
+		 * @note
+		 * Writers are run by the testing application and do not count
+		 * against the multithreading restrictions of
+		 * identifyTemplateStageOne().
+		 */
+		virtual ReturnStatus
+		setAsyncWriter(
+		    const std::shared_ptr<AsyncWriter> &writer)
+		{
+			static_cast<void>(writer);
+			return (ReturnStatus{});
+		}
+
 		/**
 		 * @brief
 		 * Search a template against the partial enrollment set.
@@ -613,9 +907,23 @@ namespace N2N
 		 * effects of I/O operations on this time requirement.
 		 *
 		 * @attention
-		 * Multithreading and other multiprocessing techniques are
-		 * absolutely not permitted. The testing application will be
-		 * calling this method from multiple processes on the same node.
+		 * Using more than `threadsPerProcess` (from
+		 * setThreadsPerProcess()) threads, and other
+		 * multiprocessing techniques, is absolutely not permitted.
+		 * The testing application will be calling this method from
+		 * multiple processes on the same node. Threads must finish
+		 * their work on a call before it returns, and must block
+		 * asynchronous signals, which the testing application uses
+		 * to time out calls.
+		 *
+		 * @attention
+		 * A call that times out is abandoned without unwinding its
+		 * stack or returning. Threads working on behalf of a call
+		 * must therefore never reference the calling thread's stack,
+		 * and must leave shared state usable by the next call, which
+		 * may need to wait for them. Starting threads once, in
+		 * initWorker(), and keeping per-call state in the
+		 * implementation object satisfies this.
 		 *
 		 * @attention
 		 * Unique filenames are required for all data written to
@@ -631,6 +939,66 @@ namespace N2N
 		    &searchTemplate,
 		    const std::string &stageOneDataDirectory) = 0;
 
+		/**
+		 * @brief
+		 * Search one partition of the enrollment set for a group of
+		 * related search templates in a single pass.
+		 * @details
+		 * Search templates in a group come from a single source, such
+		 * as several latent lifts from one scene. Each enrolled
+		 * template should be read once and compared to every search
+		 * template in the group. Output is exactly as if
+		 * identifyTemplateStageOne() were called for each search
+		 * template, and identifyTemplateStageTwo() is called for each
+		 * search ID.
+		 *
+		 * @param[in] searchIDs
+		 * The IDs of the search templates.
+		 * @param[in] searchTemplates
+		 * Search templates, as returned from makeSearchTemplate(), in
+		 * the same order as `searchIDs`.
+		 * @param[in] stageOneDataDirectories
+		 * Read-write directories for each search, in the same order
+		 * as `searchIDs`.
+		 *
+		 * @return
+		 * Completion status of the operation, applied to every
+		 * search in the group.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * There was an error processing this request, and the
+		 * exception string may contain additional information.
+		 *
+		 * @note
+		 * This method is optional. The default implementation calls
+		 * identifyTemplateStageOne() for each search template,
+		 * stopping at the first that does not succeed.
+		 * @note
+		 * The time limits of identifyTemplateStageOne() apply to
+		 * each search template in the group.
+		 *
+		 * @attention
+		 * The threading restrictions of identifyTemplateStageOne()
+		 * apply.
+		 */
+		virtual ReturnStatus
+		identifyTemplatesStageOne(
+		    const std::vector<std::string> &searchIDs,
+		    const std::vector<BiometricEvaluation::Memory::uint8Array>
+		    &searchTemplates,
+		    const std::vector<std::string> &stageOneDataDirectories)
+		{
+			for (uint64_t i{0}; i < searchIDs.size(); ++i) {
+				const auto status =
+				    this->identifyTemplateStageOne(
+				    searchIDs[i], searchTemplates[i],
+				    stageOneDataDirectories[i]);
+				if (status.code != StatusCode::Success)
+					return (status);
+			}
+			return (ReturnStatus{});
+		}
+
 		/**
 		 * @brief
 		 * Prepare for calls to identifyTemplateStageTwo().
@@ -666,6 +1034,86 @@ namespace N2N
 		    const std::string &enrollmentDirectory,
 		    const InputType &inputType) = 0;
 
+		/**
+		 * @brief
+		 * Provide the number of candidates requested per search.
+		 * @details
+		 * Called after initIdentificationStageOne() and after
+		 * initIdentificationStageTwo(), before the testing application
+		 * fork()s search processes. When this method is not called,
+		 * 100 candidates are requested.
+		 *
+		 * @param[in] candidateListLength
+		 * Number of candidates, [1,100], that will be requested from
+		 * identifyTemplateStageTwo() for every search. Only the
+		 * candidates of a node that could place within the final
+		 * candidate list need to be retained by
+		 * identifyTemplateStageOne(), so searches may stop considering
+		 * enrolled templates that cannot exceed the lowest retained
+		 * similarity. The same value is provided in both stages.
+		 *
+		 * @return
+		 * Completion status of the operation.
+		 *
+		 * @note
+		 * This method is optional. The default implementation ignores
+		 * `candidateListLength`, which is always safe: stage two
+		 * candidate lists longer than requested are truncated by the
+		 * testing application.
+		 */
+		virtual ReturnStatus
+		setCandidateListLength(
+		    const uint16_t candidateListLength)
+		{
+			static_cast<void>(candidateListLength);
+			return (ReturnStatus{});
+		}
+
+		/**
+		 * @brief
+		 * Prepare a fork()ed process for subsequent calls.
+		 * @details
+		 * After calling initIdentificationStageOne() or
+		 * initIdentificationStageTwo(), the testing application
+		 * fork()s processes to perform searches. This method is called
+		 * once in each of those processes, before the first search.
+		 * Implementations may use it to open per-process resources, or
+		 * to touch data loaded during initialization so that
+		 * copy-on-write pages are in place before searches are timed.
+		 * Data loaded before fork() and only read afterward remains
+		 * shared between processes.
+		 *
+		 * @param[in] processNumber
+		 * Zero-based number of this process on this node.
+		 *
+		 * @return
+		 * Completion status of the operation. Searching does not
+		 * proceed in this process if the code is not
+		 * StatusCode::Success.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * There was an error processing this request, and the
+		 * exception string may contain additional information.
+		 *
+		 * @note
+		 * This method is optional. The default implementation does
+		 * nothing.
+		 * @note
+		 * This method must complete within 5 minutes. Multithreading
+		 * and other multiprocessing techniques are absolutely not
+		 * permitted, except that up to `threadsPerProcess` - 1 (from
+		 * setThreadsPerProcess()) threads may be started for use by
+		 * later searches. Such threads must wait while no search is
+		 * in progress.
+		 */
+		virtual ReturnStatus
+		initWorker(
+		    const uint8_t processNumber)
+		{
+			static_cast<void>(processNumber);
+			return (ReturnStatus{});
+		}
+
 		/**
 		 * @brief
 		 * Produce a candidate list from the results of all calls to
@@ -707,8 +1155,9 @@ namespace N2N
 		 * `candidates` will have `reserve()` called prior to calling
 		 * this method.
 		 * @note
-		 * There shall be [0,100] objects in `candidates` after the
-		 * successful return of this method.
+		 * There shall be [0,candidateListLength] objects (from
+		 * setCandidateListLength(), or 100 if not called) in
+		 * `candidates` after the successful return of this method.
 		 * @note
 		 * `candidates` shall be sorted by descending similarity score
 		 * before returning.
@@ -9,12 +9,28 @@
  * quality, reliability, or any other characteristic.
  */
 #include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
 #include <be_error.h>
+#include <be_io_compressedrecstore.h>
 #include <be_io_propertiesfile.h>
 #include <be_io_recordstore.h>
 #include <be_io_utility.h>
@@ -25,6 +41,1475 @@
 
 namespace BE = BiometricEvaluation;
 
+/** Result of simulated work, so the compiler cannot discard it */
+static volatile uint64_t SimulatedWorkSink{};
+
+/**
+ * @brief
+ * Hash a string (64-bit FNV-1a).
+ *
+ * @param[in] str
+ * String to hash.
+ *
+ * @return
+ * Hash of `str`.
+ */
+static uint64_t
+hashString(
+    const std::string &str)
+{
+	uint64_t hash{UINT64_C(0xCBF29CE484222325)};
+	for (const auto c : str) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= UINT64_C(0x100000001B3);
+	}
+	return (hash);
+}
+
+/**
+ * @brief
+ * Hash the contents of a template (64-bit FNV-1a).
+ *
+ * @param[in] tmpl
+ * Template to hash.
+ *
+ * @return
+ * Hash of `tmpl`.
+ */
+static uint64_t
+hashTemplate(
+    const BE::Memory::uint8Array &tmpl)
+{
+	uint64_t hash{UINT64_C(0xCBF29CE484222325)};
+	for (uint64_t i{0}; i < tmpl.size(); ++i) {
+		hash ^= tmpl[i];
+		hash *= UINT64_C(0x100000001B3);
+	}
+	return (hash);
+}
+
+/**
+ * @brief
+ * Hash a sample of the images of a subject (64-bit FNV-1a).
+ * @details
+ * At most 4096 evenly spaced bytes of each image are hashed, along with
+ * its size and finger position, so the cost stays low for large images.
+ *
+ * @param[in] standardImages
+ * Standard images of the subject.
+ * @param[in] proprietaryImages
+ * Proprietary images of the subject.
+ *
+ * @return
+ * Hash of the sampled images.
+ */
+static uint64_t
+hashImages(
+    const std::vector<N2N::FingerImage> &standardImages,
+    const std::vector<BE::Memory::uint8Array> &proprietaryImages)
+{
+	uint64_t hash{UINT64_C(0xCBF29CE484222325)};
+	const auto add = [&](const uint64_t value) {
+		hash ^= value;
+		hash *= UINT64_C(0x100000001B3);
+	};
+	const auto addSample = [&](const BE::Memory::uint8Array &data) {
+		add(data.size());
+		const uint64_t stride{std::max<uint64_t>(1, data.size() / 4096)};
+		for (uint64_t i{0}; i < data.size(); i += stride)
+			add(data[i]);
+	};
+
+	for (const auto &image : standardImages) {
+		add(static_cast<uint64_t>(image.fgp));
+		if (image.rawImage)
+			addSample(image.rawImage->getRawData());
+	}
+	for (const auto &image : proprietaryImages)
+		addSample(image);
+	return (hash);
+}
+
+/**
+ * @return
+ * CPU time consumed by the calling thread, in microseconds.
+ */
+static uint64_t
+getThreadCPUMicroseconds()
+{
+	struct timespec ts{};
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return (0);
+	return ((static_cast<uint64_t>(ts.tv_sec) * 1000000) +
+	    (ts.tv_nsec / 1000));
+}
+
+/**
+ * @brief
+ * Consume CPU time on the calling thread.
+ *
+ * @param[in] cpuMicroseconds
+ * CPU time to consume.
+ * @param[in] memory
+ * Working memory to write repeatedly, or nullptr.
+ * @param[in] size
+ * Size of `memory`. When 0, arithmetic is performed instead.
+ *
+ * @return
+ * Result of the arithmetic, so it cannot be discarded.
+ */
+static uint64_t
+simulateWork(
+    const uint64_t cpuMicroseconds,
+    uint8_t *memory,
+    const uint64_t size)
+{
+	const uint64_t start{getThreadCPUMicroseconds()};
+	uint8_t value{0};
+	if (size != 0)
+		std::fill(memory, memory + size, ++value);
+
+	/* Touch working memory, otherwise spin on arithmetic */
+	uint64_t state{UINT64_C(0x9E3779B97F4A7C15)};
+	while ((getThreadCPUMicroseconds() - start) < cpuMicroseconds) {
+		if (size != 0) {
+			std::fill(memory, memory + size, ++value);
+		} else {
+			for (uint16_t i{0}; i < 1024; ++i) {
+				state ^= state << 13;
+				state ^= state >> 7;
+				state ^= state << 17;
+			}
+		}
+	}
+
+	return (state);
+}
+
+/**
+ * @brief
+ * Start a thread that receives no asynchronous signals.
+ * @details
+ * The testing application times out calls with signals, which must be
+ * delivered to the thread making the call.
+ *
+ * @param[in] function
+ * Function run by the thread.
+ *
+ * @return
+ * Running thread.
+ */
+static std::thread
+startQuietThread(
+    const std::function<void()> &function)
+{
+	/* New threads inherit the signal mask of the creating thread */
+	sigset_t all{}, previous{};
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	std::thread thread{function};
+	pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+	return (thread);
+}
+
+/** @return Monotonic time, in microseconds */
+static uint64_t
+getMonotonicMicroseconds()
+{
+	struct timespec ts{};
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		return (0);
+	return ((static_cast<uint64_t>(ts.tv_sec) * 1000000) +
+	    (ts.tv_nsec / 1000));
+}
+
+/** Name of enrollment set manifest, in the enrollment directory */
+static const std::string ManifestName{"partitions.conf"};
+/** Name of partition report, in the enrollment directory */
+static const std::string PartitionReportName{"partitions.txt"};
+/** Name of pre-filter report, in the enrollment directory */
+static const std::string PrefilterReportName{"prefilter.txt"};
+/** Suffix of a RecordStore's inverted lists */
+static const std::string PrefilterSuffix{".prefilter"};
+/** Suffix of file holding a RecordStore's FingerSlabs */
+static const std::string FingerSlabsSuffix{".slabs"};
+/** Name of compression report, in the enrollment directory */
+static const std::string CompressionReportName{"compression.txt"};
+/** Name of duplicate template IDs, in the enrollment directory */
+static const std::string AliasesName{"aliases.txt"};
+/** Name of removed IDs whose templates are kept for their duplicates */
+static const std::string HiddenName{"hidden.txt"};
+/** Name of IDs removed from the enrollment set, kept across compaction */
+static const std::string RemovedName{"removed.txt"};
+
+/**
+ * @brief
+ * Create a RecordStore of enrollment templates.
+ *
+ * @param[in] path
+ * Path of RecordStore to create.
+ * @param[in] description
+ * Description of RecordStore.
+ * @param[in] compression
+ * Compressor named by CompressedRecordStore, or empty for none.
+ *
+ * @return
+ * Empty RecordStore. Compressed records are individually compressed, so
+ * any record can be read without decoding the others.
+ *
+ * @throw BE::Error::Exception
+ * Error creating RecordStore.
+ */
+static std::shared_ptr<BE::IO::RecordStore>
+createTemplateStore(
+    const std::string &path,
+    const std::string &description,
+    const std::string &compression)
+{
+	if (compression.empty())
+		return (BE::IO::RecordStore::createRecordStore(path,
+		    description, BE::IO::RecordStore::Kind::Default));
+
+	return (std::make_shared<BE::IO::CompressedRecordStore>(path,
+	    description, BE::IO::RecordStore::Kind::Default, compression));
+}
+
+/**
+ * @brief
+ * Measure compression of RecordStores of enrollment templates.
+ * @details
+ * Every template is read, so decode throughput includes reading from
+ * storage.
+ *
+ * @param[in] enrollmentDirectory
+ * Directory containing all RecordStores.
+ * @param[in] names
+ * Names of RecordStores, one per partition.
+ *
+ * @return
+ * Table with one line per RecordStore and a line for all RecordStores.
+ *
+ * @throw BE::Error::Exception
+ * Error reading a RecordStore.
+ */
+static std::string
+reportCompression(
+    const std::string &enrollmentDirectory,
+    const std::vector<std::string> &names)
+{
+	std::ostringstream out{};
+	out << "Partition Templates RawBytes StoredBytes Ratio DecodeMiBps\n";
+	out << std::fixed << std::setprecision(2);
+
+	const auto line = [&](const std::string &name, const uint64_t count,
+	    const uint64_t raw, const uint64_t stored,
+	    const uint64_t microseconds) {
+		out << name << ' ' << count << ' ' << raw << ' ' << stored <<
+		    ' ' << ((stored == 0) ? 0 : (static_cast<double>(raw) /
+		    stored)) << ' ' << ((microseconds == 0) ? 0 :
+		    ((raw / (1024.0 * 1024.0)) / (microseconds / 1000000.0))) <<
+		    '\n';
+	};
+
+	uint64_t allCount{0}, allRaw{0}, allStored{0}, allTime{0};
+	for (const auto &name : names) {
+		const auto rs = BE::IO::RecordStore::openRecordStore(
+		    enrollmentDirectory + '/' + name, BE::IO::Mode::ReadOnly);
+		uint64_t count{0}, raw{0};
+		const uint64_t start{getMonotonicMicroseconds()};
+		for (;;) {
+			try {
+				raw += rs->sequence().data.size();
+				++count;
+			} catch (BE::Error::ObjectDoesNotExist) {
+				break;
+			}
+		}
+		const uint64_t elapsed{getMonotonicMicroseconds() - start};
+		const uint64_t stored{rs->getSpaceUsed()};
+		line(name, count, raw, stored, elapsed);
+
+		allCount += count;
+		allRaw += raw;
+		allStored += stored;
+		allTime += elapsed;
+	}
+	line("All", allCount, allRaw, allStored, allTime);
+
+	return (out.str());
+}
+
+/**
+ * @brief
+ * Read the deleted templates of a RecordStore.
+ *
+ * @param[in] rsPath
+ * Path to RecordStore.
+ *
+ * @return
+ * Bitmap where bit i (bit i % 8 of byte i / 8) is set when the i-th template
+ * in sequence order is deleted. Empty if no template is deleted.
+ */
+static std::vector<uint8_t>
+readTombstones(
+    const std::string &rsPath)
+{
+	const std::string path{rsPath + ".tombstones"};
+	if (!BE::IO::Utility::fileExists(path))
+		return {};
+
+	const auto bitmap = BE::IO::Utility::readFile(path);
+	return (std::vector<uint8_t>(bitmap.begin(), bitmap.end()));
+}
+
+/**
+ * @brief
+ * Determine if a template is deleted.
+ *
+ * @param[in] tombstones
+ * Bitmap returned from readTombstones().
+ * @param[in] index
+ * Position of template in sequence order.
+ *
+ * @return
+ * true if the template is deleted, false otherwise.
+ */
+static bool
+isTombstoned(
+    const std::vector<uint8_t> &tombstones,
+    const uint64_t index)
+{
+	return (((index / 8) < tombstones.size()) &&
+	    ((tombstones[index / 8] & (1u << (index % 8))) != 0));
+}
+
+/**
+ * @brief
+ * Copy the live templates of RecordStores into a new RecordStore, then
+ * remove the originals and their tombstones.
+ *
+ * @param[in] enrollmentDirectory
+ * Directory containing all RecordStores.
+ * @param[in] names
+ * Names of RecordStores to copy, in order.
+ * @param[in] name
+ * Name of RecordStore to create.
+ * @param[in] description
+ * Description of RecordStore to create.
+ * @param[in] prefilterFingerLength
+ * Bytes of template per finger when writing inverted lists of the new
+ * RecordStore, or 0 for no lists.
+ * @param[in] fingerSlabs
+ * Whether to write finger slabs of the new RecordStore.
+ * @param[in] compression
+ * Compressor of the new RecordStore, as named by CompressedRecordStore, or
+ * empty for none.
+ *
+ * @throw BE::Error::Exception
+ * Error reading, writing, or removing RecordStores.
+ */
+static void
+rewriteRecordStores(
+    const std::string &enrollmentDirectory,
+    const std::vector<std::string> &names,
+    const std::string &name,
+    const std::string &description,
+    const uint64_t prefilterFingerLength,
+    const bool fingerSlabs,
+    const std::string &compression)
+{
+	{
+		N2N::PrefilterIndex index{prefilterFingerLength};
+		N2N::FingerSlabs slabs{};
+		const auto out = createTemplateStore(enrollmentDirectory + '/' +
+		    name, description, compression);
+		for (const auto &in : names) {
+			const auto rs = BE::IO::RecordStore::openRecordStore(
+			    enrollmentDirectory + '/' + in,
+			    BE::IO::Mode::ReadOnly);
+			const auto tombstones = readTombstones(
+			    enrollmentDirectory + '/' + in);
+			for (uint64_t i{0}; ; ++i) {
+				try {
+					const auto record = rs->sequence();
+					if (isTombstoned(tombstones, i))
+						continue;
+					out->insert(record.key, record.data);
+					if (prefilterFingerLength != 0)
+						index.add(record.key,
+						    record.data);
+					if (fingerSlabs)
+						slabs.add(record.key,
+						    record.data);
+				} catch (BE::Error::ObjectDoesNotExist) {
+					break;
+				}
+			}
+		}
+		out->sync();
+		if (prefilterFingerLength != 0)
+			index.write(enrollmentDirectory + '/' + name +
+			    PrefilterSuffix);
+		if (fingerSlabs)
+			slabs.write(enrollmentDirectory + '/' + name +
+			    FingerSlabsSuffix);
+	}
+
+	for (const auto &in : names) {
+		const std::string path{enrollmentDirectory + '/' + in};
+		BE::IO::RecordStore::removeRecordStore(path);
+		for (const std::string suffix : {".tombstones",
+		    PrefilterSuffix.c_str(), FingerSlabsSuffix.c_str()}) {
+			if (BE::IO::Utility::fileExists(path + suffix) &&
+			    (std::remove((path + suffix).c_str()) != 0))
+				throw BE::Error::FileError("Could not remove " +
+				    path + suffix + " (" +
+				    BE::Error::errorStr() + ')');
+		}
+	}
+}
+
+/**
+ * @brief
+ * Add the size of every template in a RecordStore to a partitioner.
+ *
+ * @param[in] partitioner
+ * Partitioner to which templates are added.
+ * @param[in] enrollmentTemplates
+ * RecordStore of enrollment templates.
+ *
+ * @throw BE::Error::Exception
+ * Error reading `enrollmentTemplates`.
+ */
+static void
+addTemplateSizes(
+    N2N::EnrollmentPartitioner &partitioner,
+    BE::IO::RecordStore &enrollmentTemplates)
+{
+	/* Sizes are enough to partition, so templates are only read once */
+	for (;;) {
+		try {
+			const auto key = enrollmentTemplates.sequenceKey();
+			partitioner.add(key, enrollmentTemplates.length(key));
+		} catch (BE::Error::ObjectDoesNotExist) {
+			break;
+		}
+	}
+}
+
+/**
+ * @brief
+ * Add each unique template in a RecordStore to a partitioner.
+ * @details
+ * Templates are hashed, and those whose hash matches are compared byte for
+ * byte, so every template is read at least once.
+ *
+ * @param[in] partitioner
+ * Partitioner to which unique templates are added.
+ * @param[in] enrollmentTemplates
+ * RecordStore of enrollment templates.
+ *
+ * @return
+ * Other IDs of each template added that has duplicates.
+ *
+ * @throw BE::Error::Exception
+ * Error reading `enrollmentTemplates`.
+ */
+static std::unordered_map<std::string, std::vector<std::string>>
+addUniqueTemplates(
+    N2N::EnrollmentPartitioner &partitioner,
+    BE::IO::RecordStore &enrollmentTemplates)
+{
+	std::unordered_map<uint64_t, std::vector<std::string>> unique{};
+	std::unordered_map<std::string, std::vector<std::string>> aliases{};
+	for (;;) {
+		BE::IO::RecordStore::Record record{};
+		try {
+			record = enrollmentTemplates.sequence();
+		} catch (BE::Error::ObjectDoesNotExist) {
+			break;
+		}
+
+		/* Hashes only find candidates; bytes decide */
+		auto &keys = unique[hashTemplate(record.data)];
+		const auto match = std::find_if(keys.cbegin(), keys.cend(),
+		    [&](const std::string &key) {
+			const auto stored = enrollmentTemplates.read(key);
+			return ((stored.size() == record.data.size()) &&
+			    ((stored.size() == 0) || (std::memcmp(&stored[0],
+			    &record.data[0], stored.size()) == 0)));
+		    });
+		if (match != keys.cend()) {
+			aliases[*match].push_back(record.key);
+			continue;
+		}
+
+		keys.push_back(record.key);
+		partitioner.add(record.key, record.data.size());
+	}
+
+	return (aliases);
+}
+
+/**
+ * @brief
+ * Read the other IDs of each stored template that has duplicates.
+ *
+ * @param[in] enrollmentDirectory
+ * Enrollment directory.
+ *
+ * @return
+ * Other IDs of each stored template, empty if there are none.
+ */
+static std::unordered_map<std::string, std::vector<std::string>>
+readAliases(
+    const std::string &enrollmentDirectory)
+{
+	std::unordered_map<std::string, std::vector<std::string>> aliases{};
+	std::ifstream file{enrollmentDirectory + '/' + AliasesName};
+	std::string key{}, alias{};
+	while (file >> key >> alias)
+		aliases[key].push_back(alias);
+
+	return (aliases);
+}
+
+/**
+ * @brief
+ * Write the other IDs of each stored template that has duplicates.
+ *
+ * @param[in] enrollmentDirectory
+ * Enrollment directory.
+ * @param[in] aliases
+ * Other IDs of each stored template.
+ *
+ * @throw BE::Error::Exception
+ * Error writing file.
+ */
+static void
+writeAliases(
+    const std::string &enrollmentDirectory,
+    const std::unordered_map<std::string, std::vector<std::string>>
+    &aliases)
+{
+	std::string lines{};
+	for (const auto &entry : aliases)
+		for (const auto &alias : entry.second)
+			lines += entry.first + ' ' + alias + '\n';
+	BE::IO::Utility::writeFile(reinterpret_cast<const uint8_t *>(
+	    lines.data()), lines.size(), enrollmentDirectory + '/' +
+	    AliasesName);
+}
+
+/**
+ * @brief
+ * Read a set of IDs, one per line.
+ *
+ * @param[in] enrollmentDirectory
+ * Enrollment directory.
+ * @param[in] name
+ * Name of the file in `enrollmentDirectory`, such as HiddenName.
+ *
+ * @return
+ * IDs, empty if the file does not exist.
+ */
+static std::unordered_set<std::string>
+readIDSet(
+    const std::string &enrollmentDirectory,
+    const std::string &name)
+{
+	std::unordered_set<std::string> ids{};
+	std::ifstream file{enrollmentDirectory + '/' + name};
+	std::string key{};
+	while (file >> key)
+		ids.insert(key);
+
+	return (ids);
+}
+
+/**
+ * @brief
+ * Write a set of IDs, one per line.
+ *
+ * @param[in] enrollmentDirectory
+ * Enrollment directory.
+ * @param[in] name
+ * Name of the file in `enrollmentDirectory`, such as HiddenName.
+ * @param[in] ids
+ * IDs to write.
+ *
+ * @throw BE::Error::Exception
+ * Error writing file.
+ */
+static void
+writeIDSet(
+    const std::string &enrollmentDirectory,
+    const std::string &name,
+    const std::unordered_set<std::string> &ids)
+{
+	std::string lines{};
+	for (const auto &key : ids)
+		lines += key + '\n';
+	BE::IO::Utility::writeFile(reinterpret_cast<const uint8_t *>(
+	    lines.data()), lines.size(), enrollmentDirectory + '/' + name);
+}
+
+/**
+ * @brief
+ * Check that every partition fits in a node's memory.
+ *
+ * @param[in] partitions
+ * Partitions returned from EnrollmentPartitioner::partition().
+ * @param[in] nodeMemory
+ * Memory available on each node, in kibibytes.
+ *
+ * @return
+ * StatusCode::InsufficientResources naming the first partition that does not
+ * fit, otherwise success.
+ */
+static N2N::ReturnStatus
+checkPartitionMemory(
+    const std::vector<N2N::EnrollmentPartitioner::Partition> &partitions,
+    const uint64_t nodeMemory)
+{
+	for (uint64_t n{0}; n < partitions.size(); ++n)
+		if ((partitions[n].bytes / 1024) > nodeMemory)
+			return {N2N::StatusCode::InsufficientResources,
+			    "Partition " + std::to_string(n) + " needs " +
+			    std::to_string(partitions[n].bytes / 1024) +
+			    " KiB"};
+
+	return {};
+}
+
+N2N::RandomStream::RandomStream(
+    const uint64_t seed)
+{
+	this->seed(seed);
+}
+
+void
+N2N::RandomStream::seed(
+    const uint64_t seed)
+{
+	/* splitmix64 expands the seed so state is never all zero */
+	uint64_t x{seed};
+	for (auto &s : this->_state) {
+		uint64_t z{(x += UINT64_C(0x9E3779B97F4A7C15))};
+		z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+		z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+		s = z ^ (z >> 31);
+	}
+}
+
+uint64_t
+N2N::RandomStream::next()
+{
+	static const auto rotl = [](const uint64_t x, const int k) -> uint64_t {
+		return ((x << k) | (x >> (64 - k)));
+	};
+
+	const uint64_t result{rotl(this->_state[1] * 5, 7) * 9};
+	const uint64_t t{this->_state[1] << 17};
+
+	this->_state[2] ^= this->_state[0];
+	this->_state[3] ^= this->_state[1];
+	this->_state[1] ^= this->_state[2];
+	this->_state[0] ^= this->_state[3];
+	this->_state[2] ^= t;
+	this->_state[3] = rotl(this->_state[3], 45);
+
+	return (result);
+}
+
+uint64_t
+N2N::RandomStream::nextInRange(
+    const uint64_t min,
+    const uint64_t max)
+{
+	if (max <= min)
+		return (min);
+	return (min + (this->next() % (max - min)));
+}
+
+double
+N2N::RandomStream::nextUnit()
+{
+	/* Top 53 bits fill a double's mantissa */
+	return ((this->next() >> 11) * (1.0 / (UINT64_C(1) << 53)));
+}
+
+void
+N2N::RandomStream::fill(
+    uint8_t *buffer,
+    const uint64_t size)
+{
+	uint64_t offset{0};
+	for (; (offset + sizeof(uint64_t)) <= size; offset += sizeof(uint64_t)) {
+		const uint64_t value{this->next()};
+		std::memcpy(buffer + offset, &value, sizeof(value));
+	}
+	if (offset < size) {
+		const uint64_t value{this->next()};
+		std::memcpy(buffer + offset, &value, size - offset);
+	}
+}
+
+/******************************************************************************/
+
+N2N::EnrollmentPartitioner::EnrollmentPartitioner(
+    const uint64_t fingerLength,
+    const double costPerFinger,
+    const double costPerByte) :
+    _fingerLength{fingerLength},
+    _costPerFinger{costPerFinger},
+    _costPerByte{costPerByte}
+{
+
+}
+
+void
+N2N::EnrollmentPartitioner::add(
+    const std::string &key,
+    const uint64_t bytes)
+{
+	Item item{};
+	item.key = key;
+	item.bytes = bytes;
+	/* Every template is compared at least once */
+	item.fingers = std::max<uint64_t>(1, (this->_fingerLength == 0) ? 1 :
+	    ((bytes + this->_fingerLength - 1) / this->_fingerLength));
+	item.cost = (item.fingers * this->_costPerFinger) +
+	    (item.bytes * this->_costPerByte);
+
+	this->_items.push_back(std::move(item));
+}
+
+const std::vector<N2N::EnrollmentPartitioner::Item>&
+N2N::EnrollmentPartitioner::getItems()
+    const
+{
+	return (this->_items);
+}
+
+std::vector<N2N::EnrollmentPartitioner::Partition>
+N2N::EnrollmentPartitioner::partition(
+    const uint8_t count)
+    const
+{
+	return (this->partition(std::vector<Partition>(count)));
+}
+
+std::vector<N2N::EnrollmentPartitioner::Partition>
+N2N::EnrollmentPartitioner::partition(
+    const std::vector<Partition> &existing)
+    const
+{
+	std::vector<Partition> partitions{existing};
+	const uint8_t count{static_cast<uint8_t>(partitions.size())};
+	if (count == 0)
+		return (partitions);
+
+	/* Loads are compared as fractions of the total, so neither dominates */
+	uint64_t totalBytes{0};
+	double totalCost{0};
+	for (auto &partition : partitions) {
+		partition.items.clear();
+		totalBytes += partition.bytes;
+		totalCost += partition.cost;
+	}
+	for (const auto &item : this->_items) {
+		totalBytes += item.bytes;
+		totalCost += item.cost;
+	}
+	const double byteScale{(totalBytes == 0) ? 0 : (1.0 / totalBytes)};
+	const double costScale{(totalCost <= 0) ? 0 : (1.0 / totalCost)};
+	const auto getLoad = [&](const uint64_t bytes, const double cost) ->
+	    double {
+		return (std::max(bytes * byteScale, cost * costScale));
+	};
+
+	std::vector<uint64_t> order(this->_items.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+	    [&](const uint64_t a, const uint64_t b) {
+		return (getLoad(this->_items[a].bytes, this->_items[a].cost) >
+		    getLoad(this->_items[b].bytes, this->_items[b].cost));
+	    });
+
+	for (const auto i : order) {
+		const Item &item = this->_items[i];
+
+		uint8_t best{0};
+		double bestLoad{0};
+		for (uint8_t p{0}; p < count; ++p) {
+			const double load{getLoad(
+			    partitions[p].bytes + item.bytes,
+			    partitions[p].cost + item.cost)};
+			/* Templates with no size or cost are spread by count */
+			if ((p == 0) || (load < bestLoad) || ((load ==
+			    bestLoad) && (partitions[p].templates <
+			    partitions[best].templates))) {
+				best = p;
+				bestLoad = load;
+			}
+		}
+
+		partitions[best].items.push_back(i);
+		++partitions[best].templates;
+		partitions[best].bytes += item.bytes;
+		partitions[best].fingers += item.fingers;
+		partitions[best].cost += item.cost;
+	}
+
+	/* Keep the enrollment set's order within each partition */
+	for (auto &partition : partitions)
+		std::sort(partition.items.begin(), partition.items.end());
+
+	return (partitions);
+}
+
+std::string
+N2N::EnrollmentPartitioner::report(
+    const std::vector<Partition> &partitions)
+{
+	std::ostringstream out{};
+	out << "Partition Templates Bytes Fingers Cost\n";
+
+	uint64_t maxTemplates{0}, maxBytes{0}, maxFingers{0};
+	uint64_t sumTemplates{0}, sumBytes{0}, sumFingers{0};
+	double maxCost{0}, sumCost{0};
+	for (uint64_t p{0}; p < partitions.size(); ++p) {
+		const auto &partition = partitions[p];
+		out << p << ' ' << partition.templates << ' ' <<
+		    partition.bytes << ' ' << partition.fingers << ' ' <<
+		    std::fixed << std::setprecision(1) << partition.cost <<
+		    '\n';
+
+		maxTemplates = std::max(maxTemplates, partition.templates);
+		maxBytes = std::max(maxBytes, partition.bytes);
+		maxFingers = std::max(maxFingers, partition.fingers);
+		maxCost = std::max(maxCost, partition.cost);
+		sumTemplates += partition.templates;
+		sumBytes += partition.bytes;
+		sumFingers += partition.fingers;
+		sumCost += partition.cost;
+	}
+
+	/* 1.000 is perfect balance */
+	const auto getImbalance = [&](const double max, const double sum) ->
+	    double {
+		return ((sum <= 0) ? 1 : (max * partitions.size() / sum));
+	};
+	out << "Max/Mean " << std::fixed << std::setprecision(3) <<
+	    getImbalance(maxTemplates, sumTemplates) << ' ' <<
+	    getImbalance(maxBytes, sumBytes) << ' ' <<
+	    getImbalance(maxFingers, sumFingers) << ' ' <<
+	    getImbalance(maxCost, sumCost) << '\n';
+
+	return (out.str());
+}
+
+/******************************************************************************/
+
+/** Magic bytes beginning a TemplateContainer */
+static const std::string ContainerMagic{"N2NT"};
+/** Version of TemplateContainer written */
+static const uint8_t ContainerVersion{1};
+/** Bytes of TemplateContainer header */
+static const uint64_t ContainerHeaderLength{8};
+/** Bytes of each TemplateContainer directory entry */
+static const uint64_t ContainerEntryLength{12};
+
+/** Write `value` to `buffer` as little-endian */
+static void
+writeLE32(
+    uint8_t *buffer,
+    const uint32_t value)
+{
+	for (uint8_t i{0}; i < 4; ++i)
+		buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+/** @return Little-endian value at `buffer` */
+static uint32_t
+readLE32(
+    const uint8_t *buffer)
+{
+	uint32_t value{0};
+	for (uint8_t i{0}; i < 4; ++i)
+		value |= static_cast<uint32_t>(buffer[i]) << (8 * i);
+	return (value);
+}
+
+uint64_t
+N2N::TemplateContainer::layout(
+    std::vector<Finger> &fingers)
+{
+	uint64_t offset{ContainerHeaderLength + (ContainerEntryLength *
+	    fingers.size())};
+	for (auto &finger : fingers) {
+		finger.offset = static_cast<uint32_t>(offset);
+		offset += finger.length;
+	}
+	return (offset);
+}
+
+void
+N2N::TemplateContainer::writeDirectory(
+    BE::Memory::uint8Array &tmpl,
+    const std::vector<Finger> &fingers)
+{
+	if ((fingers.size() > std::numeric_limits<uint8_t>::max()) ||
+	    (tmpl.size() < (ContainerHeaderLength + (ContainerEntryLength *
+	    fingers.size()))))
+		throw BE::Error::StrategyError("Template too small for "
+		    "directory");
+
+	std::memcpy(&tmpl[0], ContainerMagic.data(), ContainerMagic.size());
+	tmpl[4] = ContainerVersion;
+	tmpl[5] = static_cast<uint8_t>(fingers.size());
+	tmpl[6] = tmpl[7] = 0;
+
+	uint8_t *entry{&tmpl[ContainerHeaderLength]};
+	for (const auto &finger : fingers) {
+		entry[0] = finger.position;
+		entry[1] = finger.impression;
+		entry[2] = finger.quality;
+		entry[3] = 0;
+		writeLE32(entry + 4, finger.offset);
+		writeLE32(entry + 8, finger.length);
+		entry += ContainerEntryLength;
+	}
+}
+
+bool
+N2N::TemplateContainer::isContainer(
+    const BE::Memory::uint8Array &tmpl)
+{
+	return ((tmpl.size() >= ContainerHeaderLength) &&
+	    (std::memcmp(&tmpl[0], ContainerMagic.data(),
+	    ContainerMagic.size()) == 0) && (tmpl[4] == ContainerVersion) &&
+	    (tmpl.size() >= (ContainerHeaderLength + (ContainerEntryLength *
+	    tmpl[5]))));
+}
+
+std::vector<N2N::TemplateContainer::Finger>
+N2N::TemplateContainer::readDirectory(
+    const BE::Memory::uint8Array &tmpl)
+{
+	if (!isContainer(tmpl))
+		throw BE::Error::StrategyError("Not a template container");
+
+	std::vector<Finger> fingers(tmpl[5]);
+	const uint8_t *entry{&tmpl[ContainerHeaderLength]};
+	for (auto &finger : fingers) {
+		finger.position = entry[0];
+		finger.impression = entry[1];
+		finger.quality = entry[2];
+		finger.offset = readLE32(entry + 4);
+		finger.length = readLE32(entry + 8);
+		if ((static_cast<uint64_t>(finger.offset) + finger.length) >
+		    tmpl.size())
+			throw BE::Error::StrategyError("Finger out of bounds "
+			    "of template container");
+		entry += ContainerEntryLength;
+	}
+	return (fingers);
+}
+
+std::vector<uint8_t>
+N2N::TemplateContainer::getPositions(
+    const BE::Memory::uint8Array &tmpl)
+{
+	std::vector<uint8_t> positions{};
+	if (!isContainer(tmpl))
+		return (positions);
+
+	for (const auto &finger : readDirectory(tmpl))
+		positions.push_back(finger.position);
+	std::sort(positions.begin(), positions.end());
+	positions.erase(std::unique(positions.begin(), positions.end()),
+	    positions.end());
+	return (positions);
+}
+
+/******************************************************************************/
+
+/** Magic bytes beginning a FingerSlabs file */
+static const std::string SlabsMagic{"N2NS"};
+
+void
+N2N::FingerSlabs::add(
+    const std::string &id,
+    const BE::Memory::uint8Array &tmpl)
+{
+	const auto fingers = TemplateContainer::readDirectory(tmpl);
+	const uint32_t index{static_cast<uint32_t>(this->_ids.size())};
+	this->_ids.push_back(id);
+
+	for (const auto &finger : fingers) {
+		Slab &slab = this->_slabs[finger.position];
+		slab.templates.push_back(index);
+		slab.impressions.push_back(finger.impression);
+		slab.qualities.push_back(finger.quality);
+		slab.offsets.push_back(slab.data.size());
+		slab.lengths.push_back(finger.length);
+		slab.data.insert(slab.data.end(), &tmpl[finger.offset],
+		    &tmpl[finger.offset] + finger.length);
+		slab.dataSize = slab.data.size();
+	}
+}
+
+void
+N2N::FingerSlabs::write(
+    const std::string &path)
+    const
+{
+	std::ofstream file{path, std::ios_base::binary | std::ios_base::trunc};
+	const auto put = [&](const void *data, const uint64_t size) {
+		file.write(static_cast<const char *>(data), size);
+	};
+
+	put(SlabsMagic.data(), SlabsMagic.size());
+	const uint32_t idCount{static_cast<uint32_t>(this->_ids.size())};
+	const uint32_t slabCount{static_cast<uint32_t>(this->_slabs.size())};
+	put(&idCount, sizeof(idCount));
+	put(&slabCount, sizeof(slabCount));
+	for (const auto &id : this->_ids) {
+		const uint32_t length{static_cast<uint32_t>(id.size())};
+		put(&length, sizeof(length));
+		put(id.data(), id.size());
+	}
+
+	/* Metadata of a slab precedes its data, so data is contiguous */
+	for (const auto &entry : this->_slabs) {
+		const Slab &slab = entry.second;
+		const uint32_t count{static_cast<uint32_t>(
+		    slab.templates.size())};
+		put(&entry.first, sizeof(entry.first));
+		put(&count, sizeof(count));
+		put(&slab.dataSize, sizeof(slab.dataSize));
+		put(slab.templates.data(), count * sizeof(uint32_t));
+		put(slab.impressions.data(), count);
+		put(slab.qualities.data(), count);
+		put(slab.offsets.data(), count * sizeof(uint64_t));
+		put(slab.lengths.data(), count * sizeof(uint32_t));
+		put(slab.data.data(), slab.data.size());
+	}
+
+	if (!file)
+		throw BE::Error::FileError("Could not write " + path);
+}
+
+std::shared_ptr<N2N::FingerSlabs>
+N2N::FingerSlabs::open(
+    const std::string &path)
+{
+	std::ifstream file{path, std::ios_base::binary};
+	const auto get = [&](void *data, const uint64_t size) {
+		file.read(static_cast<char *>(data), size);
+		if (!file)
+			throw BE::Error::FileError("Truncated finger slabs: " +
+			    path);
+	};
+
+	std::string magic(SlabsMagic.size(), '\0');
+	uint32_t idCount{}, slabCount{};
+	if (!file)
+		throw BE::Error::FileError("Could not open " + path);
+	get(&magic[0], magic.size());
+	if (magic != SlabsMagic)
+		throw BE::Error::FileError("Not finger slabs: " + path);
+	get(&idCount, sizeof(idCount));
+	get(&slabCount, sizeof(slabCount));
+
+	auto slabs = std::make_shared<FingerSlabs>();
+	slabs->_ids.resize(idCount);
+	for (auto &id : slabs->_ids) {
+		uint32_t length{};
+		get(&length, sizeof(length));
+		id.resize(length);
+		if (length != 0)
+			get(&id[0], length);
+	}
+
+	for (uint32_t i{0}; i < slabCount; ++i) {
+		uint8_t position{};
+		uint32_t count{};
+		get(&position, sizeof(position));
+		get(&count, sizeof(count));
+
+		Slab &slab = slabs->_slabs[position];
+		get(&slab.dataSize, sizeof(slab.dataSize));
+		slab.templates.resize(count);
+		slab.impressions.resize(count);
+		slab.qualities.resize(count);
+		slab.offsets.resize(count);
+		slab.lengths.resize(count);
+		get(slab.templates.data(), count * sizeof(uint32_t));
+		get(slab.impressions.data(), count);
+		get(slab.qualities.data(), count);
+		get(slab.offsets.data(), count * sizeof(uint64_t));
+		get(slab.lengths.data(), count * sizeof(uint32_t));
+
+		/* Data is only read when streamed */
+		slab.dataOffset = static_cast<uint64_t>(file.tellg());
+		file.seekg(slab.dataSize, std::ios_base::cur);
+		if (!file)
+			throw BE::Error::FileError("Truncated finger slabs: " +
+			    path);
+	}
+
+	slabs->_fd = ::open(path.c_str(), O_RDONLY);
+	if (slabs->_fd == -1)
+		throw BE::Error::FileError("Could not open " + path + " (" +
+		    BE::Error::errorStr() + ')');
+	return (slabs);
+}
+
+const std::vector<std::string>&
+N2N::FingerSlabs::getIDs()
+    const
+{
+	return (this->_ids);
+}
+
+const std::map<uint8_t, N2N::FingerSlabs::Slab>&
+N2N::FingerSlabs::getSlabs()
+    const
+{
+	return (this->_slabs);
+}
+
+uint64_t
+N2N::FingerSlabs::getDataSize()
+    const
+{
+	uint64_t size{0};
+	for (const auto &slab : this->_slabs)
+		size += slab.second.dataSize;
+	return (size);
+}
+
+uint64_t
+N2N::FingerSlabs::stream(
+    const uint8_t position,
+    std::vector<uint8_t> &buffer)
+    const
+{
+	const auto it = this->_slabs.find(position);
+	if (it == this->_slabs.end())
+		return (0);
+	if (this->_fd == -1)
+		throw BE::Error::FileError("Finger slabs were not opened");
+
+	/* pread() leaves the offset shared with fork()ed processes alone */
+	const Slab &slab = it->second;
+	buffer.resize(slab.dataSize);
+	uint64_t total{0};
+	while (total < slab.dataSize) {
+		const ssize_t count{::pread(this->_fd, buffer.data() + total,
+		    slab.dataSize - total, slab.dataOffset + total)};
+		if (count <= 0)
+			throw BE::Error::FileError("Could not read finger "
+			    "slab (" + BE::Error::errorStr() + ')');
+		total += count;
+	}
+	return (total);
+}
+
+N2N::FingerSlabs::~FingerSlabs()
+{
+	if (this->_fd != -1)
+		::close(this->_fd);
+}
+
+/******************************************************************************/
+
+N2N::PrefilterIndex::PrefilterIndex(
+    const uint64_t fingerLength) :
+    _fingerLength{fingerLength}
+{
+
+}
+
+std::vector<N2N::PrefilterIndex::Key>
+N2N::PrefilterIndex::getKeys(
+    const BE::Memory::uint8Array &tmpl,
+    const uint64_t fingerLength)
+{
+	std::vector<Key> keys{};
+	if (TemplateContainer::isContainer(tmpl)) {
+		for (const auto &finger : TemplateContainer::readDirectory(
+		    tmpl))
+			keys.push_back(static_cast<Key>((finger.position <<
+			    8) | ((finger.length == 0) ? AnyBin :
+			    tmpl[finger.offset])));
+	} else if (fingerLength >= 2) {
+		for (uint64_t offset{0}; (offset + 1) < tmpl.size();
+		    offset += fingerLength)
+			keys.push_back(static_cast<Key>((tmpl[offset] << 8) |
+			    tmpl[offset + 1]));
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	return (keys);
+}
+
+bool
+N2N::PrefilterIndex::matches(
+    const Key search,
+    const Key enrolled)
+{
+	static const uint8_t UnknownPosition{static_cast<uint8_t>(
+	    BE::Finger::Position::Unknown)};
+
+	const uint8_t searchPosition{static_cast<uint8_t>(search >> 8)};
+	const uint8_t enrolledPosition{static_cast<uint8_t>(enrolled >> 8)};
+	const uint8_t searchBin{static_cast<uint8_t>(search & 0xFF)};
+	const uint8_t enrolledBin{static_cast<uint8_t>(enrolled & 0xFF)};
+
+	return (((searchPosition == UnknownPosition) ||
+	    (enrolledPosition == UnknownPosition) ||
+	    (searchPosition == enrolledPosition)) &&
+	    ((searchBin == AnyBin) || (enrolledBin == AnyBin) ||
+	    (searchBin == enrolledBin)));
+}
+
+void
+N2N::PrefilterIndex::add(
+    const std::string &id,
+    const BE::Memory::uint8Array &tmpl)
+{
+	for (const auto key : getKeys(tmpl, this->_fingerLength))
+		this->_lists[key].push_back(id);
+	++this->_templateCount;
+}
+
+const std::map<N2N::PrefilterIndex::Key, std::vector<std::string>>&
+N2N::PrefilterIndex::getLists()
+    const
+{
+	return (this->_lists);
+}
+
+uint64_t
+N2N::PrefilterIndex::getTemplateCount()
+    const
+{
+	return (this->_templateCount);
+}
+
+double
+N2N::PrefilterIndex::getPenetration()
+    const
+{
+	if (this->_templateCount == 0)
+		return (1);
+
+	/* A search finger of key k is as likely as an enrolled finger */
+	uint64_t fingers{0};
+	for (const auto &list : this->_lists)
+		fingers += list.second.size();
+
+	double penetration{0};
+	for (const auto &search : this->_lists) {
+		uint64_t compared{0};
+		for (const auto &enrolled : this->_lists)
+			if (matches(search.first, enrolled.first))
+				compared += enrolled.second.size();
+		penetration += (static_cast<double>(search.second.size()) /
+		    fingers) * std::min(1.0, static_cast<double>(compared) /
+		    this->_templateCount);
+	}
+
+	return (penetration);
+}
+
+void
+N2N::PrefilterIndex::write(
+    const std::string &path)
+    const
+{
+	/* Each list: key and length, then one ID per line */
+	std::ofstream out{path, std::ios::trunc};
+	out << this->_templateCount << '\n';
+	for (const auto &list : this->_lists) {
+		out << list.first << ' ' << list.second.size() << '\n';
+		for (const auto &id : list.second)
+			out << id << '\n';
+	}
+	if (!out)
+		throw BE::Error::FileError("Could not write " + path);
+}
+
+N2N::PrefilterIndex
+N2N::PrefilterIndex::read(
+    const std::string &path,
+    const uint64_t fingerLength)
+{
+	std::ifstream in{path};
+	PrefilterIndex index{fingerLength};
+	if (!(in >> index._templateCount))
+		throw BE::Error::FileError("Could not read " + path);
+
+	Key key{};
+	uint64_t length{};
+	while (in >> key >> length) {
+		in.ignore(1);
+		auto &list = index._lists[key];
+		list.resize(length);
+		for (auto &id : list)
+			if (!std::getline(in, id))
+				throw BE::Error::FileError("Truncated list in " +
+				    path);
+	}
+	if (!in.eof())
+		throw BE::Error::FileError("Could not parse " + path);
+
+	return (index);
+}
+
+std::string
+N2N::PrefilterIndex::report(
+    const std::vector<PrefilterIndex> &indexes)
+{
+	std::ostringstream out{};
+	out << "Partition Templates Lists Penetration Speedup\n";
+
+	uint64_t sumTemplates{0};
+	double sumCompared{0};
+	for (uint64_t p{0}; p < indexes.size(); ++p) {
+		const auto &index = indexes[p];
+		const double penetration{index.getPenetration()};
+		out << p << ' ' << index.getTemplateCount() << ' ' <<
+		    index.getLists().size() << ' ' << std::fixed <<
+		    std::setprecision(4) << penetration << ' ' <<
+		    std::setprecision(2) << ((penetration > 0) ?
+		    (1 / penetration) : 0) << '\n';
+
+		sumTemplates += index.getTemplateCount();
+		sumCompared += penetration * index.getTemplateCount();
+	}
+
+	/* Weighted by templates, as every partition is searched */
+	const double penetration{(sumTemplates == 0) ? 1 :
+	    (sumCompared / sumTemplates)};
+	out << "All " << sumTemplates << " - " << std::fixed <<
+	    std::setprecision(4) << penetration << ' ' <<
+	    std::setprecision(2) << ((penetration > 0) ? (1 / penetration) :
+	    0) << '\n';
+
+	return (out.str());
+}
+
+/******************************************************************************/
+
+N2N::HelperPool::HelperPool(
+    const uint16_t helpers) :
+    _states(helpers + 1)
+{
+	for (uint16_t i{1}; i <= helpers; ++i)
+		this->_threads.push_back(startQuietThread([this, i]() {
+			this->helperMain(i);
+		}));
+}
+
+uint64_t
+N2N::HelperPool::run(
+    const uint64_t cpuMicroseconds,
+    uint8_t *memory,
+    const uint64_t size)
+{
+	/* Helpers may still be finishing a call that was abandoned */
+	this->quiesce();
+
+	/*
+	 * Publish with signals blocked, since a call abandoned while
+	 * holding the mutex would leave it locked forever.
+	 */
+	const uint64_t count{this->_states.size()};
+	sigset_t all{}, previous{};
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	{
+		std::lock_guard<std::mutex> lock{this->_mutex};
+		this->_share = cpuMicroseconds / count;
+		this->_memory = memory;
+		this->_size = size;
+		this->_pending = count - 1;
+		++this->_generation;
+		this->_start.notify_all();
+	}
+	pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+	this->_states[0] = simulateWork(this->_share, memory,
+	    size / count);
+	this->quiesce();
+
+	uint64_t state{0};
+	for (const auto s : this->_states)
+		state ^= s;
+	return (state);
+}
+
+void
+N2N::HelperPool::quiesce()
+    const
+{
+	/* No lock is held, so the caller may be abandoned while waiting */
+	while (this->_pending != 0)
+		std::this_thread::yield();
+}
+
+void
+N2N::HelperPool::helperMain(
+    const uint16_t index)
+{
+	uint64_t seen{0};
+	while (true) {
+		uint64_t share{}, size{};
+		uint8_t *memory{};
+		{
+			std::unique_lock<std::mutex> lock{this->_mutex};
+			this->_start.wait(lock, [&]() {
+				return (this->_stop ||
+				    (this->_generation != seen));
+			});
+			if (this->_stop)
+				return;
+			seen = this->_generation;
+
+			/* The last slice includes the remainder */
+			const uint64_t count{this->_states.size()};
+			const uint64_t slice{this->_size / count};
+			share = this->_share;
+			memory = this->_memory + (index * slice);
+			size = (index == (count - 1)) ?
+			    (this->_size - (index * slice)) : slice;
+		}
+
+		this->_states[index] = simulateWork(share, memory, size);
+		--this->_pending;
+	}
+}
+
+N2N::HelperPool::~HelperPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{this->_mutex};
+		this->_stop = true;
+		this->_start.notify_all();
+	}
+	for (auto &thread : this->_threads)
+		thread.join();
+}
+
+/******************************************************************************/
+
 std::shared_ptr<N2N::Interface>
 N2N::Interface::getImplementation()
 {
@@ -51,64 +1536,455 @@ N2N::NullImplementation::initMakeEnrollmentTemplate(
 {
 	/* Load configuration pre-fork */
 	this->loadConfiguration(configurationDirectory);
+	this->allocateMemory();
 	return {};
 }
 
-N2N::ReturnStatus
-N2N::NullImplementation::makeEnrollmentTemplate(
-    const std::vector<FingerImage> &standardImages,
-    const std::vector<BE::Memory::uint8Array> &proprietaryImages,
-    BE::Memory::uint8Array &enrollmentTemplate)
-{
-	/* Fill template with random data */
-	enrollmentTemplate.resize(this->_config.eLength *
-	    standardImages.size());
-	std::generate(enrollmentTemplate.begin(), enrollmentTemplate.end(),
-	    std::rand);
+N2N::ReturnStatus
+N2N::NullImplementation::makeEnrollmentTemplate(
+    const std::vector<FingerImage> &standardImages,
+    const std::vector<BE::Memory::uint8Array> &proprietaryImages,
+    BE::Memory::uint8Array &enrollmentTemplate)
+{
+	/* Seeded per subject, as processes share the stream from fork() */
+	this->_random.seed(this->_config.randomSeed ^
+	    hashImages(standardImages, proprietaryImages));
+	this->fillTemplate(enrollmentTemplate, this->_config.eLength,
+	    standardImages);
+
+	if (this->simulateCall(this->_config.templateCPUMicroseconds, false))
+		return {StatusCode::FailedToExtract, "Simulated failure"};
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::finalizeEnrollment(
+    const std::string &configurationDirectory,
+    const std::string &enrollmentDirectory,
+    const uint8_t nodeCount,
+    const uint64_t nodeMemory,
+    BE::IO::RecordStore &enrollmentTemplates)
+{
+	/* Ensure availability of sufficient resources */
+	constexpr uint64_t tenGiB{1024 * 1024 * 10};
+	if (nodeMemory < tenGiB)
+		return {StatusCode::InsufficientResources, "< 10 GiB"};
+	if (nodeCount == 0)
+		return {StatusCode::InsufficientResources, "0 nodes"};
+
+	this->loadConfiguration(configurationDirectory);
+	EnrollmentPartitioner partitioner{this->_config.eLength,
+	    this->_config.partitionCostPerFinger,
+	    this->_config.partitionCostPerByte};
+	std::unordered_map<std::string, std::vector<std::string>> aliases{};
+	try {
+		if (this->_config.deduplicateTemplates)
+			aliases = addUniqueTemplates(partitioner,
+			    enrollmentTemplates);
+		else
+			addTemplateSizes(partitioner, enrollmentTemplates);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not read enrollment "
+		    "templates: " + e.whatString()};
+	}
+
+	/* Other IDs of a stored template are restored in stage two */
+	uint64_t duplicates{0};
+	if (this->_config.deduplicateTemplates) {
+		for (const auto &entry : aliases)
+			duplicates += entry.second.size();
+		try {
+			writeAliases(enrollmentDirectory, aliases);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not write duplicate "
+			    "template IDs: " + e.whatString()};
+		}
+	}
+
+	const auto partitions = partitioner.partition(nodeCount);
+	const auto memoryStatus = checkPartitionMemory(partitions, nodeMemory);
+	if (memoryStatus.code != StatusCode::Success)
+		return (memoryStatus);
+
+	const auto &items = partitioner.getItems();
+	std::vector<PrefilterIndex> indexes{};
+	for (uint8_t n{0}; n < nodeCount; ++n) {
+		std::shared_ptr<BE::IO::RecordStore> rs;
+		indexes.emplace_back(this->_config.eLength);
+		try {
+			rs = createTemplateStore(enrollmentDirectory + '/' +
+			    std::to_string(n), "Finalized enrollment set "
+			    "partition " + std::to_string(n + 1) + '/' +
+			    std::to_string(nodeCount),
+			    this->_config.partitionCompression);
+
+			/* Fingers are also laid out by position, for search */
+			FingerSlabs slabs{};
+			for (const auto i : partitions[n].items) {
+				const auto data = enrollmentTemplates.read(
+				    items[i].key);
+				rs->insert(items[i].key, data);
+				if (this->_config.prefilterBins != 0)
+					indexes.back().add(items[i].key, data);
+				if (this->_config.structuredTemplates)
+					slabs.add(items[i].key, data);
+			}
+			if (this->_config.prefilterBins != 0)
+				indexes.back().write(enrollmentDirectory + '/' +
+				    std::to_string(n) + PrefilterSuffix);
+			if (this->_config.structuredTemplates)
+				slabs.write(enrollmentDirectory + '/' +
+				    std::to_string(n) + FingerSlabsSuffix);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not create "
+			    "enrollment set partition: " + e.whatString()};
+		}
+	}
+	if (this->_config.prefilterBins != 0) {
+		const std::string report{PrefilterIndex::report(indexes)};
+		try {
+			BE::IO::Utility::writeFile(
+			    reinterpret_cast<const uint8_t *>(report.data()),
+			    report.size(), enrollmentDirectory + '/' +
+			    PrefilterReportName);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not write "
+			    "pre-filter report: " + e.whatString()};
+		}
+	}
+
+	EnrollmentManifest manifest{};
+	manifest.partitions = partitions;
+	for (uint8_t n{0}; n < nodeCount; ++n)
+		manifest.bases.push_back(std::to_string(n));
+	if (!this->_config.partitionCompression.empty()) {
+		try {
+			const std::string report{reportCompression(
+			    enrollmentDirectory, manifest.bases)};
+			BE::IO::Utility::writeFile(
+			    reinterpret_cast<const uint8_t *>(report.data()),
+			    report.size(), enrollmentDirectory + '/' +
+			    CompressionReportName);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not write "
+			    "compression report: " + e.whatString()};
+		}
+	}
+	manifest.deltas.resize(nodeCount);
+	try {
+		this->writeManifest(enrollmentDirectory, manifest);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not write enrollment set "
+		    "manifest: " + e.whatString()};
+	}
+
+	if (this->_config.deduplicateTemplates)
+		return {StatusCode::Success, std::to_string(duplicates) +
+		    " duplicate template(s) stored once"};
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::addToEnrollment(
+    const std::string &configurationDirectory,
+    const std::string &enrollmentDirectory,
+    const uint64_t nodeMemory,
+    BE::IO::RecordStore &enrollmentTemplates)
+{
+	this->loadConfiguration(configurationDirectory);
+
+	EnrollmentManifest manifest{};
+	EnrollmentPartitioner partitioner{this->_config.eLength,
+	    this->_config.partitionCostPerFinger,
+	    this->_config.partitionCostPerByte};
+	try {
+		manifest = this->readManifest(enrollmentDirectory);
+		addTemplateSizes(partitioner, enrollmentTemplates);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not read enrollment set: " +
+		    e.whatString()};
+	}
+	if (partitioner.getItems().empty())
+		return {};
+
+	/* New templates go where they least unbalance existing partitions */
+	const auto partitions = partitioner.partition(manifest.partitions);
+	const auto memoryStatus = checkPartitionMemory(partitions, nodeMemory);
+	if (memoryStatus.code != StatusCode::Success)
+		return (memoryStatus);
+
+	const auto &items = partitioner.getItems();
+	const std::string delta{std::to_string(manifest.nextDelta++)};
+	for (uint64_t n{0}; n < partitions.size(); ++n) {
+		if (partitions[n].items.empty())
+			continue;
+
+		auto &deltas = manifest.deltas[n];
+		try {
+			const std::string name{std::to_string(n) + '.' + delta};
+			const auto rs = createTemplateStore(
+			    enrollmentDirectory + '/' + name,
+			    "Enrollment set partition " + std::to_string(n + 1) +
+			    " delta " + delta,
+			    this->_config.partitionCompression);
+			PrefilterIndex index{this->_config.eLength};
+			FingerSlabs slabs{};
+			for (const auto i : partitions[n].items) {
+				const auto data = enrollmentTemplates.read(
+				    items[i].key);
+				rs->insert(items[i].key, data);
+				if (this->_config.prefilterBins != 0)
+					index.add(items[i].key, data);
+				if (this->_config.structuredTemplates)
+					slabs.add(items[i].key, data);
+			}
+			if (this->_config.prefilterBins != 0)
+				index.write(enrollmentDirectory + '/' + name +
+				    PrefilterSuffix);
+			if (this->_config.structuredTemplates)
+				slabs.write(enrollmentDirectory + '/' + name +
+				    FingerSlabsSuffix);
+			deltas.push_back(name);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not create delta "
+			    "partition: " + e.whatString()};
+		}
+
+		/*
+		 * Compaction merges only deltas, never the partition, so its
+		 * cost stays proportional to templates added.
+		 */
+		if (deltas.size() <= this->_config.maximumDeltaPartitions)
+			continue;
+		try {
+			const std::string name{std::to_string(n) + '.' +
+			    std::to_string(manifest.nextDelta++)};
+			rewriteRecordStores(enrollmentDirectory, deltas, name,
+			    "Enrollment set partition " + std::to_string(n + 1) +
+			    " compacted deltas", (this->_config.prefilterBins ==
+			    0) ? 0 : this->_config.eLength,
+			    this->_config.structuredTemplates,
+			    this->_config.partitionCompression);
+			deltas = {name};
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not compact delta "
+			    "partitions: " + e.whatString()};
+		}
+	}
+
+	/* IDs enrolled again are no longer removed */
+	auto removedIDs = readIDSet(enrollmentDirectory, RemovedName);
+	const uint64_t previouslyRemoved{removedIDs.size()};
+	for (const auto &item : items)
+		removedIDs.erase(item.key);
+	try {
+		if (removedIDs.size() != previouslyRemoved)
+			writeIDSet(enrollmentDirectory, RemovedName,
+			    removedIDs);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not write removed "
+		    "template IDs: " + e.whatString()};
+	}
+
+	manifest.partitions = partitions;
+	try {
+		this->writeManifest(enrollmentDirectory, manifest);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not write enrollment set "
+		    "manifest: " + e.whatString()};
+	}
+
 	return {};
 }
 
 N2N::ReturnStatus
-N2N::NullImplementation::finalizeEnrollment(
+N2N::NullImplementation::removeFromEnrollment(
     const std::string &configurationDirectory,
     const std::string &enrollmentDirectory,
-    const uint8_t nodeCount,
-    const uint64_t nodeMemory,
-    BE::IO::RecordStore &enrollmentTemplates)
+    const std::vector<std::string> &templateIDs)
 {
-	/* Ensure availability of sufficient resources */
-	constexpr uint64_t tenGiB{1024 * 1024 * 10};
-	if (nodeMemory < tenGiB)
-		return {StatusCode::InsufficientResources, "< 10 GiB"};
-	if (nodeCount == 0)
-		return {StatusCode::InsufficientResources, "0 nodes"};
+	this->loadConfiguration(configurationDirectory);
 
-	const uint64_t tmplPerNode = std::ceil(enrollmentTemplates.getCount() /
-	    static_cast<float>(nodeCount));
-	for (uint8_t n{0}; n < nodeCount; ++n) {
-		std::shared_ptr<BE::IO::RecordStore> rs;
-		try {
-			rs = BE::IO::RecordStore::createRecordStore(
-			    enrollmentDirectory + '/' + std::to_string(n),
-			    "Finalized enrollment set partition " +
-			    std::to_string(n + 1) + '/' +
-			    std::to_string(nodeCount),
-			    BE::IO::RecordStore::Kind::Default);
+	EnrollmentManifest manifest{};
+	try {
+		manifest = this->readManifest(enrollmentDirectory);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not read enrollment set: " +
+		    e.whatString()};
+	}
 
-			for (uint64_t r{0}; r < tmplPerNode; ++r) {
-				try {
-					auto d = enrollmentTemplates.sequence();
-					rs->insert(d.key, d.data);
-				} catch (BE::Error::ObjectDoesNotExist) {
-					break;
+	std::unordered_set<std::string> pending(templateIDs.cbegin(),
+	    templateIDs.cend());
+
+	/*
+	 * IDs sharing a stored template are removed one at a time. The
+	 * template is only tombstoned once no ID uses it, and until then a
+	 * removed stored ID is hidden from stage two.
+	 */
+	auto aliases = readAliases(enrollmentDirectory);
+	auto hidden = readIDSet(enrollmentDirectory, HiddenName);
+	std::unordered_map<std::string, std::string> storedIDs{};
+	for (const auto &entry : aliases)
+		for (const auto &alias : entry.second)
+			storedIDs[alias] = entry.first;
+	uint64_t notEnrolled{0};
+	bool duplicatesChanged{false};
+	for (const auto &id : templateIDs) {
+		if (pending.find(id) == pending.end())
+			continue;
+
+		/* Previously removed, but template kept for duplicates */
+		if (hidden.find(id) != hidden.end()) {
+			pending.erase(id);
+			++notEnrolled;
+			continue;
+		}
+
+		const auto stored = storedIDs.find(id);
+		if (stored != storedIDs.end()) {
+			const std::string key{stored->second};
+			auto &others = aliases[key];
+			others.erase(std::remove(others.begin(), others.end(),
+			    id), others.end());
+			if (others.empty()) {
+				aliases.erase(key);
+				if (hidden.erase(key) != 0)
+					pending.insert(key);
+			}
+			pending.erase(id);
+			duplicatesChanged = true;
+		} else if (aliases.find(id) != aliases.end()) {
+			hidden.insert(id);
+			pending.erase(id);
+			duplicatesChanged = true;
+		}
+	}
+
+	/* Tombstones don't survive compaction, so stage two reads these */
+	auto removedIDs = readIDSet(enrollmentDirectory, RemovedName);
+	const uint64_t previouslyRemoved{removedIDs.size()};
+	for (uint64_t n{0}; n < manifest.partitions.size(); ++n) {
+		for (const auto &name : this->getRecordStoreNames(manifest, n)) {
+			if (pending.empty())
+				break;
+
+			/* Only keys are read, never templates */
+			const std::string path{enrollmentDirectory + '/' +
+			    name};
+			auto tombstones = readTombstones(path);
+			uint64_t count{0}, dead{0}, removed{0};
+			EnrollmentPartitioner partitioner{
+			    this->_config.eLength,
+			    this->_config.partitionCostPerFinger,
+			    this->_config.partitionCostPerByte};
+			try {
+				const auto rs =
+				    BE::IO::RecordStore::openRecordStore(path,
+				    BE::IO::Mode::ReadOnly);
+				tombstones.resize((rs->getCount() + 7) / 8, 0);
+				for (;; ++count) {
+					std::string key{};
+					try {
+						key = rs->sequenceKey();
+					} catch (BE::Error::ObjectDoesNotExist) {
+						break;
+					}
+					if (isTombstoned(tombstones, count)) {
+						++dead;
+						continue;
+					}
+					const auto it = pending.find(key);
+					if (it == pending.end())
+						continue;
+
+					tombstones[count / 8] |= (1u <<
+					    (count % 8));
+					removedIDs.insert(key);
+					partitioner.add(key, rs->length(key));
+					pending.erase(it);
+					++dead;
+					++removed;
+				}
+			} catch (BE::Error::Exception &e) {
+				return {StatusCode::Vendor, "Could not read " +
+				    name + ": " + e.whatString()};
+			}
+			if (removed == 0)
+				continue;
+
+			auto &partition = manifest.partitions[n];
+			for (const auto &item : partitioner.getItems()) {
+				--partition.templates;
+				partition.bytes -= item.bytes;
+				partition.fingers -= item.fingers;
+				partition.cost -= item.cost;
+			}
+
+			/* Rewrite only once enough of the RecordStore is dead */
+			try {
+				if (dead <= (this->_config.maximumDeadFraction *
+				    count)) {
+					BE::IO::Utility::writeFile(
+					    tombstones.data(), tombstones.size(),
+					    path + ".tombstones");
+					continue;
 				}
+
+				/* Compaction forgets which IDs were removed */
+				writeIDSet(enrollmentDirectory, RemovedName,
+				    removedIDs);
+
+				const std::string compacted{std::to_string(n) +
+				    '.' + std::to_string(manifest.nextDelta++)};
+				rewriteRecordStores(enrollmentDirectory, {name},
+				    compacted, "Enrollment set partition " +
+				    std::to_string(n + 1) + " compacted",
+				    (this->_config.prefilterBins == 0) ? 0 :
+				    this->_config.eLength,
+				    this->_config.structuredTemplates,
+				    this->_config.partitionCompression);
+				if (name == manifest.bases[n])
+					manifest.bases[n] = compacted;
+				else
+					std::replace(manifest.deltas[n].begin(),
+					    manifest.deltas[n].end(), name,
+					    compacted);
+			} catch (BE::Error::Exception &e) {
+				return {StatusCode::Vendor, "Could not remove "
+				    "from " + name + ": " + e.whatString()};
 			}
+		}
+	}
+
+	if (duplicatesChanged) {
+		try {
+			writeAliases(enrollmentDirectory, aliases);
+			writeIDSet(enrollmentDirectory, HiddenName, hidden);
 		} catch (BE::Error::Exception &e) {
-			return {StatusCode::Vendor, "Could not create "
-			    "enrollment set partition: " + e.whatString()};
+			return {StatusCode::Vendor, "Could not write duplicate "
+			    "template IDs: " + e.whatString()};
+		}
+	}
+	if (removedIDs.size() != previouslyRemoved) {
+		try {
+			writeIDSet(enrollmentDirectory, RemovedName,
+			    removedIDs);
+		} catch (BE::Error::Exception &e) {
+			return {StatusCode::Vendor, "Could not write removed "
+			    "template IDs: " + e.whatString()};
 		}
 	}
 
+	try {
+		this->writeManifest(enrollmentDirectory, manifest);
+	} catch (BE::Error::Exception &e) {
+		return {StatusCode::Vendor, "Could not write enrollment set "
+		    "manifest: " + e.whatString()};
+	}
+
+	if ((pending.size() + notEnrolled) != 0)
+		return {StatusCode::Success, std::to_string(pending.size() +
+		    notEnrolled) + " ID(s) were not enrolled"};
 	return {};
 }
 
@@ -119,6 +1995,7 @@ N2N::NullImplementation::initMakeSearchTemplate(
 {
 	/* Load configuration pre-fork */
 	this->loadConfiguration(configurationDirectory);
+	this->allocateMemory();
 	return {};
 }
 
@@ -128,9 +2005,14 @@ N2N::NullImplementation::makeSearchTemplate(
     const std::vector<BE::Memory::uint8Array> &proprietaryImages,
     BE::Memory::uint8Array &searchTemplate)
 {
-	/* Fill template with random data */
-	searchTemplate.resize(this->_config.sLength * standardImages.size());
-	std::generate(searchTemplate.begin(), searchTemplate.end(), std::rand);
+	/* Seeded per subject, as processes share the stream from fork() */
+	this->_random.seed(this->_config.randomSeed ^
+	    hashImages(standardImages, proprietaryImages));
+	this->fillTemplate(searchTemplate, this->_config.sLength,
+	    standardImages);
+
+	if (this->simulateCall(this->_config.templateCPUMicroseconds, false))
+		return {StatusCode::FailedToExtract, "Simulated failure"};
 	return {};
 }
 
@@ -144,7 +2026,52 @@ N2N::NullImplementation::initIdentificationStageOne(
 	/* Load configuration and open enrollment set pre-fork */
 	this->loadConfiguration(configurationDirectory);
 	this->openEnrollmentSet(enrollmentDirectory, nodeNumber);
+	this->readRemovals(enrollmentDirectory);
+	this->allocateMemory();
+
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::setThreadsPerProcess(
+    const uint16_t threadsPerProcess)
+{
+	this->_threadsPerProcess = std::max<uint16_t>(1, threadsPerProcess);
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::initWorker(
+    const uint8_t processNumber)
+{
+	/* Threads do not survive fork(), so start them in each process */
+	if (this->_threadsPerProcess > 1)
+		this->_helpers.reset(new HelperPool(
+		    this->_threadsPerProcess - 1));
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::setCandidateListLength(
+    const uint16_t candidateListLength)
+{
+	this->_candidateListLength = candidateListLength;
+	return {};
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::setSearchThresholds(
+    const std::shared_ptr<SearchThresholds> &thresholds)
+{
+	this->_thresholds = thresholds;
+	return {};
+}
 
+N2N::ReturnStatus
+N2N::NullImplementation::setAsyncWriter(
+    const std::shared_ptr<AsyncWriter> &writer)
+{
+	this->_asyncWriter = writer;
 	return {};
 }
 
@@ -154,35 +2081,344 @@ N2N::NullImplementation::identifyTemplateStageOne(
     const BE::Memory::uint8Array &searchTemplate,
     const std::string &stageOneDataDirectory)
 {
-	static const uint8_t numCandidates{5};
+	/* Results depend only on the search, not on process partitioning */
+	this->_random.seed(this->_config.randomSeed ^ hashString(searchID));
 
-	std::map<std::string, uint64_t> candidates;
+	/*
+	 * Only templates passing the pre-filter, with fingers in the slabs
+	 * of the searched positions, are compared.
+	 */
+	this->applyPrefilter(PrefilterIndex::getKeys(searchTemplate,
+	    this->_config.sLength));
+	const double penetration{this->selectSlabs(
+	    TemplateContainer::getPositions(searchTemplate), true)};
+	if (this->simulateCall(static_cast<uint64_t>(penetration *
+	    this->_config.stageOneCPUMicroseconds), true))
+		return {StatusCode::FailedToSearch, "Simulated failure"};
 
-	/* Pull off the next N candidates */
-	std::string key{};
-	for (uint8_t i{0}; i < numCandidates; ++i) {
-		try {
-			key = this->_enrollmentSet->sequence().key;
-		} catch (BE::Error::ObjectDoesNotExist) {
-			/* Restart at beginning */
-			key = this->_enrollmentSet->sequence(
-			    BE::IO::RecordStore::BE_RECSTORE_SEQ_START).key;
+	const uint64_t pruned{this->writeStageOneData(searchID,
+	    stageOneDataDirectory)};
+	return (this->getStageOneStatus(penetration, pruned));
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::identifyTemplatesStageOne(
+    const std::vector<std::string> &searchIDs,
+    const std::vector<BE::Memory::uint8Array> &searchTemplates,
+    const std::vector<std::string> &stageOneDataDirectories)
+{
+	if (searchIDs.empty())
+		return {};
+
+	/*
+	 * One simulated pass over the partition serves the whole group,
+	 * comparing templates that pass the pre-filter for any search and
+	 * streaming each slab any search needs once.
+	 */
+	std::vector<std::vector<PrefilterIndex::Key>> keys{};
+	std::vector<PrefilterIndex::Key> groupKeys{};
+	std::vector<std::vector<uint8_t>> positions{};
+	std::vector<uint8_t> groupPositions{};
+	bool allPositions{false};
+	for (const auto &searchTemplate : searchTemplates) {
+		keys.push_back(PrefilterIndex::getKeys(searchTemplate,
+		    this->_config.sLength));
+		groupKeys.insert(groupKeys.end(), keys.back().cbegin(),
+		    keys.back().cend());
+		positions.push_back(TemplateContainer::getPositions(
+		    searchTemplate));
+		allPositions |= positions.back().empty();
+		groupPositions.insert(groupPositions.end(),
+		    positions.back().cbegin(), positions.back().cend());
+	}
+	if (allPositions)
+		groupPositions.clear();
+	std::sort(groupPositions.begin(), groupPositions.end());
+	this->applyPrefilter(groupKeys);
+	const double penetration{this->selectSlabs(groupPositions, true)};
+
+	this->_random.seed(this->_config.randomSeed ^
+	    hashString(searchIDs.front()));
+	if (this->simulateCall(static_cast<uint64_t>(penetration *
+	    this->_config.stageOneCPUMicroseconds), true))
+		return {StatusCode::FailedToSearch, "Simulated failure"};
+
+	uint64_t pruned{0};
+	for (uint64_t i{0}; i < searchIDs.size(); ++i) {
+		this->_random.seed(this->_config.randomSeed ^
+		    hashString(searchIDs[i]));
+		this->applyPrefilter(keys[i]);
+		this->selectSlabs(positions[i], false);
+		pruned += this->writeStageOneData(searchIDs[i],
+		    stageOneDataDirectories[i]);
+	}
+
+	return (this->getStageOneStatus(penetration, pruned));
+}
+
+uint64_t
+N2N::NullImplementation::writeStageOneData(
+    const std::string &searchID,
+    const std::string &stageOneDataDirectory)
+{
+	/*
+	 * Consecutive IDs from a random start are unique and need no lookup.
+	 * No more than the candidate list length from one partition can
+	 * place in the final candidate list.
+	 */
+	const uint64_t numIDs{this->_filtered ?
+	    this->_filteredCandidates.size() : this->_candidateIDs.size()};
+	const uint64_t numCandidates{std::min<uint64_t>(std::min<uint64_t>(
+	    this->_config.stageOneCandidates, this->_candidateListLength),
+	    numIDs)};
+	uint64_t index{this->_random.nextInRange(0, numIDs)};
+
+	/* Lower scores than another node's full list cannot place */
+	const double threshold{this->_thresholds ?
+	    this->_thresholds->getThreshold(searchID) :
+	    std::numeric_limits<double>::lowest()};
+	uint64_t pruned{0};
+	uint64_t lowestScore{std::numeric_limits<uint64_t>::max()};
+
+	/*
+	 * Stage two drops hidden and removed IDs and expands aliased ones,
+	 * so only candidates it keeps as written make this list full.
+	 */
+	uint64_t retained{0};
+
+	this->_stageOneOutput.clear();
+	for (uint64_t i{0}; i < numCandidates; ++i) {
+		const std::string &id{this->_candidateIDs[this->_filtered ?
+		    this->_filteredCandidates[index] : index]};
+		const uint64_t score{this->_random.nextInRange(
+		    this->_config.scoreMin, this->_config.scoreMax)};
+		if ((this->_removedIDs.find(id) == this->_removedIDs.end()) &&
+		    (this->_aliases.find(id) == this->_aliases.end())) {
+			lowestScore = std::min(lowestScore, score);
+			++retained;
+		}
+		if (static_cast<double>(score) < threshold) {
+			++pruned;
+		} else {
+			this->_stageOneOutput += id;
+			this->_stageOneOutput += ',';
+			this->_stageOneOutput += std::to_string(score);
+			this->_stageOneOutput += '\n';
 		}
 
-		/* Assign a random score */
-		candidates[key] = (std::rand() % (this->_config.scoreMax -
-		    this->_config.scoreMin)) + this->_config.scoreMin;
+		if (++index == numIDs)
+			index = 0;
 	}
 
+	/* A full list bounds every other node's useful candidates */
+	if (this->_thresholds && (retained == this->_candidateListLength))
+		this->_thresholds->raiseThreshold(searchID,
+		    static_cast<double>(lowestScore));
+
 	/* Write candidate IDs to a unique filename */
-	std::string outputString{};
-	for (const auto &c : candidates)
-		outputString += c.first + ',' + std::to_string(c.second) + '\n';
-	BE::IO::Utility::writeFile((const uint8_t *)outputString.data(),
-	    outputString.size(), stageOneDataDirectory + '/' + searchID + '-' +
-	    BE::Text::basename(this->_enrollmentSet->getPathname()));
+	const std::string path{stageOneDataDirectory + '/' + searchID + '-' +
+	    this->_partitionName};
+	if (this->_asyncWriter) {
+		BE::Memory::uint8Array data{};
+		data.copy(reinterpret_cast<const uint8_t *>(
+		    this->_stageOneOutput.data()),
+		    this->_stageOneOutput.size());
+		this->_asyncWriter->write(path, std::move(data));
+	} else {
+		BE::IO::Utility::writeFile(reinterpret_cast<const uint8_t *>(
+		    this->_stageOneOutput.data()),
+		    this->_stageOneOutput.size(), path);
+	}
 
-	return {};
+	return (pruned);
+}
+
+void
+N2N::NullImplementation::fillTemplate(
+    BE::Memory::uint8Array &tmpl,
+    const uint64_t fingerLength,
+    const std::vector<FingerImage> &images)
+{
+	/* Fill template with random data */
+	if (!this->_config.structuredTemplates) {
+		tmpl.resize(fingerLength * images.size());
+		this->_random.fill(tmpl, tmpl.size());
+		this->encodePrefilterKeys(tmpl, fingerLength, images);
+		return;
+	}
+
+	std::vector<TemplateContainer::Finger> fingers(images.size());
+	for (uint64_t i{0}; i < images.size(); ++i) {
+		fingers[i].position = static_cast<uint8_t>(images[i].fgp);
+		fingers[i].impression = static_cast<uint8_t>(images[i].imp);
+		fingers[i].quality = images[i].nfiq2;
+		fingers[i].length = static_cast<uint32_t>(fingerLength);
+	}
+	tmpl.resize(TemplateContainer::layout(fingers));
+	this->_random.fill(tmpl, tmpl.size());
+	TemplateContainer::writeDirectory(tmpl, fingers);
+	this->encodePrefilterKeys(tmpl, fingerLength, images);
+}
+
+void
+N2N::NullImplementation::encodePrefilterKeys(
+    BE::Memory::uint8Array &tmpl,
+    const uint64_t fingerLength,
+    const std::vector<FingerImage> &images)
+{
+	if (this->_config.prefilterBins == 0)
+		return;
+
+	/* Bin stands in for a feature such as pattern class */
+	if (TemplateContainer::isContainer(tmpl)) {
+		for (const auto &finger : TemplateContainer::readDirectory(
+		    tmpl))
+			if (finger.length != 0)
+				tmpl[finger.offset] = static_cast<uint8_t>(
+				    this->_random.nextInRange(1,
+				    this->_config.prefilterBins + 1));
+		return;
+	}
+	for (uint64_t i{0}; i < images.size(); ++i) {
+		const uint64_t offset{i * fingerLength};
+		if ((offset + 1) >= tmpl.size())
+			break;
+		tmpl[offset] = static_cast<uint8_t>(images[i].fgp);
+		tmpl[offset + 1] = static_cast<uint8_t>(
+		    this->_random.nextInRange(1,
+		    this->_config.prefilterBins + 1));
+	}
+}
+
+double
+N2N::NullImplementation::applyPrefilter(
+    const std::vector<PrefilterIndex::Key> &keys)
+{
+	this->_filtered = (this->_config.prefilterBins != 0) &&
+	    !this->_candidateIDs.empty();
+	if (!this->_filtered)
+		return (1);
+
+	this->_filteredCandidates.clear();
+	const auto addList = [&](const std::vector<uint64_t> &list) {
+		for (const auto i : list) {
+			if (this->_filterMarks[i] != 0)
+				continue;
+			this->_filterMarks[i] = 1;
+			this->_filteredCandidates.push_back(i);
+		}
+	};
+	addList(this->_unindexedCandidates);
+	for (const auto key : keys)
+		for (const auto &list : this->_prefilterLists)
+			if (PrefilterIndex::matches(key, list.first))
+				addList(list.second);
+
+	/* Order of _candidateIDs, regardless of the order keys matched */
+	std::sort(this->_filteredCandidates.begin(),
+	    this->_filteredCandidates.end());
+	for (const auto i : this->_filteredCandidates)
+		this->_filterMarks[i] = 0;
+
+	return (static_cast<double>(this->_filteredCandidates.size()) /
+	    this->_candidateIDs.size());
+}
+
+double
+N2N::NullImplementation::selectSlabs(
+    const std::vector<uint8_t> &positions,
+    const bool stream)
+{
+	static const uint8_t UnknownPosition{static_cast<uint8_t>(
+	    BE::Finger::Position::Unknown)};
+
+	if (this->_slabFiles.empty())
+		return (this->_filtered ?
+		    (static_cast<double>(this->_filteredCandidates.size()) /
+		    this->_candidateIDs.size()) : 1);
+
+	/* Unknown positions, searched or enrolled, match every position */
+	const bool all{positions.empty() || std::binary_search(
+	    positions.cbegin(), positions.cend(), UnknownPosition)};
+	std::vector<uint64_t> selected{};
+	const auto addList = [&](const std::vector<uint64_t> &list) {
+		for (const auto i : list) {
+			if (this->_filterMarks[i] != 0)
+				continue;
+			this->_filterMarks[i] = 1;
+			selected.push_back(i);
+		}
+	};
+	addList(this->_unslabbedCandidates);
+	if (stream)
+		this->_slabBytesStreamed = 0;
+	for (uint64_t f{0}; f < this->_slabFiles.size(); ++f) {
+		for (const auto &list : this->_slabCandidates[f]) {
+			if (!all && (list.first != UnknownPosition) &&
+			    !std::binary_search(positions.cbegin(),
+			    positions.cend(), list.first))
+				continue;
+			if (stream)
+				this->_slabBytesStreamed +=
+				    this->_slabFiles[f]->stream(list.first,
+				    this->_slabBuffer);
+			addList(list.second);
+		}
+	}
+
+	/* Intersect with templates chosen by the pre-filter */
+	if (this->_filtered) {
+		this->_filteredCandidates.erase(std::remove_if(
+		    this->_filteredCandidates.begin(),
+		    this->_filteredCandidates.end(), [&](const uint64_t i) {
+			return (this->_filterMarks[i] == 0);
+		    }), this->_filteredCandidates.end());
+	} else {
+		std::sort(selected.begin(), selected.end());
+		this->_filteredCandidates = selected;
+		this->_filtered = true;
+	}
+	for (const auto i : selected)
+		this->_filterMarks[i] = 0;
+
+	return (static_cast<double>(this->_filteredCandidates.size()) /
+	    this->_candidateIDs.size());
+}
+
+N2N::ReturnStatus
+N2N::NullImplementation::getStageOneStatus(
+    const double penetration,
+    const uint64_t pruned)
+    const
+{
+	std::string info{};
+	if (this->_filtered) {
+		std::ostringstream out{};
+		out << "Penetration " << std::fixed << std::setprecision(4) <<
+		    penetration;
+		info = out.str();
+	}
+	if (this->_thresholds) {
+		if (!info.empty())
+			info += "; ";
+		info += std::to_string(pruned) + " stage one candidate(s) "
+		    "pruned";
+	}
+	if (!this->_slabFiles.empty()) {
+		if (!info.empty())
+			info += "; ";
+		info += "Streamed " + std::to_string(
+		    this->_slabBytesStreamed) + " of " + std::to_string(
+		    this->_slabBytesTotal) + " slab bytes";
+	}
+	if (this->_threadsPerProcess > 1) {
+		if (!info.empty())
+			info += "; ";
+		info += "Scanned with " + std::to_string(
+		    this->_threadsPerProcess) + " threads";
+	}
+
+	return {StatusCode::Success, info};
 }
 
 N2N::ReturnStatus
@@ -191,6 +2427,11 @@ N2N::NullImplementation::initIdentificationStageTwo(
     const std::string &enrollmentDirectory,
     const InputType &inputType)
 {
+	/* Load configuration pre-fork */
+	this->loadConfiguration(configurationDirectory);
+	this->allocateMemory();
+	this->readRemovals(enrollmentDirectory);
+
 	return {};
 }
 
@@ -200,7 +2441,30 @@ N2N::NullImplementation::identifyTemplateStageTwo(
     const std::string &stageOneDataDirectory,
     std::vector<Candidate> &candidates)
 {
-	std::map<std::string, uint64_t> stageOneCandidates;
+	if (this->simulateCall(this->_config.stageTwoCPUMicroseconds, false))
+		return {StatusCode::FailedToSearch, "Simulated failure"};
+
+	/* Lowest similarity of a full list is at the front of this min-heap */
+	const auto isMoreSimilar = [](const Candidate &a, const Candidate &b) {
+		return (a.similarity > b.similarity);
+	};
+	const auto offer = [&](const std::string &id, const double similarity) {
+		if ((candidates.size() == this->_candidateListLength) &&
+		    (similarity <= candidates.front().similarity))
+			return;
+		if (this->_removedIDs.find(id) != this->_removedIDs.end())
+			return;
+
+		if (candidates.size() == this->_candidateListLength) {
+			std::pop_heap(candidates.begin(), candidates.end(),
+			    isMoreSimilar);
+			candidates.pop_back();
+		}
+		candidates.emplace_back(id, similarity);
+		std::push_heap(candidates.begin(), candidates.end(),
+		    isMoreSimilar);
+	};
+	uint64_t considered{0}, pruned{0};
 
 	std::unique_ptr<DIR, int(*)(DIR*)> dir(::opendir(
 	    stageOneDataDirectory.c_str()), closedir);
@@ -234,27 +2498,35 @@ N2N::NullImplementation::identifyTemplateStageTwo(
 
 			const auto tokens = BE::Text::split(std::string(
 			    (char *)&file[offset], endOffset - offset), ',');
+			offset = endOffset + 1;
 			if (tokens.size() != 2)
 				return {StatusCode::Vendor, "Malformed stage "
 				    "one data for " + searchID + " in file " +
 				    entry->d_name};
-			candidates.emplace_back(tokens[0],
-			    std::stod(tokens[1]));
+			++considered;
+
+			/* Skip candidates that cannot place in a full list */
+			const double similarity{std::stod(tokens[1])};
+			if ((candidates.size() == this->_candidateListLength) &&
+			    (similarity <= candidates.front().similarity)) {
+				++pruned;
+				continue;
+			}
+			offer(tokens[0], similarity);
+
+			/* Each ID of the template is filtered on its own */
+			const auto aliases = this->_aliases.find(tokens[0]);
+			if (aliases != this->_aliases.end())
+				for (const auto &alias : aliases->second)
+					offer(alias, similarity);
 		}
 	}
 
 	/* Sort candidates by descending similarity score */
-	std::stable_sort(candidates.begin(), candidates.end(),
-	    [](const Candidate &a, const Candidate &b) {
-		return (a.similarity > b.similarity);
-	    });
-
-	/* Maximum of 100 candidates */
-	if (candidates.size() > 100)
-		candidates.erase(std::next(candidates.begin(), 100),
-		    candidates.end());
+	std::sort_heap(candidates.begin(), candidates.end(), isMoreSimilar);
 
-	return {};
+	return {StatusCode::Success, std::to_string(pruned) + " of " +
+	    std::to_string(considered) + " stage one candidates pruned"};
 }
 
 /******************************************************************************/
@@ -271,6 +2543,42 @@ N2N::NullImplementation::loadConfiguration(
 	static const std::string MinScoreKey{"Minimum Score"};
 	/* Key for maximum score */
 	static const std::string MaxScoreKey{"Maximum Score"};
+	/** Key for number of candidates each node returns from stage one */
+	static const std::string StageOneCandidatesKey{"Stage One Candidates"};
+	/** Key for CPU time consumed making a template */
+	static const std::string TemplateCPUKey{"Template CPU Microseconds"};
+	/** Key for CPU time consumed by stage one search */
+	static const std::string StageOneCPUKey{"Stage One CPU Microseconds"};
+	/** Key for CPU time consumed by stage two search */
+	static const std::string StageTwoCPUKey{"Stage Two CPU Microseconds"};
+	/** Key for bytes held after init */
+	static const std::string ResidentMemoryKey{"Resident Memory"};
+	/** Key for bytes written during each call */
+	static const std::string WorkingMemoryKey{"Working Memory"};
+	/** Key for percentage of calls that fail */
+	static const std::string FailurePercentageKey{"Failure Percentage"};
+	/** Key for seed of random output */
+	static const std::string RandomSeedKey{"Random Seed"};
+	/** Key for estimated cost of comparing one enrolled finger */
+	static const std::string PartitionFingerCostKey{
+	    "Partition Cost Per Finger"};
+	/** Key for estimated cost of comparing one enrolled byte */
+	static const std::string PartitionByteCostKey{
+	    "Partition Cost Per Byte"};
+	/** Key for delta partitions allowed before compaction */
+	static const std::string MaxDeltasKey{"Maximum Delta Partitions"};
+	/** Key for deleted fraction of a RecordStore before compaction */
+	static const std::string MaxDeadFractionKey{"Maximum Dead Fraction"};
+	/** Key for coarse feature bins per finger */
+	static const std::string PrefilterBinsKey{"Prefilter Bins"};
+	/** Key for making TemplateContainers laid out by finger position */
+	static const std::string StructuredTemplatesKey{
+	    "Structured Templates"};
+	/** Key for compressor of finalized partitions */
+	static const std::string PartitionCompressionKey{
+	    "Partition Compression"};
+	/** Key for storing byte-identical templates once */
+	static const std::string DeduplicateKey{"Deduplicate Templates"};
 
 	/* Derive name of configuration file from library's name */
 	uint32_t revision;
@@ -280,19 +2588,38 @@ N2N::NullImplementation::loadConfiguration(
 	    ".conf"};
 
 	/* Default configuration values (used if omitted) */
-	static const std::map<const std::string, const std::string> defaults {
+	static const std::map<std::string, std::string> defaults {
 	    {ETmplLengthKey, "1024"},
 	    {STmplLengthKey, "512"},
 
 	    {MinScoreKey, "0"},
 	    {MaxScoreKey, "100"},
+	    {StageOneCandidatesKey, "5"},
+
+	    {TemplateCPUKey, "0"},
+	    {StageOneCPUKey, "0"},
+	    {StageTwoCPUKey, "0"},
+	    {ResidentMemoryKey, "0"},
+	    {WorkingMemoryKey, "0"},
+	    {FailurePercentageKey, "0"},
+	    {RandomSeedKey, "0"},
+
+	    {PartitionFingerCostKey, "1"},
+	    {PartitionByteCostKey, "0"},
+	    {MaxDeltasKey, "4"},
+	    {MaxDeadFractionKey, "0.25"},
+
+	    {PrefilterBinsKey, "0"},
+	    {StructuredTemplatesKey, "No"},
+	    {PartitionCompressionKey, "None"},
+	    {DeduplicateKey, "No"},
 	};
 
 	std::unique_ptr<BE::IO::Properties> conf{};
 	const std::string confName{configurationDirectory + '/' + ConfigFile};
 	try {
 		conf = BE::Memory::make_unique<BE::IO::PropertiesFile>(confName,
-		    BE::IO::Mode::ReadOnly);
+		    BE::IO::Mode::ReadOnly, defaults);
 	} catch (BE::Error::Exception &e) {
 		throw BE::Error::StrategyError{"Could not load config (" +
 		    confName + "): " + e.whatString()};
@@ -303,6 +2630,77 @@ N2N::NullImplementation::loadConfiguration(
 
 	this->_config.scoreMin = conf->getPropertyAsInteger(MinScoreKey);
 	this->_config.scoreMax = conf->getPropertyAsInteger(MaxScoreKey);
+	this->_config.stageOneCandidates = conf->getPropertyAsInteger(
+	    StageOneCandidatesKey);
+
+	this->_config.templateCPUMicroseconds = conf->getPropertyAsInteger(
+	    TemplateCPUKey);
+	this->_config.stageOneCPUMicroseconds = conf->getPropertyAsInteger(
+	    StageOneCPUKey);
+	this->_config.stageTwoCPUMicroseconds = conf->getPropertyAsInteger(
+	    StageTwoCPUKey);
+	this->_config.residentMemory = conf->getPropertyAsInteger(
+	    ResidentMemoryKey);
+	this->_config.workingMemory = conf->getPropertyAsInteger(
+	    WorkingMemoryKey);
+	this->_config.failurePercentage = conf->getPropertyAsDouble(
+	    FailurePercentageKey);
+	if ((this->_config.failurePercentage < 0) ||
+	    (this->_config.failurePercentage > 100))
+		throw BE::Error::StrategyError{"Invalid value for " +
+		    FailurePercentageKey};
+
+	/* Every fork()ed process inherits the same stream */
+	this->_config.randomSeed = conf->getPropertyAsInteger(RandomSeedKey);
+	this->_random.seed(this->_config.randomSeed);
+
+	this->_config.partitionCostPerFinger = conf->getPropertyAsDouble(
+	    PartitionFingerCostKey);
+	this->_config.partitionCostPerByte = conf->getPropertyAsDouble(
+	    PartitionByteCostKey);
+	if ((this->_config.partitionCostPerFinger < 0) ||
+	    (this->_config.partitionCostPerByte < 0))
+		throw BE::Error::StrategyError{"Partition costs can't be "
+		    "negative"};
+	this->_config.maximumDeltaPartitions = conf->getPropertyAsInteger(
+	    MaxDeltasKey);
+	this->_config.maximumDeadFraction = conf->getPropertyAsDouble(
+	    MaxDeadFractionKey);
+	if ((this->_config.maximumDeadFraction < 0) ||
+	    (this->_config.maximumDeadFraction > 1))
+		throw BE::Error::StrategyError{"Invalid value for " +
+		    MaxDeadFractionKey};
+
+	this->_config.structuredTemplates = conf->getPropertyAsBoolean(
+	    StructuredTemplatesKey);
+	const std::string compression{conf->getProperty(
+	    PartitionCompressionKey)};
+	if (BE::Text::caseInsensitiveCompare(compression, "None"))
+		this->_config.partitionCompression.clear();
+	else if (BE::Text::caseInsensitiveCompare(compression, "GZIP"))
+		this->_config.partitionCompression = "GZIP";
+	else
+		throw BE::Error::StrategyError{"Invalid value for " +
+		    PartitionCompressionKey};
+	this->_config.deduplicateTemplates = conf->getPropertyAsBoolean(
+	    DeduplicateKey);
+
+	/*
+	 * Position and bin are stored in the first two bytes of a finger,
+	 * or the bin in the first byte of a TemplateContainer's finger.
+	 */
+	this->_config.prefilterBins = conf->getPropertyAsInteger(
+	    PrefilterBinsKey);
+	if (this->_config.prefilterBins > 255)
+		throw BE::Error::StrategyError{"Invalid value for " +
+		    PrefilterBinsKey};
+	const uint64_t keyLength{this->_config.structuredTemplates ? 1u : 2u};
+	if ((this->_config.prefilterBins != 0) &&
+	    ((this->_config.eLength < keyLength) ||
+	    (this->_config.sLength < keyLength)))
+		throw BE::Error::StrategyError{PrefilterBinsKey + " requires "
+		    "templates of at least " + std::to_string(keyLength) +
+		    " byte(s) per finger"};
 }
 
 void
@@ -310,7 +2708,260 @@ N2N::NullImplementation::openEnrollmentSet(
     const std::string &enrollmentDirectory,
     const uint8_t nodeNumber)
 {
-	this->_enrollmentSet = BE::IO::RecordStore::openRecordStore(
-	    enrollmentDirectory + '/' + std::to_string(nodeNumber),
-	    BE::IO::Mode::ReadOnly);
+	const std::string partition{std::to_string(nodeNumber)};
+	this->_partitionName = partition;
+
+	/* Templates added after finalization are searched with the rest */
+	std::vector<std::string> names{partition};
+	if (BE::IO::Utility::fileExists(enrollmentDirectory + '/' +
+	    ManifestName)) {
+		const auto manifest = this->readManifest(enrollmentDirectory);
+		if (nodeNumber < manifest.partitions.size())
+			names = this->getRecordStoreNames(manifest, nodeNumber);
+	}
+
+	this->_candidateIDs.clear();
+	this->_prefilterLists.clear();
+	this->_unindexedCandidates.clear();
+	this->_slabFiles.clear();
+	this->_slabCandidates.clear();
+	this->_unslabbedCandidates.clear();
+	this->_slabBytesTotal = 0;
+	for (const auto &name : names) {
+		const std::string path{enrollmentDirectory + '/' + name};
+		const auto rs = BE::IO::RecordStore::openRecordStore(path,
+		    BE::IO::Mode::ReadOnly);
+		const auto tombstones = readTombstones(path);
+		const uint64_t first{this->_candidateIDs.size()};
+		this->_candidateIDs.reserve(this->_candidateIDs.size() +
+		    rs->getCount());
+		for (uint64_t i{0}; ; ++i) {
+			try {
+				auto key = rs->sequenceKey();
+				if (!isTombstoned(tombstones, i))
+					this->_candidateIDs.push_back(
+					    std::move(key));
+			} catch (BE::Error::ObjectDoesNotExist) {
+				break;
+			}
+		}
+
+		if (this->_config.prefilterBins != 0)
+			this->loadPrefilterLists(path + PrefilterSuffix, first);
+		if (this->_config.structuredTemplates)
+			this->loadFingerSlabs(path + FingerSlabsSuffix, first);
+	}
+	this->_filterMarks.assign(((this->_config.prefilterBins == 0) &&
+	    this->_slabFiles.empty()) ? 0 : this->_candidateIDs.size(), 0);
+
+	/* Longest possible line: ID, comma, score, newline */
+	uint64_t longestID{0};
+	for (const auto &id : this->_candidateIDs)
+		longestID = std::max<uint64_t>(longestID, id.size());
+	this->_stageOneOutput.reserve(this->_config.stageOneCandidates *
+	    (longestID + std::to_string(this->_config.scoreMax).size() + 2));
+}
+
+void
+N2N::NullImplementation::loadPrefilterLists(
+    const std::string &path,
+    const uint64_t first)
+{
+	const uint64_t last{this->_candidateIDs.size()};
+	if (!BE::IO::Utility::fileExists(path)) {
+		/* Templates without lists must always be compared */
+		for (uint64_t i{first}; i < last; ++i)
+			this->_unindexedCandidates.push_back(i);
+		return;
+	}
+
+	std::unordered_map<std::string, uint64_t> positions{};
+	positions.reserve(last - first);
+	for (uint64_t i{first}; i < last; ++i)
+		positions.emplace(this->_candidateIDs[i], i);
+
+	/* Deleted templates are still listed, but were not loaded */
+	const auto index = PrefilterIndex::read(path, this->_config.eLength);
+	for (const auto &list : index.getLists()) {
+		auto &positionList = this->_prefilterLists[list.first];
+		for (const auto &id : list.second) {
+			const auto it = positions.find(id);
+			if (it != positions.end())
+				positionList.push_back(it->second);
+		}
+	}
+}
+
+void
+N2N::NullImplementation::loadFingerSlabs(
+    const std::string &path,
+    const uint64_t first)
+{
+	const uint64_t last{this->_candidateIDs.size()};
+	if (!BE::IO::Utility::fileExists(path)) {
+		/* Templates without slabs are compared for every position */
+		for (uint64_t i{first}; i < last; ++i)
+			this->_unslabbedCandidates.push_back(i);
+		return;
+	}
+
+	std::unordered_map<std::string, uint64_t> positions{};
+	positions.reserve(last - first);
+	for (uint64_t i{first}; i < last; ++i)
+		positions.emplace(this->_candidateIDs[i], i);
+
+	/* Deleted templates still have fingers, but were not loaded */
+	const auto slabs = FingerSlabs::open(path);
+	const auto &ids = slabs->getIDs();
+	std::map<uint8_t, std::vector<uint64_t>> candidates{};
+	for (const auto &slab : slabs->getSlabs()) {
+		auto &list = candidates[slab.first];
+		for (const auto t : slab.second.templates) {
+			const auto it = positions.find(ids[t]);
+			if (it != positions.end())
+				list.push_back(it->second);
+		}
+	}
+
+	this->_slabBytesTotal += slabs->getDataSize();
+	this->_slabFiles.push_back(slabs);
+	this->_slabCandidates.push_back(std::move(candidates));
+}
+
+std::vector<std::string>
+N2N::NullImplementation::getRecordStoreNames(
+    const EnrollmentManifest &manifest,
+    const uint64_t partition)
+    const
+{
+	std::vector<std::string> names{manifest.bases[partition]};
+	names.insert(names.end(), manifest.deltas[partition].cbegin(),
+	    manifest.deltas[partition].cend());
+	return (names);
+}
+
+N2N::NullImplementation::EnrollmentManifest
+N2N::NullImplementation::readManifest(
+    const std::string &enrollmentDirectory)
+    const
+{
+	const BE::IO::PropertiesFile props{enrollmentDirectory + '/' +
+	    ManifestName, BE::IO::Mode::ReadOnly};
+	const auto getKey = [](const uint64_t n, const std::string &name) ->
+	    std::string {
+		return ("Partition " + std::to_string(n) + ' ' + name);
+	};
+
+	EnrollmentManifest manifest{};
+	const uint64_t count{static_cast<uint64_t>(props.getPropertyAsInteger(
+	    "Partitions"))};
+	manifest.partitions.resize(count);
+	manifest.bases.resize(count);
+	manifest.deltas.resize(count);
+	manifest.nextDelta = props.getPropertyAsInteger("Next Delta");
+	for (uint64_t n{0}; n < count; ++n) {
+		auto &partition = manifest.partitions[n];
+		partition.templates = props.getPropertyAsInteger(getKey(n,
+		    "Templates"));
+		partition.bytes = props.getPropertyAsInteger(getKey(n,
+		    "Bytes"));
+		partition.fingers = props.getPropertyAsInteger(getKey(n,
+		    "Fingers"));
+		partition.cost = props.getPropertyAsDouble(getKey(n, "Cost"));
+		manifest.bases[n] = props.getProperty(getKey(n, "Base"));
+
+		/* Only present once templates have been added */
+		try {
+			manifest.deltas[n] = BE::Text::split(props.getProperty(
+			    getKey(n, "Deltas")), ' ');
+		} catch (BE::Error::ObjectDoesNotExist) {}
+	}
+
+	return (manifest);
+}
+
+void
+N2N::NullImplementation::writeManifest(
+    const std::string &enrollmentDirectory,
+    const EnrollmentManifest &manifest)
+    const
+{
+	BE::IO::PropertiesFile props{enrollmentDirectory + '/' + ManifestName,
+	    BE::IO::Mode::ReadWrite};
+	const auto getKey = [](const uint64_t n, const std::string &name) ->
+	    std::string {
+		return ("Partition " + std::to_string(n) + ' ' + name);
+	};
+
+	props.setPropertyFromInteger("Partitions",
+	    manifest.partitions.size());
+	props.setPropertyFromInteger("Next Delta", manifest.nextDelta);
+	for (uint64_t n{0}; n < manifest.partitions.size(); ++n) {
+		const auto &partition = manifest.partitions[n];
+		props.setPropertyFromInteger(getKey(n, "Templates"),
+		    partition.templates);
+		props.setPropertyFromInteger(getKey(n, "Bytes"),
+		    partition.bytes);
+		props.setPropertyFromInteger(getKey(n, "Fingers"),
+		    partition.fingers);
+		props.setPropertyFromDouble(getKey(n, "Cost"), partition.cost);
+		props.setProperty(getKey(n, "Base"), manifest.bases[n]);
+
+		if (manifest.deltas[n].empty())
+			continue;
+		std::string deltas{};
+		for (const auto &delta : manifest.deltas[n])
+			deltas += (deltas.empty() ? "" : " ") + delta;
+		props.setProperty(getKey(n, "Deltas"), deltas);
+	}
+	props.sync();
+
+	/* Neither is a RecordStore, so never opened as a partition */
+	std::ofstream report{enrollmentDirectory + '/' + PartitionReportName};
+	report << EnrollmentPartitioner::report(manifest.partitions);
+	if (!report)
+		throw BE::Error::FileError("Could not write " +
+		    PartitionReportName);
+}
+
+void
+N2N::NullImplementation::readRemovals(
+    const std::string &enrollmentDirectory)
+{
+	/* Stored templates stand in for every ID with identical templates */
+	this->_aliases = readAliases(enrollmentDirectory);
+
+	/*
+	 * Stage one data may predate removals. Tombstones are dropped by
+	 * compaction, so removed IDs are kept in their own file.
+	 */
+	this->_removedIDs = readIDSet(enrollmentDirectory, HiddenName);
+	for (const auto &id : readIDSet(enrollmentDirectory, RemovedName))
+		this->_removedIDs.insert(id);
+}
+
+void
+N2N::NullImplementation::allocateMemory()
+{
+	/* Writing every byte ensures the pages are resident */
+	this->_residentMemory.assign(this->_config.residentMemory, 1);
+	this->_workingMemory.assign(this->_config.workingMemory, 0);
+}
+
+bool
+N2N::NullImplementation::simulateCall(
+    const uint64_t cpuMicroseconds,
+    const bool parallel)
+{
+	/* Each thread scans a contiguous share of the partition */
+	const uint64_t state{(parallel && this->_helpers) ?
+	    this->_helpers->run(cpuMicroseconds,
+	    this->_workingMemory.data(), this->_workingMemory.size()) :
+	    simulateWork(cpuMicroseconds, this->_workingMemory.data(),
+	    this->_workingMemory.size())};
+	SimulatedWorkSink = SimulatedWorkSink ^ state;
+
+	return ((this->_config.failurePercentage > 0) &&
+	    ((this->_random.nextUnit() * 100) <
+	    this->_config.failurePercentage));
 }
@@ -12,10 +12,750 @@
 #ifndef NULLIMPL_H_
 #define NULLIMPL_H_
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include <n2n.h>
 
 namespace N2N
 {
+	/**
+	 * @brief
+	 * Fast, seedable pseudorandom number generator.
+	 * @details
+	 * xoshiro256** seeded via splitmix64. Each instance is an independent
+	 * stream with no shared state, so fork()ed processes and threads never
+	 * contend for it.
+	 */
+	class RandomStream
+	{
+	public:
+		/**
+		 * @brief
+		 * Constructor.
+		 *
+		 * @param[in] seed
+		 * Initial seed.
+		 */
+		RandomStream(
+		    const uint64_t seed = 0);
+
+		/**
+		 * @brief
+		 * Restart the stream.
+		 *
+		 * @param[in] seed
+		 * Seed. Identical seeds produce identical streams.
+		 */
+		void
+		seed(
+		    const uint64_t seed);
+
+		/** @return Next 64 random bits */
+		uint64_t
+		next();
+
+		/**
+		 * @brief
+		 * Obtain a random value in a range.
+		 *
+		 * @param[in] min
+		 * Minimum value (inclusive).
+		 * @param[in] max
+		 * Maximum value (exclusive).
+		 *
+		 * @return
+		 * Value in [min, max), or min if the range is empty.
+		 */
+		uint64_t
+		nextInRange(
+		    const uint64_t min,
+		    const uint64_t max);
+
+		/** @return Random value in [0, 1) */
+		double
+		nextUnit();
+
+		/**
+		 * @brief
+		 * Fill a buffer with random bytes, 64 bits at a time.
+		 *
+		 * @param[out] buffer
+		 * Buffer to fill.
+		 * @param[in] size
+		 * Number of bytes in `buffer`.
+		 */
+		void
+		fill(
+		    uint8_t *buffer,
+		    const uint64_t size);
+
+	private:
+		/** Generator state */
+		std::array<uint64_t, 4> _state{};
+	};
+
+	/**
+	 * @brief
+	 * Divide enrollment templates into partitions of similar size and
+	 * search cost.
+	 * @details
+	 * Each template's cost is estimated from its length and the number
+	 * of fingers it holds. Templates are assigned largest first to the
+	 * partition whose heavier load, memory or cost, would grow least
+	 * (longest processing time first), so partitions holding a few
+	 * 10-print templates are not outweighed by partitions holding many
+	 * single-finger templates.
+	 */
+	class EnrollmentPartitioner
+	{
+	public:
+		/** One template to be assigned */
+		struct Item
+		{
+			/** Key in the enrollment RecordStore */
+			std::string key{};
+			/** Length of template */
+			uint64_t bytes{};
+			/** Fingers in template */
+			uint64_t fingers{};
+			/** Estimated cost of comparing to template */
+			double cost{};
+		};
+
+		/** Templates assigned to one partition */
+		struct Partition
+		{
+			/** Indices into getItems(), in order added */
+			std::vector<uint64_t> items{};
+			/** Total templates, including those not in `items` */
+			uint64_t templates{};
+			/** Total length of templates */
+			uint64_t bytes{};
+			/** Total fingers in templates */
+			uint64_t fingers{};
+			/** Total estimated cost of templates */
+			double cost{};
+		};
+
+		/**
+		 * @brief
+		 * Constructor.
+		 *
+		 * @param[in] fingerLength
+		 * Bytes of template per finger.
+		 * @param[in] costPerFinger
+		 * Estimated cost of comparing one finger.
+		 * @param[in] costPerByte
+		 * Estimated cost of comparing one byte of template.
+		 */
+		EnrollmentPartitioner(
+		    const uint64_t fingerLength,
+		    const double costPerFinger,
+		    const double costPerByte);
+
+		/**
+		 * @brief
+		 * Add a template to be partitioned.
+		 *
+		 * @param[in] key
+		 * Key of template.
+		 * @param[in] bytes
+		 * Length of template.
+		 */
+		void
+		add(
+		    const std::string &key,
+		    const uint64_t bytes);
+
+		/** @return All templates, in order added */
+		const std::vector<Item>&
+		getItems()
+		    const;
+
+		/**
+		 * @brief
+		 * Assign every template to a partition.
+		 *
+		 * @param[in] count
+		 * Number of partitions.
+		 *
+		 * @return
+		 * `count` partitions. Ties are broken by order added, so
+		 * identical input produces identical partitions.
+		 */
+		std::vector<Partition>
+		partition(
+		    const uint8_t count)
+		    const;
+
+		/**
+		 * @brief
+		 * Assign every template to partitions that already hold
+		 * templates.
+		 *
+		 * @param[in] existing
+		 * Totals of the templates already in each partition. `items`
+		 * is ignored.
+		 *
+		 * @return
+		 * One partition for each of `existing`. `items` holds only
+		 * the templates assigned by this call, and totals include
+		 * `existing`.
+		 */
+		std::vector<Partition>
+		partition(
+		    const std::vector<Partition> &existing)
+		    const;
+
+		/**
+		 * @brief
+		 * Describe partitions.
+		 *
+		 * @param[in] partitions
+		 * Partitions returned from partition().
+		 *
+		 * @return
+		 * One line per partition with its templates, bytes, fingers,
+		 * and cost, followed by the ratio of the largest to the
+		 * mean of each.
+		 */
+		static std::string
+		report(
+		    const std::vector<Partition> &partitions);
+
+	private:
+		/** Bytes of template per finger */
+		const uint64_t _fingerLength;
+		/** Estimated cost of comparing one finger */
+		const double _costPerFinger;
+		/** Estimated cost of comparing one byte */
+		const double _costPerByte;
+
+		/** Templates to partition */
+		std::vector<Item> _items{};
+	};
+
+	/**
+	 * @brief
+	 * Template made of separately addressable fingers.
+	 * @details
+	 * A header and a directory describing each finger precede the
+	 * fingers' data, so a finger can be found without parsing the
+	 * others:
+	 *
+	 * | Bytes | Contents                                        |
+	 * |-------|-------------------------------------------------|
+	 * | 4     | Magic, "N2NT"                                   |
+	 * | 1     | Version (1)                                     |
+	 * | 1     | Number of fingers                               |
+	 * | 2     | Reserved                                        |
+	 * | 12n   | Directory: position, impression, NFIQ2,         |
+	 * |       | reserved, offset (32 bits), length (32 bits)    |
+	 * | ...   | Finger data, at each offset                     |
+	 *
+	 * Multi-byte values are little-endian. Offsets are from the start
+	 * of the template.
+	 */
+	class TemplateContainer
+	{
+	public:
+		/** NFIQ2 value of a finger whose quality was not calculated */
+		static const uint8_t UnknownQuality{254};
+
+		/** One entry of the directory */
+		struct Finger
+		{
+			/** BiometricEvaluation::Finger::Position */
+			uint8_t position{};
+			/** BiometricEvaluation::Finger::Impression */
+			uint8_t impression{};
+			/** NFIQ2 score, [0,100], or UnknownQuality */
+			uint8_t quality{UnknownQuality};
+			/** Offset of finger data from start of template */
+			uint32_t offset{};
+			/** Length of finger data */
+			uint32_t length{};
+		};
+
+		/**
+		 * @brief
+		 * Assign offsets to fingers.
+		 *
+		 * @param[in,out] fingers
+		 * Directory, with lengths set. Offsets are set, in order.
+		 *
+		 * @return
+		 * Length of a template holding `fingers`.
+		 */
+		static uint64_t
+		layout(
+		    std::vector<Finger> &fingers);
+
+		/**
+		 * @brief
+		 * Write the header and directory of a template.
+		 *
+		 * @param[in,out] tmpl
+		 * Template, with the length returned from layout(). Finger
+		 * data is not modified.
+		 * @param[in] fingers
+		 * Directory, as modified by layout().
+		 */
+		static void
+		writeDirectory(
+		    BiometricEvaluation::Memory::uint8Array &tmpl,
+		    const std::vector<Finger> &fingers);
+
+		/**
+		 * @brief
+		 * Determine if a template is a TemplateContainer.
+		 *
+		 * @param[in] tmpl
+		 * Template.
+		 *
+		 * @return
+		 * true if `tmpl` begins with a valid header.
+		 */
+		static bool
+		isContainer(
+		    const BiometricEvaluation::Memory::uint8Array &tmpl);
+
+		/**
+		 * @brief
+		 * Read the directory of a template.
+		 *
+		 * @param[in] tmpl
+		 * Template.
+		 *
+		 * @return
+		 * Directory of `tmpl`, in order.
+		 *
+		 * @throw BiometricEvaluation::Error::StrategyError
+		 * `tmpl` is not a TemplateContainer, or a finger is out of
+		 * bounds.
+		 */
+		static std::vector<Finger>
+		readDirectory(
+		    const BiometricEvaluation::Memory::uint8Array &tmpl);
+
+		/**
+		 * @brief
+		 * Obtain the finger positions of a template.
+		 *
+		 * @param[in] tmpl
+		 * Template.
+		 *
+		 * @return
+		 * Sorted, unique positions, or empty if `tmpl` is not a
+		 * TemplateContainer and positions are unknown.
+		 */
+		static std::vector<uint8_t>
+		getPositions(
+		    const BiometricEvaluation::Memory::uint8Array &tmpl);
+	};
+
+	/**
+	 * @brief
+	 * Fingers of a partition's templates, grouped by finger position.
+	 * @details
+	 * Each slab holds every finger of one position in
+	 * structure-of-arrays order: template indices, impressions,
+	 * qualities, offsets, and lengths, followed by the fingers' data,
+	 * contiguous. A search of known finger positions reads only those
+	 * slabs' data. Files are written in host byte order.
+	 */
+	class FingerSlabs
+	{
+	public:
+		/** All fingers of one position */
+		struct Slab
+		{
+			/** Index into getIDs() of each finger's template */
+			std::vector<uint32_t> templates{};
+			/** Impression of each finger */
+			std::vector<uint8_t> impressions{};
+			/** NFIQ2 score of each finger */
+			std::vector<uint8_t> qualities{};
+			/** Offset of each finger within the slab's data */
+			std::vector<uint64_t> offsets{};
+			/** Length of each finger's data */
+			std::vector<uint32_t> lengths{};
+
+			/** Fingers' data (only while building) */
+			std::vector<uint8_t> data{};
+			/** Offset of fingers' data within the file */
+			uint64_t dataOffset{};
+			/** Length of fingers' data */
+			uint64_t dataSize{};
+		};
+
+		/** Constructor */
+		FingerSlabs() = default;
+
+		/**
+		 * @brief
+		 * Add every finger of a template to slabs.
+		 *
+		 * @param[in] id
+		 * Key of template.
+		 * @param[in] tmpl
+		 * TemplateContainer.
+		 *
+		 * @throw BiometricEvaluation::Error::StrategyError
+		 * `tmpl` is not a TemplateContainer.
+		 */
+		void
+		add(
+		    const std::string &id,
+		    const BiometricEvaluation::Memory::uint8Array &tmpl);
+
+		/**
+		 * @brief
+		 * Write slabs to a file.
+		 *
+		 * @param[in] path
+		 * Path of file to write.
+		 *
+		 * @throw BiometricEvaluation::Error::FileError
+		 * Could not write `path`.
+		 */
+		void
+		write(
+		    const std::string &path)
+		    const;
+
+		/**
+		 * @brief
+		 * Open slabs written by write().
+		 * @details
+		 * Everything but the fingers' data is read. The file remains
+		 * open for stream(), and may be shared by fork()ed processes.
+		 *
+		 * @param[in] path
+		 * Path of file to open.
+		 *
+		 * @return
+		 * Slabs read from `path`.
+		 *
+		 * @throw BiometricEvaluation::Error::FileError
+		 * Could not read or parse `path`.
+		 */
+		static std::shared_ptr<FingerSlabs>
+		open(
+		    const std::string &path);
+
+		/** @return Key of each template, in order added */
+		const std::vector<std::string>&
+		getIDs()
+		    const;
+
+		/** @return Slab of each finger position */
+		const std::map<uint8_t, Slab>&
+		getSlabs()
+		    const;
+
+		/** @return Length of all slabs' data */
+		uint64_t
+		getDataSize()
+		    const;
+
+		/**
+		 * @brief
+		 * Read one slab's data.
+		 *
+		 * @param[in] position
+		 * Finger position of slab.
+		 * @param[out] buffer
+		 * Buffer holding the slab's data, resized as needed.
+		 *
+		 * @return
+		 * Bytes read.
+		 *
+		 * @throw BiometricEvaluation::Error::FileError
+		 * Could not read the slab.
+		 */
+		uint64_t
+		stream(
+		    const uint8_t position,
+		    std::vector<uint8_t> &buffer)
+		    const;
+
+		/** Destructor */
+		~FingerSlabs();
+
+		FingerSlabs(const FingerSlabs&) = delete;
+		FingerSlabs& operator=(const FingerSlabs&) = delete;
+
+	private:
+		/** Key of each template */
+		std::vector<std::string> _ids{};
+		/** Slab of each finger position */
+		std::map<uint8_t, Slab> _slabs{};
+		/** File opened by open(), or -1 */
+		int _fd{-1};
+	};
+
+	/**
+	 * @brief
+	 * Inverted lists of enrollment templates, keyed on coarse features.
+	 * @details
+	 * Each finger of a template has a finger position and a coarse
+	 * feature bin (e.g., pattern class). In a TemplateContainer, the
+	 * position is in the directory and the bin is the first byte of the
+	 * finger's data. Otherwise, the first two bytes of each finger hold
+	 * the position and bin. Each list
+	 * holds every template with a finger of that position and bin, so a
+	 * search need only compare the templates in lists that its fingers
+	 * could match.
+	 */
+	class PrefilterIndex
+	{
+	public:
+		/** Finger position (high byte) and bin (low byte) */
+		using Key = uint16_t;
+		/** Bin of a finger whose coarse features are unknown */
+		static const uint8_t AnyBin{0};
+
+		/**
+		 * @brief
+		 * Constructor.
+		 *
+		 * @param[in] fingerLength
+		 * Bytes of template per finger.
+		 */
+		explicit PrefilterIndex(
+		    const uint64_t fingerLength);
+
+		/**
+		 * @brief
+		 * Obtain the keys of every finger in a template.
+		 *
+		 * @param[in] tmpl
+		 * Template.
+		 * @param[in] fingerLength
+		 * Bytes of `tmpl` per finger.
+		 *
+		 * @return
+		 * Sorted, unique keys of `tmpl`.
+		 */
+		static std::vector<Key>
+		getKeys(
+		    const BiometricEvaluation::Memory::uint8Array &tmpl,
+		    const uint64_t fingerLength);
+
+		/**
+		 * @brief
+		 * Determine if a search finger could match an enrolled finger.
+		 *
+		 * @param[in] search
+		 * Key of search finger.
+		 * @param[in] enrolled
+		 * Key of enrolled finger.
+		 *
+		 * @return
+		 * true if positions and bins are equal or unknown.
+		 */
+		static bool
+		matches(
+		    const Key search,
+		    const Key enrolled);
+
+		/**
+		 * @brief
+		 * Add a template to the lists of each of its fingers.
+		 *
+		 * @param[in] id
+		 * Key of template.
+		 * @param[in] tmpl
+		 * Template.
+		 */
+		void
+		add(
+		    const std::string &id,
+		    const BiometricEvaluation::Memory::uint8Array &tmpl);
+
+		/** @return Template IDs in each list, in order added */
+		const std::map<Key, std::vector<std::string>>&
+		getLists()
+		    const;
+
+		/** @return Number of templates added */
+		uint64_t
+		getTemplateCount()
+		    const;
+
+		/**
+		 * @return
+		 * Expected fraction of templates compared when the search
+		 * is one finger distributed like the enrolled fingers.
+		 */
+		double
+		getPenetration()
+		    const;
+
+		/**
+		 * @brief
+		 * Write lists to a file.
+		 *
+		 * @param[in] path
+		 * Path of file to write.
+		 *
+		 * @throw BiometricEvaluation::Error::FileError
+		 * Could not write `path`.
+		 */
+		void
+		write(
+		    const std::string &path)
+		    const;
+
+		/**
+		 * @brief
+		 * Read lists written by write().
+		 *
+		 * @param[in] path
+		 * Path of file to read.
+		 * @param[in] fingerLength
+		 * Bytes of template per finger.
+		 *
+		 * @return
+		 * Index read from `path`.
+		 *
+		 * @throw BiometricEvaluation::Error::FileError
+		 * Could not read or parse `path`.
+		 */
+		static PrefilterIndex
+		read(
+		    const std::string &path,
+		    const uint64_t fingerLength);
+
+		/**
+		 * @brief
+		 * Describe indexes.
+		 *
+		 * @param[in] indexes
+		 * Index of each partition.
+		 *
+		 * @return
+		 * One line per partition with its templates, lists,
+		 * penetration rate, and the speedup over comparing every
+		 * template.
+		 */
+		static std::string
+		report(
+		    const std::vector<PrefilterIndex> &indexes);
+
+	private:
+		/** Bytes of template per finger */
+		uint64_t _fingerLength;
+		/** Number of templates added */
+		uint64_t _templateCount{};
+		/** Template IDs with a finger of each key */
+		std::map<Key, std::vector<std::string>> _lists{};
+	};
+
+	/**
+	 * @brief
+	 * Persistent threads that share the simulated cost of calls.
+	 * @details
+	 * Threads are started once, after fork(), and wait between calls.
+	 * All state of a call is held here rather than on the caller's
+	 * stack, because the testing application may abandon a call that
+	 * times out without unwinding it. Helpers still working on an
+	 * abandoned call finish into that state, and the next call waits
+	 * for them before starting.
+	 */
+	class HelperPool
+	{
+	public:
+		/**
+		 * @brief
+		 * Constructor.
+		 *
+		 * @param[in] helpers
+		 * Number of threads to start, not including the caller.
+		 */
+		HelperPool(
+		    const uint16_t helpers);
+
+		/**
+		 * @brief
+		 * Consume CPU time and write memory, split evenly between
+		 * the calling thread and all helpers.
+		 *
+		 * @param[in] cpuMicroseconds
+		 * CPU time to consume, across all threads.
+		 * @param[in] memory
+		 * Working memory, which must outlive this object. Each
+		 * thread writes a contiguous slice.
+		 * @param[in] size
+		 * Size of `memory`.
+		 *
+		 * @return
+		 * Combined result of the work, so it cannot be discarded.
+		 */
+		uint64_t
+		run(
+		    const uint64_t cpuMicroseconds,
+		    uint8_t *memory,
+		    const uint64_t size);
+
+		/** Destructor. Waits for and joins all helpers. */
+		~HelperPool();
+
+		HelperPool(const HelperPool&) = delete;
+		HelperPool& operator=(const HelperPool&) = delete;
+
+	private:
+		/**
+		 * @brief
+		 * Work on each call published by run().
+		 *
+		 * @param[in] index
+		 * Slice of the work done by this helper, [1, helpers].
+		 */
+		void
+		helperMain(
+		    const uint16_t index);
+
+		/** Wait for helpers working on the current call */
+		void
+		quiesce()
+		    const;
+
+		/** Helper threads */
+		std::vector<std::thread> _threads{};
+		/** Protects the parameters of the current call */
+		std::mutex _mutex{};
+		/** Signaled when a call is published or helpers stop */
+		std::condition_variable _start{};
+		/** Number of the current call */
+		uint64_t _generation{};
+		/** Whether helpers should exit */
+		bool _stop{false};
+
+		/** CPU time each thread consumes in the current call */
+		uint64_t _share{};
+		/** Working memory of the current call */
+		uint8_t *_memory{};
+		/** Size of `_memory` */
+		uint64_t _size{};
+		/** Result of each thread in the current call */
+		std::vector<uint64_t> _states{};
+		/** Helpers still working on the current call */
+		std::atomic<uint64_t> _pending{0};
+	};
+
 	/** Implementation of N2N::Interface that does essentially nothing. */
 	class NullImplementation : public Interface
 	{
@@ -49,6 +789,21 @@ namespace N2N
 		    BiometricEvaluation::IO::RecordStore &enrollmentTemplates)
 		    override;
 
+		ReturnStatus
+		addToEnrollment(
+		    const std::string &configurationDirectory,
+		    const std::string &enrollmentDirectory,
+		    const uint64_t nodeMemory,
+		    BiometricEvaluation::IO::RecordStore &enrollmentTemplates)
+		    override;
+
+		ReturnStatus
+		removeFromEnrollment(
+		    const std::string &configurationDirectory,
+		    const std::string &enrollmentDirectory,
+		    const std::vector<std::string> &templateIDs)
+		    override;
+
 		ReturnStatus
 		initMakeSearchTemplate(
 		    const std::string &configurationDirectory,
@@ -71,6 +826,21 @@ namespace N2N
 		    const uint8_t nodeNumber)
 		    override;
 
+		ReturnStatus
+		setThreadsPerProcess(
+		    const uint16_t threadsPerProcess)
+		    override;
+
+		ReturnStatus
+		setSearchThresholds(
+		    const std::shared_ptr<SearchThresholds> &thresholds)
+		    override;
+
+		ReturnStatus
+		setAsyncWriter(
+		    const std::shared_ptr<AsyncWriter> &writer)
+		    override;
+
 		ReturnStatus
 		identifyTemplateStageOne(
 		    const std::string &searchID,
@@ -79,6 +849,14 @@ namespace N2N
 		    const std::string &stageOneDataDirectory)
 		    override;
 
+		ReturnStatus
+		identifyTemplatesStageOne(
+		    const std::vector<std::string> &searchIDs,
+		    const std::vector<BiometricEvaluation::Memory::uint8Array>
+		    &searchTemplates,
+		    const std::vector<std::string> &stageOneDataDirectories)
+		    override;
+
 		ReturnStatus
 		initIdentificationStageTwo(
 		    const std::string &configurationDirectory,
@@ -86,6 +864,16 @@ namespace N2N
 		    const InputType &inputType)
 		    override;
 
+		ReturnStatus
+		setCandidateListLength(
+		    const uint16_t candidateListLength)
+		    override;
+
+		ReturnStatus
+		initWorker(
+		    const uint8_t processNumber)
+		    override;
+
 		ReturnStatus
 		identifyTemplateStageTwo(
 		    const std::string &searchID,
@@ -109,13 +897,135 @@ namespace N2N
 			uint64_t scoreMin{};
 			/** Maximum score */
 			uint64_t scoreMax{};
+			/**
+			 * Number of candidates returned from stage one by
+			 * each node. Running thresholds are only raised by
+			 * lists as long as the candidate list length, so
+			 * shorter lists never prune.
+			 */
+			uint64_t stageOneCandidates{};
+
+			/** CPU time to consume making a template */
+			uint64_t templateCPUMicroseconds{};
+			/** CPU time to consume in stage one search */
+			uint64_t stageOneCPUMicroseconds{};
+			/** CPU time to consume in stage two search */
+			uint64_t stageTwoCPUMicroseconds{};
+			/** Memory held and touched after each init method */
+			uint64_t residentMemory{};
+			/** Memory written during each call */
+			uint64_t workingMemory{};
+			/** Percentage of calls that fail, [0,100] */
+			double failurePercentage{};
+			/** Seed for all random output */
+			uint64_t randomSeed{};
+
+			/** Estimated cost of comparing one enrolled finger */
+			double partitionCostPerFinger{};
+			/** Estimated cost of comparing one enrolled byte */
+			double partitionCostPerByte{};
+			/** Delta partitions per partition before compaction */
+			uint64_t maximumDeltaPartitions{};
+			/** Deleted fraction of a RecordStore before compaction */
+			double maximumDeadFraction{};
+
+			/** Coarse feature bins per finger (0 disables) */
+			uint64_t prefilterBins{};
+			/**
+			 * Whether templates are TemplateContainers, and
+			 * partitions are laid out by finger position.
+			 */
+			bool structuredTemplates{};
+			/**
+			 * Compressor of finalized partitions, as named by
+			 * CompressedRecordStore (empty for none).
+			 */
+			std::string partitionCompression{};
+			/**
+			 * Whether finalization stores byte-identical
+			 * templates once.
+			 */
+			bool deduplicateTemplates{};
 		};
 		/** Configuration values */
 		struct Configuration _config{};
 
-		/** Partitioned enrollment set (read-only) */
-		std::shared_ptr<BiometricEvaluation::IO::RecordStore>
-		_enrollmentSet;
+		/** Layout of a finalized enrollment set */
+		struct EnrollmentManifest
+		{
+			/** Totals of live templates in each partition */
+			std::vector<EnrollmentPartitioner::Partition>
+			    partitions{};
+			/**
+			 * Names of each partition's RecordStore from
+			 * finalizeEnrollment(), or its compacted replacement.
+			 */
+			std::vector<std::string> bases{};
+			/**
+			 * Names of each partition's delta RecordStores, added
+			 * by addToEnrollment() and searched along with the
+			 * partition.
+			 */
+			std::vector<std::vector<std::string>> deltas{};
+			/** Number used to name the next delta RecordStore */
+			uint64_t nextDelta{1};
+		};
+
+		/** Memory held to simulate a resident data structure */
+		std::vector<uint8_t> _residentMemory{};
+		/** Memory written to simulate per-call working space */
+		std::vector<uint8_t> _workingMemory{};
+
+		/** Source of random templates, scores, and failures */
+		RandomStream _random{};
+
+		/** IDs of all templates in this enrollment set partition */
+		std::vector<std::string> _candidateIDs{};
+		/** Name of this enrollment set partition */
+		std::string _partitionName{};
+		/** Reusable buffer for stage one output */
+		std::string _stageOneOutput{};
+		/** IDs removed or hidden from candidate lists */
+		std::unordered_set<std::string> _removedIDs{};
+		/** IDs sharing each stored template */
+		std::unordered_map<std::string, std::vector<std::string>>
+		    _aliases{};
+		/** Number of candidates requested from stage two */
+		uint16_t _candidateListLength{100};
+		/** Threads each stage one search may use */
+		uint16_t _threadsPerProcess{1};
+		/** Threads sharing stage one searches, after initWorker() */
+		std::unique_ptr<HelperPool> _helpers{};
+		/** Running thresholds shared by all nodes (optional) */
+		std::shared_ptr<SearchThresholds> _thresholds{};
+		/** Writer of stage one data (optional) */
+		std::shared_ptr<AsyncWriter> _asyncWriter{};
+
+		/** Indices into _candidateIDs of each inverted list */
+		std::map<PrefilterIndex::Key, std::vector<uint64_t>>
+		    _prefilterLists{};
+		/** Indices into _candidateIDs without an inverted list */
+		std::vector<uint64_t> _unindexedCandidates{};
+		/** Indices into _candidateIDs passing the current pre-filter */
+		std::vector<uint64_t> _filteredCandidates{};
+		/** Whether _filteredCandidates applies to the current search */
+		bool _filtered{false};
+		/** Nonzero for indices already in _filteredCandidates */
+		std::vector<uint8_t> _filterMarks{};
+
+		/** Finger slabs of each RecordStore that has them */
+		std::vector<std::shared_ptr<const FingerSlabs>> _slabFiles{};
+		/** Indices into _candidateIDs of each of _slabFiles' slabs */
+		std::vector<std::map<uint8_t, std::vector<uint64_t>>>
+		    _slabCandidates{};
+		/** Indices into _candidateIDs without finger slabs */
+		std::vector<uint64_t> _unslabbedCandidates{};
+		/** Buffer into which slabs are read */
+		std::vector<uint8_t> _slabBuffer{};
+		/** Slab data read by the current search */
+		uint64_t _slabBytesStreamed{};
+		/** Data in all of _slabFiles' slabs */
+		uint64_t _slabBytesTotal{};
 
 		/**
 		 * @brief
@@ -138,10 +1048,12 @@ namespace N2N
 
 		/**
 		 * @brief
-		 * Open a partitioned finalized enrollment set.
+		 * Load the IDs of a partitioned finalized enrollment set.
 		 * @details
-		 * `this->_enrollmentSet` contains the read-only opened
-		 * enrollment set after the successful return of this method.
+		 * `this->_candidateIDs` contains every template ID in the
+		 * partition after the successful return of this method, so
+		 * stage one never shares a RecordStore cursor between
+		 * fork()ed processes.
 		 *
 		 * @param[in] enrollmentDirectory
 		 * Path to the directory containing the enrollment set.
@@ -157,6 +1069,283 @@ namespace N2N
 		openEnrollmentSet(
 		    const std::string &enrollmentDirectory,
 		    const uint8_t nodeNumber);
+
+		/**
+		 * @brief
+		 * Read the IDs stage two drops or adds to candidate lists
+		 * into _removedIDs and _aliases.
+		 *
+		 * @param[in] enrollmentDirectory
+		 * Path to the directory containing the enrollment set.
+		 */
+		void
+		readRemovals(
+		    const std::string &enrollmentDirectory);
+
+		/**
+		 * @brief
+		 * Add the inverted lists of one RecordStore to
+		 * _prefilterLists.
+		 *
+		 * @param[in] path
+		 * Path to the RecordStore's inverted lists.
+		 * @param[in] first
+		 * Index into _candidateIDs of the RecordStore's first live
+		 * template. Its templates run through the end of
+		 * _candidateIDs.
+		 *
+		 * @note
+		 * Templates are added to _unindexedCandidates if `path` does
+		 * not exist.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * Error reading `path`.
+		 */
+		void
+		loadPrefilterLists(
+		    const std::string &path,
+		    const uint64_t first);
+
+		/**
+		 * @brief
+		 * Add the finger slabs of one RecordStore to _slabFiles.
+		 *
+		 * @param[in] path
+		 * Path to the RecordStore's finger slabs.
+		 * @param[in] first
+		 * Index into _candidateIDs of the RecordStore's first live
+		 * template. Its templates run through the end of
+		 * _candidateIDs.
+		 *
+		 * @note
+		 * Templates are added to _unslabbedCandidates if `path` does
+		 * not exist.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * Error reading `path`.
+		 */
+		void
+		loadFingerSlabs(
+		    const std::string &path,
+		    const uint64_t first);
+
+		/**
+		 * @brief
+		 * Obtain the names of every RecordStore searched for one
+		 * partition.
+		 *
+		 * @param[in] manifest
+		 * Layout of the enrollment set.
+		 * @param[in] partition
+		 * Partition number.
+		 *
+		 * @return
+		 * Names relative to the enrollment directory, base first,
+		 * then deltas in the order added.
+		 */
+		std::vector<std::string>
+		getRecordStoreNames(
+		    const EnrollmentManifest &manifest,
+		    const uint64_t partition)
+		    const;
+
+		/**
+		 * @brief
+		 * Read the layout of a finalized enrollment set.
+		 *
+		 * @param[in] enrollmentDirectory
+		 * Path to the directory containing the enrollment set.
+		 *
+		 * @return
+		 * Layout of the enrollment set.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * The manifest could not be read.
+		 */
+		EnrollmentManifest
+		readManifest(
+		    const std::string &enrollmentDirectory)
+		    const;
+
+		/**
+		 * @brief
+		 * Record the layout of a finalized enrollment set, along with
+		 * a human-readable report.
+		 *
+		 * @param[in] enrollmentDirectory
+		 * Path to the directory containing the enrollment set.
+		 * @param[in] manifest
+		 * Layout of the enrollment set.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * The manifest could not be written.
+		 */
+		void
+		writeManifest(
+		    const std::string &enrollmentDirectory,
+		    const EnrollmentManifest &manifest)
+		    const;
+
+		/**
+		 * @brief
+		 * Write stage one candidates for one search.
+		 * @details
+		 * Candidates are drawn from `this->_random`, which should be
+		 * seeded from `searchID` so results do not depend on which
+		 * process performs the search. Candidates below the shared
+		 * running threshold are not written. The threshold is raised
+		 * once `candidateListLength` candidates stage two keeps as
+		 * written, neither removed, hidden, nor aliased, are found.
+		 *
+		 * @param[in] searchID
+		 * ID of search template.
+		 * @param[in] stageOneDataDirectory
+		 * Directory in which to write candidates.
+		 *
+		 * @return
+		 * Number of candidates pruned by the running threshold.
+		 *
+		 * @throw BiometricEvaluation::Error::Exception
+		 * Error writing candidates.
+		 */
+		uint64_t
+		writeStageOneData(
+		    const std::string &searchID,
+		    const std::string &stageOneDataDirectory);
+
+		/**
+		 * @brief
+		 * Make a template of random data.
+		 * @details
+		 * Makes a TemplateContainer when structured templates are
+		 * configured, then encodes pre-filter keys.
+		 *
+		 * @param[out] tmpl
+		 * Template, `fingerLength` bytes of data per image.
+		 * @param[in] fingerLength
+		 * Bytes of `tmpl` per finger.
+		 * @param[in] images
+		 * Images from which `tmpl` is made.
+		 */
+		void
+		fillTemplate(
+		    BiometricEvaluation::Memory::uint8Array &tmpl,
+		    const uint64_t fingerLength,
+		    const std::vector<FingerImage> &images);
+
+		/**
+		 * @brief
+		 * Write the finger position and a coarse feature bin at the
+		 * start of each finger of a template.
+		 * @details
+		 * Bins are drawn from `this->_random`. Does nothing when the
+		 * pre-filter is disabled. Only the bin is written to a
+		 * TemplateContainer, whose directory holds the position.
+		 *
+		 * @param[in,out] tmpl
+		 * Template, `fingerLength` bytes per image.
+		 * @param[in] fingerLength
+		 * Bytes of `tmpl` per finger.
+		 * @param[in] images
+		 * Images from which `tmpl` was made.
+		 */
+		void
+		encodePrefilterKeys(
+		    BiometricEvaluation::Memory::uint8Array &tmpl,
+		    const uint64_t fingerLength,
+		    const std::vector<FingerImage> &images);
+
+		/**
+		 * @brief
+		 * Choose the enrolled templates a search must compare.
+		 * @details
+		 * Sets _filtered, and when set, _filteredCandidates, which
+		 * writeStageOneData() draws candidates from.
+		 *
+		 * @param[in] keys
+		 * Keys of every search finger.
+		 *
+		 * @return
+		 * Fraction of _candidateIDs that must be compared (1 when the
+		 * pre-filter is disabled).
+		 */
+		double
+		applyPrefilter(
+		    const std::vector<PrefilterIndex::Key> &keys);
+
+		/**
+		 * @brief
+		 * Restrict the templates chosen by applyPrefilter() to those
+		 * with a finger in slabs of the searched positions.
+		 *
+		 * @param[in] positions
+		 * Finger positions of the search, from
+		 * TemplateContainer::getPositions(). Empty or containing
+		 * Position::Unknown selects every slab.
+		 * @param[in] stream
+		 * Whether to read the selected slabs' data, setting
+		 * _slabBytesStreamed.
+		 *
+		 * @return
+		 * Fraction of _candidateIDs that must be compared.
+		 */
+		double
+		selectSlabs(
+		    const std::vector<uint8_t> &positions,
+		    const bool stream);
+
+		/**
+		 * @brief
+		 * Describe the results of a stage one search.
+		 *
+		 * @param[in] penetration
+		 * Value returned from selectSlabs().
+		 * @param[in] pruned
+		 * Candidates pruned by shared running thresholds.
+		 *
+		 * @return
+		 * Status of a successful search, with penetration and
+		 * pruned candidates when applicable.
+		 */
+		ReturnStatus
+		getStageOneStatus(
+		    const double penetration,
+		    const uint64_t pruned)
+		    const;
+
+		/**
+		 * @brief
+		 * Allocate and touch the configured resident memory.
+		 * @details
+		 * Called from init methods, so the memory is shared
+		 * copy-on-write with fork()ed processes.
+		 */
+		void
+		allocateMemory();
+
+		/**
+		 * @brief
+		 * Simulate the cost of a matcher's API call.
+		 * @details
+		 * Consumes `cpuMicroseconds` of CPU time while repeatedly
+		 * writing the configured working memory, then decides whether
+		 * the call fails based on the configured failure percentage.
+		 * When parallel and helpers were started, each thread scans an
+		 * equal share of the partition: a share of the CPU time and a
+		 * slice of the working memory.
+		 *
+		 * @param[in] cpuMicroseconds
+		 * CPU time to consume, across all threads.
+		 * @param[in] parallel
+		 * Whether the call may use helper threads.
+		 *
+		 * @return
+		 * true if the simulated call should fail, false otherwise.
+		 */
+		bool
+		simulateCall(
+		    const uint64_t cpuMicroseconds,
+		    const bool parallel);
 	};
 }
 
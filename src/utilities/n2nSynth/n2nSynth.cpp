@@ -0,0 +1,296 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+/*******************************************************************************
+ * Generate RecordStores of synthetic ANSI/NIST-ITL files and templates so the *
+ * validation drivers can be benchmarked at arbitrary scale.                   *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <be_error.h>
+#include <be_io_recordstore.h>
+#include <be_text.h>
+
+namespace BE = BiometricEvaluation;
+
+/** Kinds of records that can be generated */
+enum class Kind
+{
+	/** ANSI/NIST-ITL files of plain captures */
+	Capture,
+	/** ANSI/NIST-ITL files of single latent impressions */
+	Latent,
+	/** Random bytes, in lieu of templates */
+	Templates
+};
+
+/** Fields (without the length field) of a tagged ANSI/NIST-ITL record */
+using Fields = std::vector<std::pair<uint16_t, std::string>>;
+
+/**
+ * @brief
+ * Serialize one tagged ANSI/NIST-ITL record.
+ *
+ * @param[in] type
+ * Record type.
+ * @param[in] fields
+ * Field numbers and values, in order, excluding field 1 (LEN).
+ *
+ * @return
+ * Record, including a correct LEN field.
+ */
+std::string
+makeTaggedRecord(
+    const uint16_t type,
+    const Fields &fields);
+
+/**
+ * @brief
+ * Make an ANSI/NIST-ITL file of uncompressed, synthetic friction ridges.
+ *
+ * @param[in] tcn
+ * Transaction control number.
+ * @param[in] kind
+ * Kind::Capture or Kind::Latent.
+ * @param[in] fingers
+ * Number of Type-14 records.
+ * @param[in] width
+ * Width of each image.
+ * @param[in] height
+ * Height of each image.
+ * @param[in] rng
+ * Random number generator.
+ *
+ * @return
+ * ANSI/NIST-ITL file.
+ */
+std::string
+makeAN2K(
+    const std::string &tcn,
+    const Kind kind,
+    const uint8_t fingers,
+    const uint32_t width,
+    const uint32_t height,
+    std::mt19937_64 &rng);
+
+int
+main(
+    int argc,
+    char *argv[])
+{
+	static const std::string usage{"Usage: " + std::string(argv[0]) +
+	    " capture <output.rs> <count> [<fingers> [<width> <height>]]\n"
+	    "       " + std::string(argv[0]) + " latent <output.rs> <count> "
+	    "[<width> <height>]\n"
+	    "       " + std::string(argv[0]) + " templates <output.rs> "
+	    "<count> <size>"};
+
+	if (argc < 4) {
+		std::cerr << usage << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	Kind kind{};
+	const std::string command{argv[1]};
+	if (command == "capture")
+		kind = Kind::Capture;
+	else if (command == "latent")
+		kind = Kind::Latent;
+	else if (command == "templates")
+		kind = Kind::Templates;
+	else {
+		std::cerr << usage << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	const std::string rsPath{argv[2]};
+	uint64_t count{};
+	uint8_t fingers{kind == Kind::Latent ? uint8_t(1) : uint8_t(10)};
+	uint32_t width{512}, height{512};
+	uint64_t templateSize{};
+	try {
+		count = std::stoull(argv[3]);
+		switch (kind) {
+		case Kind::Capture:
+			if (argc > 4)
+				fingers = std::stoul(argv[4]);
+			if (argc > 6) {
+				width = std::stoul(argv[5]);
+				height = std::stoul(argv[6]);
+			}
+			if ((fingers == 0) || (fingers > 10))
+				throw std::out_of_range("fingers");
+			break;
+		case Kind::Latent:
+			if (argc > 5) {
+				width = std::stoul(argv[4]);
+				height = std::stoul(argv[5]);
+			}
+			break;
+		case Kind::Templates:
+			if (argc != 5)
+				throw std::invalid_argument("size");
+			templateSize = std::stoull(argv[4]);
+			break;
+		}
+		if ((width == 0) || (height == 0))
+			throw std::out_of_range("dimensions");
+	} catch (const std::exception &) {
+		std::cerr << usage << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	/* Keys are unique per RecordStore name, so stores can be mixed */
+	std::string keyPrefix{BE::Text::basename(rsPath)};
+	if ((keyPrefix.size() > 3) &&
+	    (keyPrefix.substr(keyPrefix.size() - 3) == ".rs"))
+		keyPrefix.erase(keyPrefix.size() - 3);
+
+	std::mt19937_64 rng{count};
+	try {
+		const auto rs = BE::IO::RecordStore::createRecordStore(rsPath,
+		    "Synthetic " + command + " records",
+		    BE::IO::RecordStore::Kind::Default);
+
+		std::string record{};
+		for (uint64_t i{0}; i < count; ++i) {
+			std::ostringstream key{};
+			key << keyPrefix << '_' << std::setw(8) <<
+			    std::setfill('0') << i;
+
+			switch (kind) {
+			case Kind::Capture:
+				/* FALLTHROUGH */
+			case Kind::Latent:
+				key << ".an2";
+				record = makeAN2K(key.str(), kind, fingers,
+				    width, height, rng);
+				break;
+			case Kind::Templates:
+				record.resize(templateSize);
+				for (auto &c : record)
+					c = static_cast<char>(rng());
+				break;
+			}
+
+			rs->insert(key.str(), record.data(), record.size());
+		}
+		rs->sync();
+	} catch (const BE::Error::Exception &e) {
+		std::cerr << "Could not create " << rsPath << " (" <<
+		    e.whatString() << ")" << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	return (EXIT_SUCCESS);
+}
+
+std::string
+makeTaggedRecord(
+    const uint16_t type,
+    const Fields &fields)
+{
+	/* ANSI/NIST-ITL information and file separators */
+	static const char GS{0x1D};
+	static const char FS{0x1C};
+
+	std::string body{};
+	for (const auto &field : fields) {
+		std::ostringstream tag{};
+		tag << GS << type << '.' << std::setw(3) << std::setfill('0') <<
+		    field.first << ':';
+		body += tag.str() + field.second;
+	}
+	body += FS;
+
+	/* LEN counts itself, so iterate until its width is stable */
+	const std::string lenTag{std::to_string(type) + ".001:"};
+	uint64_t length{lenTag.size() + body.size()};
+	while (lenTag.size() + std::to_string(length).size() + body.size() !=
+	    length)
+		length = lenTag.size() + std::to_string(length).size() +
+		    body.size();
+
+	return (lenTag + std::to_string(length) + body);
+}
+
+std::string
+makeAN2K(
+    const std::string &tcn,
+    const Kind kind,
+    const uint8_t fingers,
+    const uint32_t width,
+    const uint32_t height,
+    std::mt19937_64 &rng)
+{
+	static const char RS{0x1E};
+	static const char US{0x1F};
+	static constexpr double Pi{3.14159265358979323846};
+
+	std::uniform_real_distribution<double> angle{0, Pi};
+	std::uniform_real_distribution<double> period{7, 11};
+	std::uniform_int_distribution<int> noise{-20, 20};
+
+	/* Type-1 content field lists every other record */
+	std::ostringstream cnt{};
+	cnt << "1" << US << std::to_string(fingers + 1) << RS << "2" << US <<
+	    "00";
+	for (uint8_t f{1}; f <= fingers; ++f)
+		cnt << RS << "14" << US << std::setw(2) << std::setfill('0') <<
+		    std::to_string(f);
+
+	std::string an2k{makeTaggedRecord(1, {
+	    {2, "0400"}, {3, cnt.str()}, {4, "N2N"}, {5, "20200101"},
+	    {7, "N2N"}, {8, "N2N"}, {9, tcn}, {11, "00.00"}, {12, "00.00"}})};
+	an2k += makeTaggedRecord(2, {{2, "00"}});
+
+	std::string pixels(static_cast<uint64_t>(width) * height, '\0');
+	for (uint8_t f{1}; f <= fingers; ++f) {
+		/* Oriented sinusoid resembles a ridge pattern */
+		const double theta{angle(rng)};
+		const double frequency{2 * Pi / period(rng)};
+		const double c{std::cos(theta)}, s{std::sin(theta)};
+		for (uint32_t y{0}; y < height; ++y) {
+			for (uint32_t x{0}; x < width; ++x) {
+				const int value{128 + static_cast<int>(100 *
+				    std::sin(frequency * ((x * c) + (y * s))))
+				    + noise(rng)};
+				pixels[(static_cast<uint64_t>(y) * width) + x] =
+				    static_cast<char>(std::max(0,
+				    std::min(255, value)));
+			}
+		}
+
+		std::ostringstream idc{};
+		idc << std::setw(2) << std::setfill('0') << std::to_string(f);
+		an2k += makeTaggedRecord(14, {
+		    {2, idc.str()},
+		    /* 0 == live-scan plain, 4 == latent impression */
+		    {3, kind == Kind::Latent ? "4" : "0"},
+		    {4, "N2N"}, {5, "20200101"},
+		    {6, std::to_string(width)}, {7, std::to_string(height)},
+		    {8, "1"}, {9, "500"}, {10, "500"}, {11, "NONE"},
+		    {12, "8"},
+		    {13, kind == Kind::Latent ? "0" : std::to_string(f)},
+		    {999, pixels}});
+	}
+
+	return (an2k);
+}
@@ -0,0 +1,166 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_API_H_
+#define N2NV_API_H_
+
+#include <exception>
+#include <memory>
+
+#include <be_error.h>
+#include <be_error_signal_manager.h>
+#include <be_framework_api.h>
+#include <be_time_timer.h>
+#include <be_time_watchdog.h>
+
+namespace BE = BiometricEvaluation;
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Time an API call, guarded by a watchdog and signal handler.
+		 * @details
+		 * Behaves like BE::Framework::API, but the operation is a
+		 * template parameter instead of a std::function. Lambdas are
+		 * called directly, so nothing is allocated and there is no
+		 * indirect call inside the timed region.
+		 */
+		template<typename T>
+		class API
+		{
+		public:
+			/** Result of call(), identical to BE::Framework::API */
+			using Result = typename BE::Framework::API<T>::Result;
+
+			/** Constructor */
+			API() :
+			    _timer{std::make_shared<BE::Time::Timer>()},
+			    _watchdog{std::make_shared<BE::Time::Watchdog>(
+			        BE::Time::Watchdog::REALTIME)},
+			    _signalManager{
+			        std::make_shared<BE::Error::SignalManager>()}
+			{
+
+			}
+
+			/** @return Watchdog guarding each call */
+			std::shared_ptr<BE::Time::Watchdog>
+			getWatchdog()
+			    const
+			{
+				return (this->_watchdog);
+			}
+
+			/** @return Timer timing each call */
+			std::shared_ptr<BE::Time::Timer>
+			getTimer()
+			    const
+			{
+				return (this->_timer);
+			}
+
+			/** @return Signal manager guarding each call */
+			std::shared_ptr<BE::Error::SignalManager>
+			getSignalManager()
+			    const
+			{
+				return (this->_signalManager);
+			}
+
+			/**
+			 * @brief
+			 * Call and time an operation.
+			 *
+			 * @param[in] operation
+			 * Callable taking no arguments and returning T.
+			 *
+			 * @return
+			 * Result of the call. `elapsed` is only set when
+			 * `currentState` is Completed.
+			 */
+			template<typename Operation>
+			Result
+			call(
+			    Operation &&operation)
+			{
+				/* Dereference before the timed region */
+				BE::Time::Timer *const timer{this->_timer.get()};
+				BE::Time::Watchdog *const watchdog{
+				    this->_watchdog.get()};
+				BE::Error::SignalManager *const signalManager{
+				    this->_signalManager.get()};
+
+				Result result{};
+				result.currentState = BE::Framework::
+				    APICurrentState::WaitingOnMain;
+				try {
+					BEGIN_SIGNAL_BLOCK(signalManager,
+					    api_signal_block);
+					BEGIN_WATCHDOG_BLOCK(watchdog,
+					    api_watchdog_block);
+					timer->start();
+					result.status = operation();
+					timer->stop();
+					result.currentState = BE::Framework::
+					    APICurrentState::Completed;
+					END_WATCHDOG_BLOCK(watchdog,
+					    api_watchdog_block);
+					END_SIGNAL_BLOCK(signalManager,
+					    api_signal_block);
+				} catch (const BE::Error::Exception &e) {
+					watchdog->stop();
+					signalManager->stop();
+					result.currentState = BE::Framework::
+					    APICurrentState::ExceptionCaught;
+					result.exceptionString = e.whatString();
+				} catch (const std::exception &e) {
+					watchdog->stop();
+					signalManager->stop();
+					result.currentState = BE::Framework::
+					    APICurrentState::ExceptionCaught;
+					result.exceptionString = e.what();
+				} catch (...) {
+					watchdog->stop();
+					signalManager->stop();
+					result.currentState = BE::Framework::
+					    APICurrentState::ExceptionCaught;
+				}
+
+				if (watchdog->expired())
+					result.currentState = BE::Framework::
+					    APICurrentState::TimeoutExpired;
+				else if (signalManager->sigHandled())
+					result.currentState = BE::Framework::
+					    APICurrentState::SignalCaught;
+
+				if (result.currentState ==
+				    BE::Framework::APICurrentState::Completed)
+					result.elapsed = timer->elapsed();
+
+				return (result);
+			}
+
+		private:
+			/** Timer for each call */
+			const std::shared_ptr<BE::Time::Timer> _timer;
+			/** Watchdog for each call */
+			const std::shared_ptr<BE::Time::Watchdog> _watchdog;
+			/** Signal handler for each call */
+			const std::shared_ptr<BE::Error::SignalManager>
+			    _signalManager;
+		};
+	}
+}
+
+#endif /* N2NV_API_H_ */
@@ -9,19 +9,50 @@
  */
 
 #include <cmath>
+#include <iomanip>
 #include <iostream>
 
 #include <be_error.h>
 #include <be_framework_api.h>
 #include <be_io_propertiesfile.h>
 #include <be_io_utility.h>
+#include <be_text.h>
 #include <be_time.h>
 
+#include <n2nv_api.h>
 #include <n2nv_finalize.h>
 
 namespace BE = BiometricEvaluation;
 using namespace BE::Framework::Enumeration;
 
+/**
+ * @brief
+ * Print one line describing a change to the enrollment set.
+ *
+ * @param[in] operation
+ * Name of method called.
+ * @param[in] count
+ * Number of templates passed to `operation`.
+ * @param[in] result
+ * Result of calling `operation`.
+ */
+static void
+printUpdateResult(
+    const std::string &operation,
+    const uint64_t count,
+    const N2N::Validation::API<N2N::ReturnStatus>::Result &result)
+{
+	std::cout << operation << " " << count << " " << result.elapsed << " " <<
+	    std::to_string(to_int_type(result.currentState)) << " ";
+	if (result)
+		std::cout << std::to_string(static_cast<
+		    std::underlying_type<N2N::StatusCode>::type>(
+		    result.status.code)) << " [<[" << result.status.info <<
+		    "]>]" << std::endl;
+	else
+		std::cout << "NA [<[]>]" << std::endl;
+}
+
 N2N::Validation::Finalize::Arguments
 N2N::Validation::Finalize::procargs(
     int argc,
@@ -32,8 +63,14 @@ N2N::Validation::Finalize::procargs(
 	static const std::string EnrollmentRSKey{"Enrollment RecordStore"};
 	static const std::string NumNodesKey{"Number of Nodes"};
 	static const std::string RAMPerNodeKey{"RAM Per Node"};
+	static const std::string DeltaRSKey{"Enrollment Delta RecordStore"};
+	static const std::string CompareRebuildKey{"Compare Full Rebuild"};
+	static const std::string DeleteListKey{"Delete List"};
 
 	static const std::string NumNodesKeyDefault{"1"};
+	static const std::string DeltaRSKeyDefault{""};
+	static const std::string CompareRebuildKeyDefault{"No"};
+	static const std::string DeleteListKeyDefault{""};
 
 	static const std::string usage{"Usage: " + std::string(argv[0]) + " "
 	    "<properties.conf>\n\nRequired properties:\n"
@@ -44,6 +81,14 @@ N2N::Validation::Finalize::procargs(
    	    "\nOptional properties:\n"
        	    "\t * " + NumNodesKey + " = [1-255] (default: " +
        	        NumNodesKeyDefault + ")\n"
+	    "\t * " + DeltaRSKey + " = /path/to/directory: add to the "
+	    "existing " + EnrollmentDirKey + " (default: none)\n"
+	    "\t * " + CompareRebuildKey + " = Yes, No: also finalize " +
+	    EnrollmentRSKey + " and " + DeltaRSKey + " from scratch "
+	    "(default: " + CompareRebuildKeyDefault + ")\n"
+	    "\t * " + DeleteListKey + " = /path/to/file of IDs to remove "
+	    "from the existing " + EnrollmentDirKey + ", one per line "
+	    "(default: none)\n"
 	};
 
 	Finalize::Arguments args;
@@ -54,7 +99,10 @@ N2N::Validation::Finalize::procargs(
 	try {
 		props.reset(new BE::IO::PropertiesFile(
 		    argv[1], BE::IO::Mode::ReadOnly,
-		    {{NumNodesKey, NumNodesKeyDefault}}));
+		    {{NumNodesKey, NumNodesKeyDefault},
+		    {DeltaRSKey, DeltaRSKeyDefault},
+		    {CompareRebuildKey, CompareRebuildKeyDefault},
+		    {DeleteListKey, DeleteListKeyDefault}}));
 	} catch (const BE::Error::Exception &e) {
 		throw BE::Error::StrategyError("Could not open \"" +
 		    std::string(argv[1]) + "\" (" + e.whatString() + ")");
@@ -72,6 +120,30 @@ N2N::Validation::Finalize::procargs(
 		    ConfigDirKey + "\" (" + args.configDir + ") does not "
 		    "exist");
 
+	/* Delta RecordStore (has default value) */
+	args.deltaRSPath = props->getProperty(DeltaRSKey);
+	args.compareFullRebuild = props->getPropertyAsBoolean(
+	    CompareRebuildKey);
+	if (!args.deltaRSPath.empty()) {
+		try {
+			volatile auto const rs =
+			    BE::IO::RecordStore::openRecordStore(
+			    args.deltaRSPath);
+		} catch (const BE::Error::Exception &e) {
+			throw BE::Error::StrategyError("Could not open "
+			    "RecordStore for property \"" + DeltaRSKey + "\" (" +
+			    args.deltaRSPath + "): " + e.whatString());
+		}
+	}
+
+	/* Delete list (has default value) */
+	args.deleteListPath = props->getProperty(DeleteListKey);
+	if (!args.deleteListPath.empty() &&
+	    !BE::IO::Utility::fileExists(args.deleteListPath))
+		throw BE::Error::StrategyError("File for property \"" +
+		    DeleteListKey + "\" (" + args.deleteListPath + ") does "
+		    "not exist");
+
 	/* Enrollment directory */
 	try {
 		args.enrollDir = props->getProperty(EnrollmentDirKey);
@@ -79,7 +151,12 @@ N2N::Validation::Finalize::procargs(
 		throw BE::Error::StrategyError("Missing property: " +
 		    EnrollmentDirKey + '\n' + usage);
 	}
-	if (BE::IO::Utility::fileExists(args.enrollDir) ||
+	if (!args.deltaRSPath.empty() || !args.deleteListPath.empty()) {
+		if (!BE::IO::Utility::pathIsDirectory(args.enrollDir))
+			throw BE::Error::StrategyError("Directory for property "
+			    "\"" + EnrollmentDirKey + "\" (" + args.enrollDir +
+			    ") does not exist");
+	} else if (BE::IO::Utility::fileExists(args.enrollDir) ||
 	    BE::IO::Utility::pathIsDirectory(args.enrollDir)) {
 		throw BE::Error::StrategyError("Directory for property \"" +
 		    EnrollmentDirKey + "\" (" + args.enrollDir + ") already "
@@ -133,6 +210,19 @@ int
 N2N::Validation::Finalize::run(
     const N2N::Validation::Finalize::Arguments &args)
 {
+	/* Change an existing enrollment set */
+	if (!args.deltaRSPath.empty() || !args.deleteListPath.empty()) {
+		std::cout << "Operation Templates Time State StatusCode "
+		    "Info\n";
+		int status{static_cast<int>(StatusCode::Success)};
+		if (!args.deltaRSPath.empty())
+			status = runIncremental(args);
+		if ((status == static_cast<int>(StatusCode::Success)) &&
+		    !args.deleteListPath.empty())
+			status = runRemoval(args);
+		return (status);
+	}
+
 	/* Make enrollment directory */
 	if (BE::IO::Utility::makePath(args.enrollDir, S_IRWXU | S_IRWXG) != 0)
 		throw BE::Error::StrategyError("Could not create enrollment "
@@ -151,11 +241,11 @@ N2N::Validation::Finalize::run(
 	/* Be gracious with time during validation */
 	constexpr uint64_t NintyMinutesAsMicroseconds{120u * 60u *
 	    BE::Time::MicrosecondsPerSecond};
-	BE::Framework::API<N2N::ReturnStatus> api{};
+	N2N::Validation::API<N2N::ReturnStatus> api{};
 	api.getWatchdog()->setInterval(std::ceil(rs->getCount() / 1000000.0) *
 	    NintyMinutesAsMicroseconds);
 
-	BE::Framework::API<N2N::ReturnStatus>::Result result{};
+	N2N::Validation::API<N2N::ReturnStatus>::Result result{};
 	const auto lib = N2N::Interface::getImplementation();
 	std::cout << "NumNodes RAMPerNode Time State StatusCode Info\n";
 
@@ -203,6 +293,127 @@ N2N::Validation::Finalize::run(
 	    result.status.code));
 }
 
+int
+N2N::Validation::Finalize::runIncremental(
+    const N2N::Validation::Finalize::Arguments &args)
+{
+	std::shared_ptr<BE::IO::RecordStore> deltaRS;
+	try {
+		deltaRS = BE::IO::RecordStore::openRecordStore(
+		    args.deltaRSPath);
+	} catch (BE::Error::Exception &e) {
+		throw BE::Error::StrategyError("Failed to open RecordStore (" +
+		    args.deltaRSPath + "): " + e.whatString());
+	}
+
+	/* Same allowance as finalizeEnrollment() */
+	constexpr uint64_t NintyMinutesAsMicroseconds{120u * 60u *
+	    BE::Time::MicrosecondsPerSecond};
+	N2N::Validation::API<N2N::ReturnStatus> api{};
+	const auto lib = N2N::Interface::getImplementation();
+
+	api.getWatchdog()->setInterval(std::ceil(deltaRS->getCount() /
+	    1000000.0) * NintyMinutesAsMicroseconds);
+	const auto result = api.call([&]() -> N2N::ReturnStatus {
+		return (lib->addToEnrollment(args.configDir, args.enrollDir,
+		    args.RAMPerNode, *deltaRS));
+	});
+	printUpdateResult("addToEnrollment", deltaRS->getCount(), result);
+	if (!result)
+		throw BE::Error::StrategyError("Exceptional condition "
+		    "encountered during addToEnrollment()");
+	if ((result.status.code != StatusCode::Success) ||
+	    !args.compareFullRebuild)
+		return (static_cast<std::underlying_type<N2N::StatusCode>::type>(
+		    result.status.code));
+
+	/* Finalize every template from scratch, beside the enrollment set */
+	const std::string rebuildRSPath{args.enrollDir + ".rebuild_templates"};
+	const std::string rebuildDir{args.enrollDir + ".rebuild"};
+	std::shared_ptr<BE::IO::RecordStore> rebuildRS;
+	try {
+		BE::IO::RecordStore::mergeRecordStores(rebuildRSPath,
+		    "Enrollment and delta templates",
+		    BE::IO::RecordStore::Kind::Default,
+		    {args.enrollRSPath, args.deltaRSPath});
+		rebuildRS = BE::IO::RecordStore::openRecordStore(rebuildRSPath);
+	} catch (BE::Error::Exception &e) {
+		throw BE::Error::StrategyError("Could not combine enrollment "
+		    "and delta templates: " + e.whatString());
+	}
+	if (BE::IO::Utility::makePath(rebuildDir, S_IRWXU | S_IRWXG) != 0)
+		throw BE::Error::StrategyError("Could not create rebuild "
+		    "directory (" + rebuildDir + "): " + BE::Error::errorStr());
+
+	api.getWatchdog()->setInterval(std::ceil(rebuildRS->getCount() /
+	    1000000.0) * NintyMinutesAsMicroseconds);
+	const auto rebuild = api.call([&]() -> N2N::ReturnStatus {
+		return (lib->finalizeEnrollment(args.configDir, rebuildDir,
+		    args.numberOfNodes, args.RAMPerNode, *rebuildRS));
+	});
+	printUpdateResult("finalizeEnrollment", rebuildRS->getCount(), rebuild);
+
+	try {
+		BE::IO::Utility::removeDirectory(rebuildDir);
+		rebuildRS.reset();
+		BE::IO::RecordStore::removeRecordStore(rebuildRSPath);
+	} catch (BE::Error::Exception &e) {
+		std::cerr << "Could not remove rebuild data: " <<
+		    e.whatString() << std::endl;
+	}
+
+	if (rebuild && (rebuild.status.code == StatusCode::Success) &&
+	    (rebuild.elapsed > 0)) {
+		const int64_t saved{static_cast<int64_t>(rebuild.elapsed) -
+		    static_cast<int64_t>(result.elapsed)};
+		std::cout << "Saved " << saved << " microseconds (" <<
+		    std::fixed << std::setprecision(1) << ((100.0 * saved) /
+		    rebuild.elapsed) << "% of full rebuild)" << std::endl;
+	}
+
+	return (static_cast<std::underlying_type<N2N::StatusCode>::type>(
+	    result.status.code));
+}
+
+int
+N2N::Validation::Finalize::runRemoval(
+    const N2N::Validation::Finalize::Arguments &args)
+{
+	std::vector<std::string> ids{};
+	try {
+		for (const auto &line : BE::Text::split(
+		    BE::IO::Utility::readFileAsString(args.deleteListPath),
+		    '\n')) {
+			const auto id = BE::Text::trimWhitespace(line);
+			if (!id.empty())
+				ids.push_back(id);
+		}
+	} catch (BE::Error::Exception &e) {
+		throw BE::Error::StrategyError("Could not read delete list (" +
+		    args.deleteListPath + "): " + e.whatString());
+	}
+
+	/* Same allowance as finalizeEnrollment() */
+	constexpr uint64_t NintyMinutesAsMicroseconds{120u * 60u *
+	    BE::Time::MicrosecondsPerSecond};
+	N2N::Validation::API<N2N::ReturnStatus> api{};
+	api.getWatchdog()->setInterval(std::ceil(ids.size() / 1000000.0) *
+	    NintyMinutesAsMicroseconds);
+
+	const auto lib = N2N::Interface::getImplementation();
+	const auto result = api.call([&]() -> N2N::ReturnStatus {
+		return (lib->removeFromEnrollment(args.configDir,
+		    args.enrollDir, ids));
+	});
+	printUpdateResult("removeFromEnrollment", ids.size(), result);
+	if (!result)
+		throw BE::Error::StrategyError("Exceptional condition "
+		    "encountered during removeFromEnrollment()");
+
+	return (static_cast<std::underlying_type<N2N::StatusCode>::type>(
+	    result.status.code));
+}
+
 int
 main(
     int argc,
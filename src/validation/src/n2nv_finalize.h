@@ -33,6 +33,21 @@ namespace N2N
 				std::string enrollDir{};
 				/** Path to enrollment template RecordStore */
 				std::string enrollRSPath{};
+				/**
+				 * Path to RecordStore of templates to add to an
+				 * existing enrollment set (optional).
+				 */
+				std::string deltaRSPath{};
+				/**
+				 * Whether to also finalize enrollRSPath and
+				 * deltaRSPath from scratch, to compare times.
+				 */
+				bool compareFullRebuild{false};
+				/**
+				 * Path to file of IDs to remove from an
+				 * existing enrollment set (optional).
+				 */
+				std::string deleteListPath{};
 
 				/** Kibibytes of RAM per node */
 				uint64_t RAMPerNode;
@@ -74,6 +89,38 @@ namespace N2N
 			int
 			run(
 			    const Arguments &args);
+
+			/**
+			 * @brief
+			 * Add templates to a finalized enrollment set.
+			 * @details
+			 * Optionally finalizes the original and added
+			 * templates from scratch, and reports the time saved.
+			 *
+			 * @param[in] args
+			 * Arguments parsed from procargs().
+			 *
+			 * @return
+			 * Return status to be returned from main().
+			 */
+			int
+			runIncremental(
+			    const Arguments &args);
+
+			/**
+			 * @brief
+			 * Remove the templates in a delete list from a
+			 * finalized enrollment set.
+			 *
+			 * @param[in] args
+			 * Arguments parsed from procargs().
+			 *
+			 * @return
+			 * Return status to be returned from main().
+			 */
+			int
+			runRemoval(
+			    const Arguments &args);
 		}
 	}
 }
@@ -11,20 +11,55 @@
 
 #include <sys/stat.h>
 
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <limits>
+#include <thread>
 
 #include <n2nv_identStageOne.h>
+#include <n2nv_network.h>
 
 #include <be_error.h>
 #include <be_io_propertiesfile.h>
 #include <be_io_utility.h>
 #include <be_memory.h>
 #include <be_text.h>
+#include <be_time_timer.h>
 
 using namespace BiometricEvaluation::Framework::Enumeration;
 
 const std::string N2N::Validation::IdentStageOne::ProcessWorker::LogPathParam{
     "_log"};
+const std::string
+    N2N::Validation::IdentStageOne::ProcessWorker::LatencyPathParam{"_latency"};
+const std::string
+    N2N::Validation::IdentStageOne::ProcessWorker::GroupLogPathParam{
+    "_groupLog"};
+
+/**
+ * @brief
+ * Path where a node writes the merged latencies of its processes.
+ *
+ * @param[in] args
+ * Arguments parsed from procargs().
+ * @param[in] nodeNumber
+ * Node number.
+ *
+ * @return
+ * Path to latency file for `nodeNumber`.
+ */
+static std::string
+getNodeLatencyPath(
+    const N2N::Validation::IdentStageOne::Arguments &args,
+    const uint8_t nodeNumber)
+{
+	return (args.outputDirectory + '/' + args.prefix +
+	    std::to_string(nodeNumber) + ".latency");
+}
 
 static std::string
 escapeNewlines(
@@ -51,13 +86,49 @@ N2N::Validation::IdentStageOne::procargs(
 	static const std::string NumProcessesKey{"Number of Processes"};
 	static const std::string SearchRSPathKey{"Search Template RecordStore"};
 	static const std::string StageOneDataRootKey{"Stage One Data Root"};
+	static const std::string ModeKey{"Mode"};
+	static const std::string CoordinatorAddressKey{"Coordinator Address"};
+	static const std::string LaunchLocalAgentsKey{"Launch Local Agents"};
+	static const std::string NodeNumberKey{"Node Number"};
+	static const std::string LatencySummaryKey{"Latency Summary"};
+	static const std::string TracePathKey{"Trace Path"};
+	static const std::string AdaptiveTimeoutKey{
+	    "Adaptive Timeout Multiplier"};
+	static const std::string SpeculationKey{"Speculation Multiplier"};
+	static const std::string PrefaultKey{"Prefault Memory"};
+	static const std::string PrefetchDepthKey{"Prefetch Depth"};
+	static const std::string AsyncWriteDepthKey{
+	    "Asynchronous Write Depth"};
+	static const std::string RAMPerNodeKey{"RAM Per Node"};
+	static const std::string ThreadsPerProcessKey{"Threads Per Process"};
+	static const std::string GroupDelimiterKey{"Search Group Delimiter"};
+	static const std::string CandidateListLengthKey{
+	    "Candidate List Length"};
+	static const std::string ShareThresholdsKey{"Share Search Thresholds"};
 
 	static const std::string SearchTemplateTypeValueLatent{"Latent"};
 	static const std::string SearchTemplateValueCapture{"Capture"};
+	static const std::string ModeValueLocal{"Local"};
+	static const std::string ModeValueCoordinator{"Coordinator"};
+	static const std::string ModeValueAgent{"Agent"};
 
 	static const std::string NumProcessesDefault{"1"};
 	static const std::string PrefixDefault{""};
 	static const std::string OutputDirDefault{"."};
+	static const std::string ModeDefault{ModeValueLocal};
+	static const std::string LaunchLocalAgentsDefault{"No"};
+	static const std::string LatencySummaryDefault{""};
+	static const std::string TracePathDefault{""};
+	static const std::string AdaptiveTimeoutDefault{"0"};
+	static const std::string SpeculationDefault{"0"};
+	static const std::string PrefaultDefault{"No"};
+	static const std::string PrefetchDepthDefault{"0"};
+	static const std::string AsyncWriteDepthDefault{"0"};
+	static const std::string RAMPerNodeDefault{"0"};
+	static const std::string ThreadsPerProcessDefault{"1"};
+	static const std::string GroupDelimiterDefault{""};
+	static const std::string CandidateListLengthDefault{"100"};
+	static const std::string ShareThresholdsDefault{"No"};
 
 	static const std::string usage{"Usage: " + std::string(argv[0]) + " "
 	    "<properties.conf>\n\nRequired properties:\n"
@@ -74,7 +145,49 @@ N2N::Validation::IdentStageOne::procargs(
 	    NumProcessesDefault + ")\n"
  	    "\t * " + PrefixKey + " = (default: " + PrefixDefault + ")\n"
 	    "\t * " + OutputDirKey + " = /path/to/directory (default: " +
-	    OutputDirDefault + ")"
+	    OutputDirDefault + ")\n"
+	    "\t * " + ModeKey + " = " + ModeValueLocal + ", " +
+	    ModeValueCoordinator + ", " + ModeValueAgent + " (default: " +
+	    ModeDefault + ")\n"
+	    "\t * " + LatencySummaryKey + " = /path/to/summary.json (default: "
+	    "none)\n"
+	    "\t * " + TracePathKey + " = /path/to/trace.json (default: none)\n"
+	    "\t * " + AdaptiveTimeoutKey + " = multiple of P99 latency before "
+	    "timeout, 0 for 5 minutes (default: " + AdaptiveTimeoutDefault +
+	    ")\n"
+	    "\t * " + SpeculationKey + " = multiple of P50 latency before "
+	    "searching again, 0 to disable (default: " + SpeculationDefault +
+	    ")\n"
+	    "\t * " + PrefaultKey + " = Yes, No: touch inherited memory "
+	    "before searching (default: " + PrefaultDefault + ")\n"
+	    "\t * " + PrefetchDepthKey + " = searches each process reads "
+	    "ahead on a helper thread, 0 to disable (default: " +
+	    PrefetchDepthDefault + ")\n"
+	    "\t * " + AsyncWriteDepthKey + " = [0,256]: stage one files each "
+	    "process writes at once for the implementation, 0 to disable "
+	    "(default: " + AsyncWriteDepthDefault + ")\n"
+	    "\t * " + RAMPerNodeKey + " = KiB each node's processes may use "
+	    "together, 0 for no limit (default: " + RAMPerNodeDefault + ")\n"
+	    "\t * " + ThreadsPerProcessKey + " = threads each search may use; "
+	    "times " + NumProcessesKey + ", at most the processors, or 0 to "
+	    "divide the processors (default: " + ThreadsPerProcessDefault +
+	    ")\n"
+	    "\t * " + GroupDelimiterKey + " = text ending the group ID in "
+	    "search keys; each group is searched in one call (default: "
+	    "none)\n"
+	    "\t * " + CandidateListLengthKey + " = [1,100]: candidates "
+	    "requested per search (default: " + CandidateListLengthDefault +
+	    ")\n"
+	    "\t * " + ShareThresholdsKey + " = Yes, No: share each search's "
+	    "running threshold between nodes (" + ModeValueLocal + " only, "
+	    "default: " + ShareThresholdsDefault + ")\n"
+	    "\nCoordinator and Agent properties:\n"
+	    "\t * " + CoordinatorAddressKey + " = unix:/path/to/socket, "
+	    "tcp:host:port\n"
+	    "\t * " + LaunchLocalAgentsKey + " = Yes, No (Coordinator only, "
+	    "default: " + LaunchLocalAgentsDefault + ")\n"
+	    "\t * " + NodeNumberKey + " = [0,254] (Agent only, replaces " +
+	    NumNodesKey + " and " + SearchRSPathKey + ")"
 	};
 
 	IdentStageOne::Arguments args{};
@@ -85,12 +198,64 @@ N2N::Validation::IdentStageOne::procargs(
 	try {
 		props.reset(new BE::IO::PropertiesFile(
 		    argv[1], BE::IO::Mode::ReadOnly, {
-		    {NumProcessesKey, NumProcessesDefault}}));
+		    {NumProcessesKey, NumProcessesDefault},
+		    {ModeKey, ModeDefault},
+		    {LaunchLocalAgentsKey, LaunchLocalAgentsDefault},
+		    {LatencySummaryKey, LatencySummaryDefault},
+		    {TracePathKey, TracePathDefault},
+		    {AdaptiveTimeoutKey, AdaptiveTimeoutDefault},
+		    {SpeculationKey, SpeculationDefault},
+		    {PrefaultKey, PrefaultDefault},
+		    {PrefetchDepthKey, PrefetchDepthDefault},
+		    {AsyncWriteDepthKey, AsyncWriteDepthDefault},
+		    {RAMPerNodeKey, RAMPerNodeDefault},
+		    {ThreadsPerProcessKey, ThreadsPerProcessDefault},
+		    {GroupDelimiterKey, GroupDelimiterDefault},
+		    {CandidateListLengthKey, CandidateListLengthDefault},
+		    {ShareThresholdsKey, ShareThresholdsDefault}}));
 	} catch (const BE::Error::Exception &e) {
 		throw BE::Error::StrategyError("Could not open \"" +
 		    std::string(argv[1]) + "\" (" + e.whatString() + ")");
 	}
 
+	/* Node distribution mode (has default value) */
+	const auto mode = props->getProperty(ModeKey);
+	if (BE::Text::caseInsensitiveCompare(mode, ModeValueLocal))
+		args.mode = Mode::Local;
+	else if (BE::Text::caseInsensitiveCompare(mode, ModeValueCoordinator))
+		args.mode = Mode::Coordinator;
+	else if (BE::Text::caseInsensitiveCompare(mode, ModeValueAgent))
+		args.mode = Mode::Agent;
+	else
+		throw BE::Error::StrategyError("Invalid value for property: " +
+		    ModeKey + '\n' + usage);
+
+	if (args.mode != Mode::Local) {
+		try {
+			args.coordinatorAddress = props->getProperty(
+			    CoordinatorAddressKey);
+		} catch (const BE::Error::ObjectDoesNotExist) {
+			throw BE::Error::StrategyError("Missing property: " +
+			    CoordinatorAddressKey + '\n' + usage);
+		}
+	}
+	if (args.mode == Mode::Coordinator)
+		args.launchLocalAgents = props->getPropertyAsBoolean(
+		    LaunchLocalAgentsKey);
+	if (args.mode == Mode::Agent) {
+		try {
+			const auto nodeNumber = props->getPropertyAsInteger(
+			    NodeNumberKey);
+			if ((nodeNumber < 0) || (nodeNumber > 254))
+				throw BE::Error::StrategyError("Invalid value "
+				    "for property: " + NodeNumberKey);
+			args.nodeNumber = nodeNumber;
+		} catch (const BE::Error::ObjectDoesNotExist) {
+			throw BE::Error::StrategyError("Missing property: " +
+			    NodeNumberKey + '\n' + usage);
+		}
+	}
+
 	/* Configuration directory */
 	try {
 		args.configDir = props->getProperty(ConfigDirKey);
@@ -136,30 +301,34 @@ N2N::Validation::IdentStageOne::procargs(
 		    ConfigDirKey + '\n' + usage);
 	}
 
-	/* Search templates input */
-	try {
-		args.searchRSPath = props->getProperty(SearchRSPathKey);
-	} catch (const BE::Error::ObjectDoesNotExist) {
-		throw BE::Error::StrategyError("Missing property: " +
-		    SearchRSPathKey + '\n' + usage);
-	}
-	try {
-		BE::IO::RecordStore::openRecordStore(args.searchRSPath);
-	} catch (const BE::Error::Exception &e) {
-		throw BE::Error::StrategyError("Could not open " +
-		    SearchRSPathKey + ": " + args.searchRSPath + " (" +
-		    e.whatString() + ")\n" + usage);
-	}
+	/* Agents receive search templates and node number from coordinator */
+	if (args.mode != Mode::Agent) {
+		/* Search templates input */
+		try {
+			args.searchRSPath = props->getProperty(SearchRSPathKey);
+		} catch (const BE::Error::ObjectDoesNotExist) {
+			throw BE::Error::StrategyError("Missing property: " +
+			    SearchRSPathKey + '\n' + usage);
+		}
+		try {
+			BE::IO::RecordStore::openRecordStore(args.searchRSPath);
+		} catch (const BE::Error::Exception &e) {
+			throw BE::Error::StrategyError("Could not open " +
+			    SearchRSPathKey + ": " + args.searchRSPath + " (" +
+			    e.whatString() + ")\n" + usage);
+		}
 
-	/* Number of nodes during finalization */
-	try {
-		args.numNodes = props->getPropertyAsInteger(NumNodesKey);
-		if (args.numNodes == 0)
-			throw BE::Error::StrategyError(NumNodesKey + " "
-			    "can't be 0");
-	} catch (const BE::Error::ObjectDoesNotExist) {
-		throw BE::Error::StrategyError("Missing property: " +
-		    NumNodesKey + '\n' + usage);
+		/* Number of nodes during finalization */
+		try {
+			args.numNodes = props->getPropertyAsInteger(
+			    NumNodesKey);
+			if (args.numNodes == 0)
+				throw BE::Error::StrategyError(NumNodesKey +
+				    " can't be 0");
+		} catch (const BE::Error::ObjectDoesNotExist) {
+			throw BE::Error::StrategyError("Missing property: " +
+			    NumNodesKey + '\n' + usage);
+		}
 	}
 
 	/* Number of nodes during finalization (has default value) */
@@ -168,6 +337,77 @@ N2N::Validation::IdentStageOne::procargs(
 		throw BE::Error::StrategyError(NumProcessesKey + " can't be 0");
 
 	args.prefix = props->getProperty(PrefixKey);
+	args.latencySummaryPath = props->getProperty(LatencySummaryKey);
+	args.tracePath = props->getProperty(TracePathKey);
+
+	args.adaptiveTimeoutMultiplier = props->getPropertyAsDouble(
+	    AdaptiveTimeoutKey);
+	if (args.adaptiveTimeoutMultiplier < 0)
+		throw BE::Error::StrategyError(AdaptiveTimeoutKey + " can't "
+		    "be negative");
+	args.speculationMultiplier = props->getPropertyAsDouble(
+	    SpeculationKey);
+	if (args.speculationMultiplier < 0)
+		throw BE::Error::StrategyError(SpeculationKey + " can't be "
+		    "negative");
+	args.prefault = props->getPropertyAsBoolean(PrefaultKey);
+	const auto prefetchDepth = props->getPropertyAsInteger(
+	    PrefetchDepthKey);
+	if (prefetchDepth < 0)
+		throw BE::Error::StrategyError(PrefetchDepthKey + " can't be "
+		    "negative");
+	args.prefetchDepth = static_cast<uint64_t>(prefetchDepth);
+	const auto asyncWriteDepth = props->getPropertyAsInteger(
+	    AsyncWriteDepthKey);
+	if ((asyncWriteDepth < 0) || (asyncWriteDepth > 256))
+		throw BE::Error::StrategyError(AsyncWriteDepthKey + " must be "
+		    "in [0,256]");
+	args.asyncWriteDepth = static_cast<uint64_t>(asyncWriteDepth);
+	const auto ramPerNode = props->getPropertyAsInteger(RAMPerNodeKey);
+	if (ramPerNode < 0)
+		throw BE::Error::StrategyError(RAMPerNodeKey + " can't be "
+		    "negative");
+	args.ramPerNode = static_cast<uint64_t>(ramPerNode);
+
+	/* Processes times threads must not oversubscribe the processors */
+	const auto threadsPerProcess = props->getPropertyAsInteger(
+	    ThreadsPerProcessKey);
+	const uint64_t processors{Scheduling::getProcessorCount()};
+	if ((threadsPerProcess < 0) || (threadsPerProcess >
+	    std::numeric_limits<uint16_t>::max()))
+		throw BE::Error::StrategyError(ThreadsPerProcessKey + " must "
+		    "be in [0," + std::to_string(
+		    std::numeric_limits<uint16_t>::max()) + "]");
+	if (threadsPerProcess == 0) {
+		args.threadsPerProcess = static_cast<uint16_t>(
+		    std::min<uint64_t>(std::numeric_limits<uint16_t>::max(),
+		    std::max<uint64_t>(1, processors / args.numProcesses)));
+	} else {
+		args.threadsPerProcess = static_cast<uint16_t>(
+		    threadsPerProcess);
+		if ((args.threadsPerProcess > 1) && ((args.numProcesses *
+		    args.threadsPerProcess) > processors))
+			throw BE::Error::StrategyError(NumProcessesKey + " "
+			    "times " + ThreadsPerProcessKey + " can't exceed "
+			    "the " + std::to_string(processors) + " "
+			    "processor(s) available");
+	}
+	args.searchGroupDelimiter = props->getProperty(GroupDelimiterKey);
+
+	const auto candidateListLength = props->getPropertyAsInteger(
+	    CandidateListLengthKey);
+	if ((candidateListLength < 1) || (candidateListLength > 100))
+		throw BE::Error::StrategyError(CandidateListLengthKey + " must "
+		    "be in [1,100]");
+	args.candidateListLength = static_cast<uint16_t>(
+	    candidateListLength);
+
+	/* Nodes on other hosts cannot share memory */
+	args.shareSearchThresholds = props->getPropertyAsBoolean(
+	    ShareThresholdsKey);
+	if (args.shareSearchThresholds && (args.mode != Mode::Local))
+		throw BE::Error::StrategyError(ShareThresholdsKey + " "
+		    "requires " + ModeKey + " = " + ModeValueLocal);
 
 	args.outputDirectory = props->getProperty(OutputDirKey);
 	if (BE::IO::Utility::makePath(args.outputDirectory, S_IRWXU | S_IRWXG)
@@ -182,21 +422,43 @@ int
 N2N::Validation::IdentStageOne::run(
     const N2N::Validation::IdentStageOne::Arguments &args)
 {
+	switch (args.mode) {
+	case Mode::Coordinator:
+		return (runCoordinator(args));
+	case Mode::Agent:
+		return (runAgent(args));
+	case Mode::Local:
+		break;
+	}
+
+	if (!args.tracePath.empty())
+		Trace::enable(args.tracePath);
+
 	/* Make directory to hold stage one results */
 	if (mkdir(args.stageOneDataRoot.c_str(), S_IRWXU | S_IRWXG) != 0)
 		throw BE::Error::FileError("Could not create root dir: " +
 		    args.stageOneDataRoot + " (" + BE::Error::errorStr() + ')');
 
+	/* Running thresholds are shared by every node */
+	std::shared_ptr<ThresholdTable> thresholds{};
+	if (args.shareSearchThresholds)
+		thresholds = std::make_shared<ThresholdTable>(
+		    Scheduling::readKeys(args.searchRSPath));
+
 	/* Create [1,N] Workers */
 	std::vector<std::shared_ptr<BE::Process::WorkerController>> workers;
 	BE::Process::ForkManager manager{};
 	for (uint8_t i{0}; i < args.numNodes; ++i)
 		workers.emplace_back(manager.addWorker(
-		    std::make_shared<IdentStageOne::NodeWorker>(i, args)));
+		    std::make_shared<IdentStageOne::NodeWorker>(i, args,
+		    thresholds)));
 
 	/* fork and wait */
+	BE::Time::Timer wall{};
 	try {
+		wall.start();
 		manager.startWorkers();
+		wall.stop();
 	} catch (const BE::Error::Exception &e) {
 		std::cout << "A node encountered an exception (" <<
 		    e.whatString() << ")..." << std::endl;
@@ -211,6 +473,28 @@ N2N::Validation::IdentStageOne::run(
 		}
 	}
 
+	std::vector<std::string> latencyPaths{};
+	for (uint8_t i{0}; i < args.numNodes; ++i)
+		latencyPaths.push_back(getNodeLatencyPath(args, i));
+	Latency::HistogramMap latencies{};
+	Latency::mergeWorkerFiles(latencies, latencyPaths);
+	Latency::report(latencies, wall.elapsed(), args.latencySummaryPath);
+	if (thresholds)
+		std::cout << "Shared running thresholds for " <<
+		    thresholds->getRaisedCount() << " search(es)" << std::endl;
+
+	Trace::Span mergeSpan{"mergeStageOneData"};
+	const int status{mergeStageOneData(args)};
+	mergeSpan.end();
+	Trace::merge();
+
+	return (status);
+}
+
+int
+N2N::Validation::IdentStageOne::mergeStageOneData(
+    const N2N::Validation::IdentStageOne::Arguments &args)
+{
 	/* Make directory to hold directories of merged search data */
 	const std::string mergeDir{args.stageOneDataRoot + ".merged"};
 	if (mkdir(mergeDir.c_str(), S_IRWXU | S_IRWXG) != 0)
@@ -269,12 +553,473 @@ N2N::Validation::IdentStageOne::run(
 
 /******************************************************************************/
 
-N2N::Validation::IdentStageOne::NodeWorker::NodeWorker(
+/**
+ * @brief
+ * Whether a path received from a peer stays within its parent directory.
+ *
+ * @param[in] path
+ * Relative path received from a peer.
+ *
+ * @return
+ * true if `path` is non-empty, relative, and has no ".." components.
+ */
+static bool
+isContainedPath(
+    const std::string &path)
+{
+	if (path.empty() || (path.front() == '/'))
+		return (false);
+	for (const auto &component : BE::Text::split(path, '/'))
+		if (component == "..")
+			return (false);
+	return (true);
+}
+
+/**
+ * @brief
+ * Send every file beneath a search's stage one data directory.
+ *
+ * @param[in] connection
+ * Connection to the coordinator.
+ * @param[in] searchID
+ * Search whose data is being sent.
+ * @param[in] directory
+ * Directory to send.
+ * @param[in] relativePath
+ * Path of `directory` relative to the search's data directory.
+ */
+static void
+sendStageOneDirectory(
+    N2N::Validation::Network::Connection &connection,
+    const std::string &searchID,
+    const std::string &directory,
+    const std::string &relativePath)
+{
+	using N2N::Validation::Network::Message;
+	using N2N::Validation::Network::MessageType;
+
+	std::unique_ptr<DIR, int(*)(DIR*)> dir(::opendir(directory.c_str()),
+	    closedir);
+	if (dir == nullptr)
+		throw BE::Error::FileError("Could not open " + directory +
+		    " (" + BE::Error::errorStr() + ')');
+
+	struct dirent *entry;
+	while ((entry = readdir(dir.get())) != nullptr) {
+		const std::string name{entry->d_name};
+		if ((name == ".") || (name == ".."))
+			continue;
+
+		const std::string path{directory + '/' + name};
+		const std::string relative{relativePath.empty() ? name :
+		    relativePath + '/' + name};
+		if (BE::IO::Utility::pathIsDirectory(path)) {
+			sendStageOneDirectory(connection, searchID, path,
+			    relative);
+			continue;
+		}
+
+		Message message{MessageType::StageOneData, searchID, relative};
+		message.data = BE::IO::Utility::readFile(path);
+		connection.send(message);
+	}
+}
+
+/**
+ * @brief
+ * Stream search templates to one agent and store the stage one data it
+ * returns.
+ *
+ * @param[in] nodeNumber
+ * Partition searched by the agent.
+ * @param[in] connection
+ * Connection to the agent.
+ * @param[in] args
+ * Arguments parsed from procargs().
+ * @param[out] latencies
+ * Latencies of the agent's node.
+ * @param[out] error
+ * Empty on success, otherwise the reason the node failed.
+ */
+static void
+serveAgent(
+    const uint8_t nodeNumber,
+    const std::shared_ptr<N2N::Validation::Network::Connection> &connection,
+    const N2N::Validation::IdentStageOne::Arguments &args,
+    N2N::Validation::Latency::HistogramMap &latencies,
+    std::string &error)
+{
+	using N2N::Validation::Network::Message;
+	using N2N::Validation::Network::MessageType;
+
+	try {
+		const std::string nodeDir{args.stageOneDataRoot + '/' +
+		    std::to_string(nodeNumber)};
+		if (mkdir(nodeDir.c_str(), S_IRWXU | S_IRWXG) != 0)
+			throw BE::Error::FileError("Could not create node "
+			    "data dir: " + nodeDir + " (" +
+			    BE::Error::errorStr() + ')');
+
+		/* Each thread needs its own cursor */
+		const auto rs = BE::IO::RecordStore::openRecordStore(
+		    args.searchRSPath);
+		BE::IO::RecordStore::Record record{};
+		for (;;) {
+			try {
+				record = rs->sequence();
+			} catch (BE::Error::ObjectDoesNotExist) {
+				break;
+			}
+
+			/* Searches without output still get a directory */
+			const std::string dataDir{nodeDir + '/' + record.key};
+			if (mkdir(dataDir.c_str(), S_IRWXU | S_IRWXG) != 0)
+				throw BE::Error::FileError("Could not create "
+				    "dir for search key: " + dataDir + " (" +
+				    BE::Error::errorStr() + ')');
+
+			Message message{MessageType::Search, record.key};
+			message.data = record.data;
+			connection->send(message);
+		}
+		connection->send(Message{MessageType::EndOfSearches});
+
+		for (;;) {
+			const auto message = connection->receive();
+			switch (message.type) {
+			case MessageType::StageOneData: {
+				if (!rs->containsKey(message.key) ||
+				    !isContainedPath(message.name))
+					throw BE::Error::StrategyError("Invalid "
+					    "stage one data path from agent: " +
+					    message.key + '/' + message.name);
+
+				const std::string path{nodeDir + '/' +
+				    message.key + '/' + message.name};
+				if (BE::IO::Utility::makePath(
+				    BE::Text::dirname(path), S_IRWXU |
+				    S_IRWXG) != 0)
+					throw BE::Error::FileError("Could not "
+					    "create " + BE::Text::dirname(path) +
+					    " (" + BE::Error::errorStr() + ')');
+				BE::IO::Utility::writeFile(message.data, path);
+				break;
+			}
+			case MessageType::Latency:
+				if (message.data.size() == 0)
+					break;
+				N2N::Validation::Latency::mergeSerialized(
+				    latencies, std::string(
+				    reinterpret_cast<const char *>(
+				    &message.data[0]), message.data.size()));
+				break;
+			case MessageType::Done:
+				return;
+			case MessageType::Failed:
+				error = message.name;
+				return;
+			default:
+				throw BE::Error::StrategyError("Unexpected "
+				    "message from agent");
+			}
+		}
+	} catch (const BE::Error::Exception &e) {
+		error = e.whatString();
+	}
+}
+
+/**
+ * @brief
+ * Stop and wait for locally launched agents when leaving scope.
+ * @details
+ * Agents retry connecting for some time, so a coordinator that fails
+ * before serving them would otherwise leave them orphaned.
+ */
+class LocalAgentsGuard
+{
+public:
+	/**
+	 * @brief
+	 * Constructor.
+	 *
+	 * @param[in] manager
+	 * Manager of locally launched agents, which must outlive this.
+	 */
+	LocalAgentsGuard(
+	    BE::Process::ForkManager &manager) :
+	    _manager(manager)
+	{
+	}
+
+	/** Wait for agents to finish on their own */
+	void
+	wait()
+	{
+		this->_waited = true;
+		this->_manager.wait();
+	}
+
+	/** Destructor. Stops agents if wait() was not called. */
+	~LocalAgentsGuard()
+	{
+		if (this->_waited)
+			return;
+		try {
+			this->_manager.stopWorkers();
+			this->_manager.wait();
+		} catch (...) {}
+	}
+
+private:
+	/** Manager of locally launched agents */
+	BE::Process::ForkManager &_manager;
+	/** Whether agents were already waited for */
+	bool _waited{false};
+};
+
+int
+N2N::Validation::IdentStageOne::runCoordinator(
+    const N2N::Validation::IdentStageOne::Arguments &args)
+{
+	/* Allow 10 minutes for each agent to initialize and connect */
+	static const uint32_t ConnectTimeoutSeconds{10 * 60};
+
+	/* Make directory to hold stage one results */
+	if (mkdir(args.stageOneDataRoot.c_str(), S_IRWXU | S_IRWXG) != 0)
+		throw BE::Error::FileError("Could not create root dir: " +
+		    args.stageOneDataRoot + " (" + BE::Error::errorStr() + ')');
+
+	/*
+	 * Agents are stopped on any error. Declared before the listener,
+	 * which is closed first so unserved agents stop waiting on it.
+	 */
+	BE::Process::ForkManager agentManager{};
+	LocalAgentsGuard agentsGuard{agentManager};
+	Network::Listener listener{args.coordinatorAddress};
+
+	/* Agents on this machine must be forked before any threads start */
+	std::vector<std::shared_ptr<BE::Process::WorkerController>> agents{};
+	if (args.launchLocalAgents) {
+		for (uint8_t i{0}; i < args.numNodes; ++i)
+			agents.emplace_back(agentManager.addWorker(
+			    std::make_shared<IdentStageOne::AgentWorker>(i,
+			    args)));
+		agentManager.startWorkers(false);
+	}
+
+	/* Exactly one agent per node */
+	std::vector<std::shared_ptr<Network::Connection>> connections(
+	    args.numNodes);
+	for (uint8_t i{0}; i < args.numNodes; ++i) {
+		const auto connection = listener.accept(ConnectTimeoutSeconds);
+		const auto hello = connection->receive();
+		if (hello.type != Network::MessageType::Hello)
+			throw BE::Error::StrategyError("Agent did not "
+			    "identify itself");
+
+		uint64_t nodeNumber{};
+		try {
+			nodeNumber = std::stoul(hello.key);
+		} catch (const std::exception &) {
+			throw BE::Error::StrategyError("Agent sent invalid "
+			    "node number: " + hello.key);
+		}
+		if (nodeNumber >= args.numNodes)
+			throw BE::Error::StrategyError("Agent sent node "
+			    "number " + hello.key + ", but there are only " +
+			    std::to_string(args.numNodes) + " nodes");
+		if (connections[nodeNumber] != nullptr)
+			throw BE::Error::StrategyError("More than one agent "
+			    "for node " + hello.key);
+		connections[nodeNumber] = connection;
+	}
+
+	/* Serve all agents concurrently */
+	std::vector<std::string> errors(args.numNodes);
+	std::vector<Latency::HistogramMap> nodeLatencies(args.numNodes);
+	std::vector<std::thread> threads{};
+	BE::Time::Timer wall{};
+	wall.start();
+	for (uint8_t i{0}; i < args.numNodes; ++i)
+		threads.emplace_back(serveAgent, i, std::cref(connections[i]),
+		    std::cref(args), std::ref(nodeLatencies[i]),
+		    std::ref(errors[i]));
+	for (auto &thread : threads)
+		thread.join();
+	wall.stop();
+
+	agentsGuard.wait();
+
+	bool failed{false};
+	for (uint8_t i{0}; i < args.numNodes; ++i) {
+		if (!errors[i].empty()) {
+			std::cout << "Node " << std::to_string(i) << " "
+			    "failed (" << errors[i] << ")" << std::endl;
+			failed = true;
+		} else if (args.launchLocalAgents &&
+		    (agents.at(i)->getExitStatus() != EXIT_SUCCESS)) {
+			std::cout << "Agent " << std::to_string(i) << " "
+			    "did not exit cleanly." << std::endl;
+			failed = true;
+		}
+	}
+	if (failed)
+		return (EXIT_FAILURE);
+
+	Latency::HistogramMap latencies{};
+	for (const auto &node : nodeLatencies)
+		for (const auto &h : node)
+			latencies[h.first].merge(h.second);
+	Latency::report(latencies, wall.elapsed(), args.latencySummaryPath);
+
+	return (mergeStageOneData(args));
+}
+
+int
+N2N::Validation::IdentStageOne::runAgent(
+    const N2N::Validation::IdentStageOne::Arguments &args,
+    const std::function<bool()> &stopRequested)
+{
+	using N2N::Validation::Network::Message;
+	using N2N::Validation::Network::MessageType;
+
+	/* Traces stay on the agent's host */
+	if (!args.tracePath.empty())
+		Trace::enable(args.tracePath + '.' +
+		    std::to_string(args.nodeNumber));
+
+	const auto connection = Network::Connection::connect(
+	    args.coordinatorAddress, 60, stopRequested);
+	connection->send(Message{MessageType::Hello,
+	    std::to_string(args.nodeNumber)});
+
+	try {
+		/* Local scratch space for this node */
+		if (mkdir(args.stageOneDataRoot.c_str(), S_IRWXU | S_IRWXG) !=
+		    0)
+			throw BE::Error::FileError("Could not create root "
+			    "dir: " + args.stageOneDataRoot + " (" +
+			    BE::Error::errorStr() + ')');
+
+		/* Search templates are searched from a local copy */
+		IdentStageOne::Arguments nodeArgs{args};
+		nodeArgs.searchRSPath = args.stageOneDataRoot + "/searches.rs";
+		{
+			const auto rs = BE::IO::RecordStore::createRecordStore(
+			    nodeArgs.searchRSPath, "Search templates for "
+			    "node " + std::to_string(args.nodeNumber),
+			    BE::IO::RecordStore::Kind::Default);
+			for (;;) {
+				const auto message = connection->receive();
+				if (message.type == MessageType::EndOfSearches)
+					break;
+				if (message.type != MessageType::Search)
+					throw BE::Error::StrategyError(
+					    "Unexpected message from "
+					    "coordinator");
+				rs->insert(message.key, message.data);
+			}
+			rs->sync();
+		}
+
+		/* Search exactly as a locally fork()ed node would */
+		BE::Process::ForkManager manager{};
+		const auto node = manager.addWorker(
+		    std::make_shared<IdentStageOne::NodeWorker>(
+		    args.nodeNumber, nodeArgs, nullptr));
+		manager.startWorkers();
+		if (node->getExitStatus() != EXIT_SUCCESS) {
+			connection->send(Message{MessageType::Failed, "",
+			    "Node " + std::to_string(args.nodeNumber) +
+			    " did not exit cleanly"});
+			return (EXIT_FAILURE);
+		}
+
+		/* Return stage one data */
+		const std::string nodeDir{args.stageOneDataRoot + '/' +
+		    std::to_string(args.nodeNumber)};
+		const auto rs = BE::IO::RecordStore::openRecordStore(
+		    nodeArgs.searchRSPath);
+		std::string key{};
+		for (;;) {
+			try {
+				key = rs->sequenceKey();
+			} catch (BE::Error::ObjectDoesNotExist) {
+				break;
+			}
+			sendStageOneDirectory(*connection, key, nodeDir + '/' +
+			    key, "");
+		}
+
+		/* Return latencies (not fatal if missing) */
+		const std::string latencyPath{getNodeLatencyPath(args,
+		    args.nodeNumber)};
+		Message latency{MessageType::Latency};
+		try {
+			latency.data = BE::IO::Utility::readFile(latencyPath);
+			std::remove(latencyPath.c_str());
+		} catch (const BE::Error::Exception &e) {
+			std::cout << "Could not read latencies from " <<
+			    latencyPath << " (" << e.whatString() << ")" <<
+			    std::endl;
+		}
+		connection->send(latency);
+		connection->send(Message{MessageType::Done});
+	} catch (const BE::Error::Exception &e) {
+		try {
+			/* Reasons must fit in a message name */
+			connection->send(Message{MessageType::Failed, "",
+			    e.whatString().substr(0, 1024)});
+		} catch (...) {}
+		throw;
+	}
+
+	/* Coordinator has a copy of everything */
+	BE::IO::Utility::removeDirectory(args.stageOneDataRoot);
+	Trace::merge();
+
+	return (EXIT_SUCCESS);
+}
+
+/******************************************************************************/
+
+N2N::Validation::IdentStageOne::AgentWorker::AgentWorker(
     uint8_t nodeNumber,
     const IdentStageOne::Arguments &args) :
+    _args{args}
+{
+	this->_args.mode = Mode::Agent;
+	this->_args.nodeNumber = nodeNumber;
+	this->_args.searchRSPath.clear();
+	this->_args.stageOneDataRoot = args.stageOneDataRoot + ".agent" +
+	    std::to_string(nodeNumber);
+}
+
+int32_t
+N2N::Validation::IdentStageOne::AgentWorker::workerMain()
+{
+	try {
+		return (runAgent(this->_args, [this]() {
+			return (this->stopRequested());
+		}));
+	} catch (const BE::Error::Exception &e) {
+		std::cout << "Agent " << std::to_string(
+		    this->_args.nodeNumber) << " encountered an exception (" <<
+		    e.whatString() << ")..." << std::endl;
+		return (EXIT_FAILURE);
+	}
+}
+
+/******************************************************************************/
+
+N2N::Validation::IdentStageOne::NodeWorker::NodeWorker(
+    uint8_t nodeNumber,
+    const IdentStageOne::Arguments &args,
+    const std::shared_ptr<ThresholdTable> &thresholds) :
     _lib{N2N::Interface::getImplementation()},
     _args{args},
-    _nodeNumber{nodeNumber}
+    _nodeNumber{nodeNumber},
+    _thresholds{thresholds}
 {
 	/* Make directory to hold stage one search results for this node */
 	const std::string dataDir{args.stageOneDataRoot + '/' +
@@ -287,19 +1032,73 @@ N2N::Validation::IdentStageOne::NodeWorker::NodeWorker(
 int32_t
 N2N::Validation::IdentStageOne::NodeWorker::workerMain()
 {
+	Trace::beginProcess();
+
+	/* Everything this node loads or forks counts against its budget */
+	MemoryMonitor memory{"node" + std::to_string(this->_nodeNumber),
+	    this->_args.ramPerNode * 1024};
+
 	/* Init in node's process before it forks */
+	Trace::Span initSpan{"initIdentificationStageOne"};
+	BE::Time::Timer initTimer{};
+	initTimer.start();
 	this->_lib->initIdentificationStageOne(this->_args.configDir,
 	    this->_args.enrollDir, this->_args.searchTemplateType,
 	    this->_nodeNumber);
+	initTimer.stop();
+	initSpan.end();
+
+	if (this->_lib->setThreadsPerProcess(
+	    this->_args.threadsPerProcess).code !=
+	    N2N::StatusCode::Success) {
+		std::cout << "setThreadsPerProcess() failed on node " <<
+		    std::to_string(this->_nodeNumber) << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	if (this->_lib->setCandidateListLength(
+	    this->_args.candidateListLength).code !=
+	    N2N::StatusCode::Success) {
+		std::cout << "setCandidateListLength() failed on node " <<
+		    std::to_string(this->_nodeNumber) << std::endl;
+		return (EXIT_FAILURE);
+	}
+
+	if (this->_thresholds) {
+		const auto status = this->_lib->setSearchThresholds(
+		    this->_thresholds);
+		if (status.code != N2N::StatusCode::Success) {
+			std::cout << "setSearchThresholds() failed on node " <<
+			    std::to_string(this->_nodeNumber) << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
+
+	/* Searches are claimed by whichever process is free */
+	std::shared_ptr<const std::vector<std::string>> keys{};
+	std::shared_ptr<const Scheduling::Groups> groups{};
+	std::shared_ptr<WorkQueue> queue{};
+	try {
+		keys = std::make_shared<const std::vector<std::string>>(
+		    Scheduling::readKeys(this->_args.searchRSPath));
+		groups = std::make_shared<const Scheduling::Groups>(
+		    Scheduling::groupKeys(*keys,
+		    this->_args.searchGroupDelimiter));
+		queue = std::make_shared<WorkQueue>(groups->size());
+	} catch (const BE::Error::Exception &e) {
+		std::cout << e.whatString() << std::endl;
+		return (EXIT_FAILURE);
+	}
 
 	/* Create [1,P] Workers */
 	BE::Process::ForkManager manager{};
 	std::vector<std::shared_ptr<BE::Process::WorkerController>> workers{};
+	std::vector<std::string> latencyPaths{};
 	for (uint8_t i{0}; i < this->_args.numProcesses; ++i) {
 		try {
 			workers.emplace_back(manager.addWorker(std::make_shared<
 			    IdentStageOne::ProcessWorker>(i, this->_nodeNumber,
-			    this->_lib, this->_args)));
+			    this->_lib, this->_args, keys, groups, queue)));
 		} catch (const BE::Error::Exception &e) {
 			std::cout << e.whatString() << std::endl;
 			return (EXIT_FAILURE);
@@ -309,6 +1108,19 @@ N2N::Validation::IdentStageOne::NodeWorker::workerMain()
 		    '/' + this->_args.prefix +
 		    std::to_string(this->_nodeNumber) + "-" +
 		    std::to_string(i) + ".log" ));
+		latencyPaths.push_back(this->_args.outputDirectory + '/' +
+		    this->_args.prefix + std::to_string(this->_nodeNumber) +
+		    "-" + std::to_string(i) + ".latency");
+		workers.back()->setParameter(ProcessWorker::LatencyPathParam,
+		    std::make_shared<std::string>(latencyPaths.back()));
+		if (!this->_args.searchGroupDelimiter.empty())
+			workers.back()->setParameter(
+			    ProcessWorker::GroupLogPathParam,
+			    std::make_shared<std::string>(
+			    this->_args.outputDirectory + '/' +
+			    this->_args.prefix +
+			    std::to_string(this->_nodeNumber) + "-" +
+			    std::to_string(i) + ".groups.log"));
 	}
 
 	/* fork and wait */
@@ -321,6 +1133,25 @@ N2N::Validation::IdentStageOne::NodeWorker::workerMain()
 		return (EXIT_FAILURE);
 	}
 
+	/* Processes killed for memory are reported as such */
+	const auto usage = memory.stop();
+	std::cout << "Node " << std::to_string(this->_nodeNumber) << " "
+	    "memory (" << ((memory.getMethod() ==
+	    MemoryMonitor::Method::ControlGroup) ? "cgroup" : "sampled") <<
+	    "): peak " << (usage.peak / 1024) << " KiB, steady-state " <<
+	    (usage.steady / 1024) << " KiB" << std::endl;
+	if (usage.exceeded) {
+		std::cout << "Node " << std::to_string(this->_nodeNumber) <<
+		    " exceeded its memory budget of " <<
+		    this->_args.ramPerNode << " KiB (peak " <<
+		    (usage.peak / 1024) << " KiB";
+		if (usage.oomKills != 0)
+			std::cout << ", " << usage.oomKills << " process(es) "
+			    "killed";
+		std::cout << ")" << std::endl;
+		return (EXIT_FAILURE);
+	}
+
 	for (uint8_t i{0}; i < this->_args.numProcesses; ++i) {
 		if (workers.at(i)->getExitStatus() != EXIT_SUCCESS) {
 			std::cout << "Process " << std::to_string(i) <<
@@ -330,6 +1161,20 @@ N2N::Validation::IdentStageOne::NodeWorker::workerMain()
 		}
 	}
 
+	/* Combine processes so the parent only merges one file per node */
+	Latency::HistogramMap latencies{};
+	latencies["initIdentificationStageOne"].record(initTimer.elapsed());
+	Latency::mergeWorkerFiles(latencies, latencyPaths);
+	try {
+		Latency::write(latencies, getNodeLatencyPath(this->_args,
+		    this->_nodeNumber));
+	} catch (const BE::Error::Exception &e) {
+		std::cout << "Could not write latencies for node " <<
+		    std::to_string(this->_nodeNumber) << " (" <<
+		    e.whatString() << ")" << std::endl;
+	}
+	Trace::flush();
+
 	return (EXIT_SUCCESS);
 }
 
@@ -339,32 +1184,37 @@ N2N::Validation::IdentStageOne::ProcessWorker::ProcessWorker(
     uint8_t processNumber,
     uint8_t nodeNumber,
     const std::shared_ptr<N2N::Interface> &lib,
-    const IdentStageOne::Arguments &args) :
+    const IdentStageOne::Arguments &args,
+    const std::shared_ptr<const std::vector<std::string>> &keys,
+    const std::shared_ptr<const Scheduling::Groups> &groups,
+    const std::shared_ptr<WorkQueue> &queue) :
     _lib{lib},
     _rs{BE::IO::RecordStore::openRecordStore(args.searchRSPath)},
-    _maxSearches{static_cast<uint64_t>(std::ceil(
-        this->_rs->getCount() / static_cast<float>(args.numProcesses)))},
-    _stageOneDataDir{args.stageOneDataRoot + '/' + std::to_string(nodeNumber)}
+    _keys{keys},
+    _groups{groups},
+    _grouped{!args.searchGroupDelimiter.empty()},
+    _searchGroupDelimiter{args.searchGroupDelimiter},
+    _queue{queue},
+    _processNumber{processNumber},
+    _stageOneDataDir{args.stageOneDataRoot + '/' + std::to_string(nodeNumber)},
+    _adaptiveTimeoutMultiplier{args.adaptiveTimeoutMultiplier},
+    _speculationMultiplier{args.speculationMultiplier},
+    _prefault{args.prefault},
+    _prefetchDepth{args.prefetchDepth},
+    _asyncWriteDepth{args.asyncWriteDepth}
 {
-	if (args.numProcesses > this->_rs->getCount())
+	if (args.numProcesses > groups->size())
 		throw BE::Error::StrategyError("Not enough processes for data "
 		    "(" + std::to_string(args.numProcesses) + " processes, "
-		    "and " + std::to_string(this->_rs->getCount()) + " "
-		    "searches in " + this->_rs->getPathname() + ')');
-
-	/* Naive partitioning: sequence ahead */
-	const uint64_t stopIndex{processNumber * this->_maxSearches};
-	try {
-		for (uint64_t i{0}; i < stopIndex; ++i)
-			static_cast<void>(this->_rs->sequenceKey());
-	} catch (BE::Error::ObjectDoesNotExist) {
-		/* Too few records for this many processes */
-	}
+		    "and " + std::to_string(groups->size()) + " searches in " +
+		    this->_rs->getPathname() + ')');
 }
 
 int32_t
 N2N::Validation::IdentStageOne::ProcessWorker::workerMain()
 {
+	Trace::beginProcess();
+
 	std::unique_ptr<BE::IO::FileLogsheet> log;
 	try {
 		log = BE::Memory::make_unique<BE::IO::FileLogsheet>(
@@ -377,58 +1227,404 @@ N2N::Validation::IdentStageOne::ProcessWorker::workerMain()
 		    e.whatString() << std::endl;
 		return (EXIT_FAILURE);
 	}
+	std::unique_ptr<BE::IO::FileLogsheet> groupLog;
+	if (this->_grouped) {
+		try {
+			groupLog = BE::Memory::make_unique<BE::IO::FileLogsheet>(
+			    this->getParameterAsString(GroupLogPathParam),
+			    "EntryType EntryNum GroupID Searches Time APIState");
+		} catch (BE::Error::Exception &e) {
+			std::cout << "Could not create " +
+			    this->getParameterAsString(GroupLogPathParam) +
+			    ": " + e.whatString() << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
 	std::string logLine{};
-	std::string dataDir{};
 
 	/* Allow 5 minutes maximum per call */
-	this->_api.getWatchdog()->setInterval(
-	    5 * 60 * BE::Time::MicrosecondsPerSecond);
+	static const uint64_t MaximumTimeout{5 * 60 *
+	    BE::Time::MicrosecondsPerSecond};
+	this->_api.getWatchdog()->setInterval(MaximumTimeout);
+
+	/* Per-process setup, kept out of the first search's latency */
+	Trace::Span initSpan{"initWorker"};
+	const auto init = this->_api.call([&]() -> N2N::ReturnStatus {
+		return (this->_lib->initWorker(this->_processNumber));
+	});
+	initSpan.end();
+	if (!init || (init.status.code != N2N::StatusCode::Success)) {
+		std::cout << "initWorker() failed in process " <<
+		    std::to_string(this->_processNumber) << std::endl;
+		return (EXIT_FAILURE);
+	}
+	this->_latencies["initWorker"].record(init.elapsed);
+
+	/*
+	 * Stage one data written while the next search runs. Files are
+	 * waited for before their directory is measured for the log, and
+	 * right after the search when speculation renames the directory.
+	 */
+	std::shared_ptr<OutputQueue> output{};
+	if (this->_asyncWriteDepth > 0) {
+		output = std::make_shared<OutputQueue>(this->_asyncWriteDepth);
+		const auto status = this->_lib->setAsyncWriter(output);
+		if (status.code != N2N::StatusCode::Success) {
+			std::cout << "setAsyncWriter() failed in process " <<
+			    std::to_string(this->_processNumber) << std::endl;
+			return (EXIT_FAILURE);
+		}
+		if ((this->_processNumber == 0) && (output->getBackend() ==
+		    OutputQueue::Backend::Threads))
+			std::cout << "Writing stage one data with " <<
+			    this->_asyncWriteDepth << " thread(s)" << std::endl;
+	}
+
+	if (this->_prefault) {
+		Trace::Span prefaultSpan{"prefault"};
+		BE::Time::Timer timer{};
+		timer.start();
+		Warmup::prefault();
+		timer.stop();
+		this->_latencies["prefault"].record(timer.elapsed());
+	}
+
+	/*
+	 * Grouped searches are recorded per search template, so timeouts
+	 * scale with group size.
+	 */
+	const std::string method{this->_grouped ?
+	    "identifyTemplatesStageOne" : "identifyTemplateStageOne"};
+	auto &latency = this->_latencies[method];
+	/* First search is reported apart from steady state */
+	auto &firstLatency = this->_latencies[Warmup::getFirstCallName(
+	    method)];
+	uint64_t timeout{MaximumTimeout};
+	uint64_t speculativeAttempts{0}, speculativeWins{0}, discarded{0};
+
+	/* Searches claimed ahead of time, read by a helper thread */
+	using Templates = std::vector<BE::Memory::uint8Array>;
+	std::unique_ptr<Prefetcher<Templates>> prefetcher{};
+	if (this->_prefetchDepth > 0)
+		prefetcher.reset(new Prefetcher<Templates>(
+		    [this](const uint64_t item) -> Templates {
+			return (this->readSearchTemplates(item));
+		}));
+
+	/** Search kept, waiting for its output to be logged */
+	struct Finished
+	{
+		/** Search IDs */
+		std::vector<std::string> ids;
+		/** Directories of stage one data */
+		std::vector<std::string> dataDirs;
+		/** Result of the search */
+		API<N2N::ReturnStatus>::Result result;
+		/** Files queued for output once the search returned */
+		uint64_t queued;
+	};
+	std::vector<Finished> unlogged{};
 
-	for (uint64_t i{0}; i < this->_maxSearches; ++i) {
-		/* Get next search template */
-		BE::IO::RecordStore::Record record;
+	/* Wait for files queued before a point, timing the wait */
+	const auto awaitWrites = [&](const uint64_t queued) -> bool {
+		Trace::Span writeSpan{"awaitWrites"};
+		BE::Time::Timer timer{};
+		timer.start();
 		try {
-			record = this->_rs->sequence();
-		} catch (BE::Error::ObjectDoesNotExist) {
-			break;
+			output->wait(queued);
+		} catch (const BE::Error::Exception &e) {
+			std::cout << e.whatString() << std::endl;
+			return (false);
 		}
+		timer.stop();
+		writeSpan.end();
+		this->_latencies["awaitWrites"].record(timer.elapsed());
+		return (true);
+	};
 
-		/* Make dir to hold results for this node's search results */
-		dataDir = this->_stageOneDataDir + '/' + record.key;
-		if (mkdir(dataDir.c_str(), S_IRWXU | S_IRWXG) != 0) {
-			std::cout << "Could not create dir for search key: " +
-			    dataDir + " (" + BE::Error::errorStr() + ')' <<
-			    std::endl;
-			return (EXIT_FAILURE);
+	/* Log searches whose output has been written */
+	const auto logFinished = [&]() -> bool {
+		if (unlogged.empty())
+			return (true);
+		if (output && !awaitWrites(unlogged.back().queued))
+			return (false);
+
+		for (const auto &search : unlogged) {
+			/* Each search is logged with the call that made it */
+			for (uint64_t i{0}; i < search.ids.size(); ++i) {
+				Trace::Span usageSpan{"sumDirectoryUsage"};
+				const uint64_t usage{BE::IO::Utility::
+				    sumDirectoryUsage(search.dataDirs[i])};
+				usageSpan.end();
+
+				/* Logging */
+				Trace::Span logSpan{"log"};
+				logLine.clear();
+				logLine += search.ids[i] + ' ' +
+				    std::to_string(search.result.elapsed) +
+				    ' ' + std::to_string(usage) + ' ' +
+				    std::to_string(to_int_type(
+				    search.result.currentState)) + ' ';
+				if (search.result)
+					logLine += std::to_string(static_cast<
+					    std::underlying_type<
+					    N2N::StatusCode>::type>(
+					    search.result.status.code)) +
+					    " [<[" + escapeNewlines(
+					    search.result.status.info) +
+					    "]>]";
+				else
+					logLine += "NA [<[]>]";
+
+				*log << logLine;
+				log->newEntry();
+			}
+
+			if (groupLog) {
+				logLine.clear();
+				logLine += Scheduling::getGroupID(
+				    search.ids.front(),
+				    this->_searchGroupDelimiter) + ' ' +
+				    std::to_string(search.ids.size()) + ' ' +
+				    std::to_string(search.result.elapsed) +
+				    ' ' + std::to_string(to_int_type(
+				    search.result.currentState));
+				*groupLog << logLine;
+				groupLog->newEntry();
+			}
+		}
+		unlogged.clear();
+		return (true);
+	};
+
+	std::vector<std::string> ids{}, dataDirs{}, attemptDirs{};
+	Templates templates{};
+	for (;;) {
+		/* Claim the next search, or help with a straggler */
+		bool speculative{false}, prefetched{false};
+		uint64_t item{WorkQueue::None};
+		if (prefetcher == nullptr) {
+			item = this->_queue->claim();
+			if (item != WorkQueue::None)
+				this->_queue->begin(item);
+		} else {
+			while (prefetcher->size() < this->_prefetchDepth) {
+				const uint64_t next{this->_queue->claim()};
+				if (next == WorkQueue::None)
+					break;
+				prefetcher->push(next);
+			}
+
+			if (prefetcher->size() > 0) {
+				/* Only time not overlapped with searching */
+				Trace::Span readSpan{"read"};
+				try {
+					item = prefetcher->pop(templates);
+				} catch (const BE::Error::Exception &e) {
+					std::cout << e.whatString() <<
+					    std::endl;
+					return (EXIT_FAILURE);
+				}
+				readSpan.end();
+
+				this->_queue->begin(item);
+				prefetched = true;
+			}
+		}
+		if (item == WorkQueue::None) {
+			const uint64_t age{Scheduling::getStragglerAge(
+			    latency, this->_speculationMultiplier)};
+			if (age == 0)
+				break;
+
+			bool exhausted{};
+			item = this->_queue->claimStraggler(age, exhausted);
+			if (item == WorkQueue::None) {
+				if (exhausted)
+					break;
+				usleep(Scheduling::PollMicroseconds);
+				continue;
+			}
+			speculative = true;
+			++speculativeAttempts;
+		}
+
+		/* Get search templates */
+		ids.clear();
+		for (const auto i : (*this->_groups)[item])
+			ids.push_back((*this->_keys)[i]);
+		if (!prefetched) {
+			Trace::Span readSpan{"read"};
+			try {
+				templates = this->readSearchTemplates(item);
+			} catch (const BE::Error::Exception &e) {
+				std::cout << e.whatString() << std::endl;
+				return (EXIT_FAILURE);
+			}
+			readSpan.end();
 		}
 
+		/*
+		 * Make dir to hold results for this node's search results.
+		 * When another attempt may run at the same time, each
+		 * attempt writes to a private directory and the winner's is
+		 * renamed.
+		 */
+		Trace::Span mkdirSpan{"mkdir"};
+		dataDirs.clear();
+		attemptDirs.clear();
+		for (const auto &id : ids) {
+			dataDirs.push_back(this->_stageOneDataDir + '/' + id);
+			if (this->_speculationMultiplier > 0)
+				attemptDirs.push_back(this->_stageOneDataDir +
+				    "/.attempt" + std::to_string(
+				    this->_processNumber) + '-' + id);
+			else
+				attemptDirs.push_back(dataDirs.back());
+			if (mkdir(attemptDirs.back().c_str(),
+			    S_IRWXU | S_IRWXG) != 0) {
+				std::cout << "Could not create dir for search "
+				    "key: " + attemptDirs.back() + " (" +
+				    BE::Error::errorStr() + ')' << std::endl;
+				return (EXIT_FAILURE);
+			}
+		}
+		mkdirSpan.end();
+
+		this->_api.getWatchdog()->setInterval(timeout * ids.size());
+		Trace::Span apiSpan{this->_grouped ?
+		    "identifyTemplatesStageOne" : "identifyTemplateStageOne"};
 		const auto result = this->_api.call([&]() -> N2N::ReturnStatus {
+			if (this->_grouped)
+				return (this->_lib->identifyTemplatesStageOne(
+				    ids, templates, attemptDirs));
 			return (this->_lib->identifyTemplateStageOne(
-			    record.key, record.data, dataDir));
+			    ids.front(), templates.front(),
+			    attemptDirs.front()));
 		});
+		apiSpan.end();
 
-		/* Logging */
-		logLine.clear();
-		logLine += record.key + ' ' +
-		    std::to_string(result.elapsed) + ' ' +
-		    std::to_string(BE::IO::Utility::sumDirectoryUsage(
-		        dataDir)) + ' ' +
-		    std::to_string(to_int_type(result.currentState)) + ' ';
-		if (result)
-			logLine += std::to_string(static_cast<
-			    std::underlying_type<N2N::StatusCode>::type>(
-			    result.status.code)) + " [<[" +
-			    escapeNewlines(result.status.info) + "]>]";
-		else
-			logLine += "NA [<[]>]";
+		/* Attempt directories must be complete to rename or remove */
+		const uint64_t queued{output ? output->getQueued() : 0};
+		if (output && (this->_speculationMultiplier > 0) &&
+		    !awaitWrites(queued))
+			return (EXIT_FAILURE);
+
+		/* First attempt to finish is the only one kept and logged */
+		if (!this->_queue->complete(item)) {
+			for (const auto &attemptDir : attemptDirs) {
+				try {
+					BE::IO::Utility::removeDirectory(
+					    attemptDir);
+				} catch (const BE::Error::Exception &e) {
+					std::cout << "Could not remove " <<
+					    attemptDir << " (" <<
+					    e.whatString() << ")" << std::endl;
+				}
+			}
+			++discarded;
+			continue;
+		}
+		if (speculative)
+			++speculativeWins;
+		for (uint64_t i{0}; i < ids.size(); ++i) {
+			if ((attemptDirs[i] != dataDirs[i]) &&
+			    (rename(attemptDirs[i].c_str(),
+			    dataDirs[i].c_str()) != 0)) {
+				std::cout << "Could not rename " <<
+				    attemptDirs[i] << " to " << dataDirs[i] <<
+				    " (" << BE::Error::errorStr() << ")" <<
+				    std::endl;
+				return (EXIT_FAILURE);
+			}
+		}
+
+		/*
+		 * Histograms are amortized across the group's search
+		 * templates. Logs keep the measured time of the call.
+		 */
+		const uint64_t elapsed{result.elapsed / ids.size()};
+		if (result && (firstLatency.getCount() == 0) &&
+		    (latency.getCount() == 0)) {
+			firstLatency.record(elapsed);
+		} else if (result) {
+			latency.record(elapsed);
+			if ((latency.getCount() %
+			    Scheduling::MinimumObservations) == 0)
+				timeout = Scheduling::getTimeout(latency,
+				    this->_adaptiveTimeoutMultiplier,
+				    MaximumTimeout);
+		}
 
-		*log << logLine;
-		log->newEntry();
+		/*
+		 * The previous search's output was written while this one
+		 * ran. This search's output is logged after the next search,
+		 * unless it has already been waited for.
+		 */
+		if (!logFinished())
+			return (EXIT_FAILURE);
+		unlogged.push_back({ids, dataDirs, result, queued});
+		if ((!output || (this->_speculationMultiplier > 0)) &&
+		    !logFinished())
+			return (EXIT_FAILURE);
 	}
+	if (!logFinished())
+		return (EXIT_FAILURE);
+
+	if (speculativeAttempts != 0)
+		std::cout << "Searched " << speculativeAttempts << " "
+		    "straggler(s) again; " << speculativeWins << " finished "
+		    "first" << std::endl;
+	if (discarded != 0)
+		std::cout << "Discarded " << discarded << " result(s) "
+		    "finished first by another process" << std::endl;
+
+	/* Stage two may start as soon as this process exits */
+	if (output) {
+		Trace::Span syncSpan{"sync"};
+		try {
+			output->sync(this->_stageOneDataDir);
+		} catch (const BE::Error::Exception &e) {
+			std::cout << e.whatString() << std::endl;
+			return (EXIT_FAILURE);
+		}
+		syncSpan.end();
+		this->_latencies["asyncWriteQueued"].merge(
+		    output->getQueuedLatency());
+	}
+
+	try {
+		Latency::write(this->_latencies,
+		    this->getParameterAsString(LatencyPathParam));
+	} catch (const BE::Error::Exception &e) {
+		std::cout << "Could not write latencies for process " <<
+		    std::to_string(this->_processNumber) << " (" <<
+		    e.whatString() << ")" << std::endl;
+	}
+	Trace::flush();
 
 	return (EXIT_SUCCESS);
 }
 
+std::vector<BE::Memory::uint8Array>
+N2N::Validation::IdentStageOne::ProcessWorker::readSearchTemplates(
+    const uint64_t item)
+    const
+{
+	std::vector<BE::Memory::uint8Array> templates{};
+	for (const auto i : (*this->_groups)[item]) {
+		const std::string &id = (*this->_keys)[i];
+		try {
+			templates.push_back(this->_rs->read(id));
+		} catch (const BE::Error::Exception &e) {
+			throw BE::Error::StrategyError("Could not read search "
+			    "template " + id + " (" + e.whatString() + ")");
+		}
+	}
+
+	return (templates);
+}
+
 /******************************************************************************/
 
 int
@@ -9,6 +9,7 @@
  * quality, reliability, or any other characteristic.
  */
 
+#include <functional>
 #include <string>
 
 #include <be_framework_api.h>
@@ -17,6 +18,14 @@
 #include <be_process_forkmanager.h>
 
 #include <n2n.h>
+#include <n2nv_api.h>
+#include <n2nv_latency.h>
+#include <n2nv_memory.h>
+#include <n2nv_output.h>
+#include <n2nv_prefetch.h>
+#include <n2nv_scheduling.h>
+#include <n2nv_trace.h>
+#include <n2nv_warmup.h>
 
 #ifndef N2NV_IDENTSTAGEONE_H_
 #define N2NV_IDENTSTAGEONE_H_
@@ -28,6 +37,17 @@ namespace N2N
 		/** Methods used to drive calls to finalizeEnrollment() */
 		namespace IdentStageOne
 		{
+			/** How nodes are distributed */
+			enum class Mode
+			{
+				/** fork() every node on this machine */
+				Local,
+				/** Serve search templates to remote agents */
+				Coordinator,
+				/** Search one partition for a coordinator */
+				Agent
+			};
+
 			/** Struct to pass around parsed properties */
 			class Arguments
 			{
@@ -50,6 +70,71 @@ namespace N2N
 				uint8_t numNodes{};
 				/** Number of processes per node */
 				uint8_t numProcesses{};
+				/** Number of candidates requested per search */
+				uint16_t candidateListLength{100};
+				/** Whether nodes share running thresholds */
+				bool shareSearchThresholds{false};
+
+				/** How nodes are distributed */
+				Mode mode{Mode::Local};
+				/** Address coordinator listens on */
+				std::string coordinatorAddress{};
+				/** Whether coordinator forks agents locally */
+				bool launchLocalAgents{false};
+				/** Partition searched when running as agent */
+				uint8_t nodeNumber{};
+
+				/** Path to JSON latency summary (optional) */
+				std::string latencySummaryPath{};
+				/**
+				 * Path to Chrome trace-event JSON (optional).
+				 * Agents write their own trace, suffixed with
+				 * their node number.
+				 */
+				std::string tracePath{};
+
+				/**
+				 * Multiple of the 99th percentile latency
+				 * before a call times out (0 for a fixed
+				 * timeout).
+				 */
+				double adaptiveTimeoutMultiplier{};
+				/**
+				 * Multiple of the median latency before an
+				 * idle process searches again (0 to disable).
+				 */
+				double speculationMultiplier{};
+				/**
+				 * Text ending the group ID in search keys, so
+				 * each group is searched together (optional).
+				 */
+				std::string searchGroupDelimiter{};
+				/**
+				 * Whether search processes touch inherited
+				 * memory before their first search.
+				 */
+				bool prefault{false};
+				/**
+				 * Number of searches each process reads ahead
+				 * of the one being searched (0 to disable).
+				 */
+				uint64_t prefetchDepth{};
+				/**
+				 * Number of stage one files each process
+				 * writes at once on behalf of the
+				 * implementation (0 to not offer a writer).
+				 */
+				uint64_t asyncWriteDepth{};
+				/**
+				 * Memory each node's processes may use
+				 * together, in kibibytes (0 for no limit).
+				 */
+				uint64_t ramPerNode{};
+				/**
+				 * Threads each search process may use within
+				 * one call.
+				 */
+				uint16_t threadsPerProcess{1};
 			};
 
 			/**
@@ -87,6 +172,90 @@ namespace N2N
 			run(
 			    const Arguments &args);
 
+			/**
+			 * @brief
+			 * Distribute search templates to one agent per node
+			 * and gather their stage one data.
+			 *
+			 * @param[in] args
+			 * Arguments parsed from procargs().
+			 *
+			 * @return
+			 * Return status to be returned from main().
+			 */
+			int
+			runCoordinator(
+			    const Arguments &args);
+
+			/**
+			 * @brief
+			 * Search one partition on behalf of a coordinator.
+			 * @details
+			 * Search templates are received from the coordinator,
+			 * searched by a NodeWorker exactly as in Mode::Local,
+			 * and the resulting stage one data is returned to the
+			 * coordinator.
+			 *
+			 * @param[in] args
+			 * Arguments parsed from procargs().
+			 * @param[in] stopRequested
+			 * Checked while connecting to the coordinator.
+			 * Connecting stops once it returns true
+			 * (optional).
+			 *
+			 * @return
+			 * Return status to be returned from main().
+			 */
+			int
+			runAgent(
+			    const Arguments &args,
+			    const std::function<bool()> &stopRequested =
+			    nullptr);
+
+			/**
+			 * @brief
+			 * Combine each node's stage one data into a single
+			 * directory per search.
+			 *
+			 * @param[in] args
+			 * Arguments parsed from procargs().
+			 *
+			 * @return
+			 * Return status to be returned from main().
+			 */
+			int
+			mergeStageOneData(
+			    const Arguments &args);
+
+			/** fork()ed object that runs an agent locally */
+			class AgentWorker : public BE::Process::Worker
+			{
+			public:
+				/**
+				 * @brief
+				 * Constructor.
+				 *
+				 * @param[in] nodeNumber
+				 * Partition searched by this agent.
+				 * @param[in] args
+				 * Arguments from procargs() for the
+				 * coordinator.
+				 */
+				AgentWorker(
+				    uint8_t nodeNumber,
+				    const IdentStageOne::Arguments &args);
+
+				/** Default destructor */
+				~AgentWorker() = default;
+
+				int32_t
+				workerMain()
+				    override;
+			private:
+				/** Arguments passed to runAgent() */
+				Arguments _args;
+			};
+
 			/** fork()ed object that acts as an individual node */
 			class NodeWorker : public BE::Process::Worker
 			{
@@ -101,10 +270,15 @@ namespace N2N
 				 * Shared N2N implementation.
 				 * @param[in] args
 				 * Arguments from procargs().
+				 * @param[in] thresholds
+				 * Running thresholds shared with all other
+				 * nodes, or nullptr to not share.
 				 */
 				NodeWorker(
 				    uint8_t nodeNumber,
-				    const IdentStageOne::Arguments &args);
+				    const IdentStageOne::Arguments &args,
+				    const std::shared_ptr<ThresholdTable>
+				    &thresholds);
 
 				/** Default destructor */
 				~NodeWorker() = default;
@@ -122,8 +296,12 @@ namespace N2N
 				/** Node number */
 				const uint8_t _nodeNumber;
 
+				/** Running thresholds shared by all nodes */
+				const std::shared_ptr<ThresholdTable>
+				    _thresholds;
+
 				/** N2N API convenience wrapper */
-				BE::Framework::API<N2N::ReturnStatus> _api{};
+				API<N2N::ReturnStatus> _api{};
 			};
 
 			/** fork()ed object that performs stage one searching */
@@ -132,14 +310,21 @@ namespace N2N
 			public:
 				/** Parameter containing path to log file */
 				static const std::string LogPathParam;
+				/** Parameter containing path to latency file */
+				static const std::string LatencyPathParam;
+				/**
+				 * Parameter containing path to group log file
+				 * (only set when grouped).
+				 */
+				static const std::string GroupLogPathParam;
 
 				/**
 				 * @brief
 				 * Constructor.
 				 *
 				 * @param[in] processNumber
-				 * Process number. Used to naively break apart
-				 * work.
+				 * Process number. Used to name private
+				 * output directories.
 				 * @param[in] nodeNumber
 				 * Node number. Used to know where to store
 				 * output when running multiple "nodes" on a
@@ -148,6 +333,13 @@ namespace N2N
 				 * Shared N2N implementation.
 				 * @param[in] args
 				 * Arguments from procargs().
+				 * @param[in] keys
+				 * Keys of all search templates.
+				 * @param[in] groups
+				 * Indices into `keys` searched together.
+				 * @param[in] queue
+				 * Queue of indices into `groups`, shared with
+				 * all other ProcessWorkers of this node.
 				 *
 				 * @note
 				 * lib->initStageOneIdentification() has been
@@ -157,7 +349,12 @@ namespace N2N
 				    uint8_t processNumber,
 				    uint8_t nodeNumber,
 				    const std::shared_ptr<N2N::Interface> &lib,
-				    const IdentStageOne::Arguments &args);
+				    const IdentStageOne::Arguments &args,
+				    const std::shared_ptr<
+				    const std::vector<std::string>> &keys,
+				    const std::shared_ptr<
+				    const Scheduling::Groups> &groups,
+				    const std::shared_ptr<WorkQueue> &queue);
 
 				/** Default destructor */
 				~ProcessWorker() = default;
@@ -171,15 +368,59 @@ namespace N2N
 
 				/** RecordStore of search templates */
 				std::shared_ptr<BE::IO::RecordStore> _rs;
+				/** Keys of all search templates */
+				const std::shared_ptr<
+				    const std::vector<std::string>> _keys;
+				/** Indices into _keys searched together */
+				const std::shared_ptr<
+				    const Scheduling::Groups> _groups;
+				/** Whether groups are passed to one call */
+				const bool _grouped;
+				/** Text ending the group ID in _keys */
+				const std::string _searchGroupDelimiter;
+				/** Searches to perform, shared by processes */
+				const std::shared_ptr<WorkQueue> _queue;
 
-				/** Number of searches to perform */
-				uint64_t _maxSearches;
+				/** Process number */
+				const uint8_t _processNumber;
 
 				/** Location where _lib writes results */
 				const std::string _stageOneDataDir{};
 
+				/** Multiple of P99 latency before timeout */
+				const double _adaptiveTimeoutMultiplier;
+				/** Multiple of P50 latency before speculating */
+				const double _speculationMultiplier;
+				/** Whether to prefault memory before searching */
+				const bool _prefault;
+				/** Searches read ahead of the current one */
+				const uint64_t _prefetchDepth;
+				/** Files written at once, or 0 for no writer */
+				const uint64_t _asyncWriteDepth;
+
 				/** N2N API convenience wrapper */
-				BE::Framework::API<N2N::ReturnStatus> _api{};
+				API<N2N::ReturnStatus> _api{};
+
+				/** Latency of completed API calls */
+				Latency::HistogramMap _latencies{};
+
+				/**
+				 * @brief
+				 * Read the search templates of one group.
+				 *
+				 * @param[in] item
+				 * Index into _groups.
+				 *
+				 * @return
+				 * Search templates, in the order of the group.
+				 *
+				 * @throw
+				 * A search template could not be read.
+				 */
+				std::vector<BE::Memory::uint8Array>
+				readSearchTemplates(
+				    const uint64_t item)
+				    const;
 			};
 		}
 	}
@@ -11,7 +11,11 @@
 
 #include <sys/stat.h>
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <cmath>
+#include <unordered_map>
 
 #include <n2nv_identStageTwo.h>
 
@@ -20,11 +24,16 @@
 #include <be_io_utility.h>
 #include <be_memory.h>
 #include <be_text.h>
+#include <be_time_timer.h>
 
 using namespace BiometricEvaluation::Framework::Enumeration;
 
 const std::string N2N::Validation::IdentStageTwo::Worker::LogPathParam{
     "_log"};
+const std::string N2N::Validation::IdentStageTwo::Worker::LatencyPathParam{
+    "_latency"};
+const std::string N2N::Validation::IdentStageTwo::Worker::GroupLogPathParam{
+    "_groupLog"};
 
 static std::string
 escapeNewlines(
@@ -37,6 +46,22 @@ escapeNewlines(
 	return (s);
 }
 
+static std::string
+formatCandidates(
+    const std::vector<N2N::Candidate> &candidates)
+{
+	if (candidates.size() == 0)
+		return ("[<[]>]");
+
+	std::string s{"[<["};
+	for (const auto &candidate : candidates)
+		s += candidate.templateID + ',' +
+		    std::to_string(candidate.similarity) + ';';
+	s.pop_back();
+	s += "]>]";
+	return (s);
+}
+
 N2N::Validation::IdentStageTwo::Arguments
 N2N::Validation::IdentStageTwo::procargs(
     int argc,
@@ -50,6 +75,16 @@ N2N::Validation::IdentStageTwo::procargs(
 	static const std::string NumProcessesKey{"Number of Processes"};
 	static const std::string SearchRSPathKey{"Search Template RecordStore"};
 	static const std::string StageOneDataRootKey{"Stage One Data Root"};
+	static const std::string LatencySummaryKey{"Latency Summary"};
+	static const std::string TracePathKey{"Trace Path"};
+	static const std::string AdaptiveTimeoutKey{
+	    "Adaptive Timeout Multiplier"};
+	static const std::string SpeculationKey{"Speculation Multiplier"};
+	static const std::string PrefaultKey{"Prefault Memory"};
+	static const std::string PrefetchDepthKey{"Prefetch Depth"};
+	static const std::string GroupDelimiterKey{"Search Group Delimiter"};
+	static const std::string CandidateListLengthKey{
+	    "Candidate List Length"};
 
 	static const std::string SearchTemplateTypeValueLatent{"Latent"};
 	static const std::string SearchTemplateValueCapture{"Capture"};
@@ -57,6 +92,14 @@ N2N::Validation::IdentStageTwo::procargs(
 	static const std::string NumProcessesDefault{"1"};
 	static const std::string PrefixDefault{""};
 	static const std::string OutputDirDefault{"."};
+	static const std::string LatencySummaryDefault{""};
+	static const std::string TracePathDefault{""};
+	static const std::string AdaptiveTimeoutDefault{"0"};
+	static const std::string SpeculationDefault{"0"};
+	static const std::string PrefaultDefault{"No"};
+	static const std::string PrefetchDepthDefault{"0"};
+	static const std::string GroupDelimiterDefault{""};
+	static const std::string CandidateListLengthDefault{"100"};
 
 	static const std::string usage{"Usage: " + std::string(argv[0]) + " "
 	    "<properties.conf>\n\nRequired properties:\n"
@@ -72,7 +115,27 @@ N2N::Validation::IdentStageTwo::procargs(
 	    NumProcessesDefault + ")\n"
  	    "\t * " + PrefixKey + " = (default: " + PrefixDefault + ")\n"
 	    "\t * " + OutputDirKey + " = /path/to/directory (default: " +
-	    OutputDirDefault + ")"
+	    OutputDirDefault + ")\n"
+	    "\t * " + LatencySummaryKey + " = /path/to/summary.json (default: "
+	    "none)\n"
+	    "\t * " + TracePathKey + " = /path/to/trace.json (default: none)\n"
+	    "\t * " + AdaptiveTimeoutKey + " = multiple of P99 latency before "
+	    "timeout, 0 for 5 minutes (default: " + AdaptiveTimeoutDefault +
+	    ")\n"
+	    "\t * " + SpeculationKey + " = multiple of P50 latency before "
+	    "searching again, 0 to disable (default: " + SpeculationDefault +
+	    ")\n"
+	    "\t * " + PrefaultKey + " = Yes, No: touch inherited memory "
+	    "before searching (default: " + PrefaultDefault + ")\n"
+	    "\t * " + PrefetchDepthKey + " = searches whose stage one data "
+	    "each process reads ahead, 0 to disable (default: " +
+	    PrefetchDepthDefault + ")\n"
+	    "\t * " + GroupDelimiterKey + " = text ending the group ID in "
+	    "search keys; candidates of each group are also fused (default: "
+	    "none)\n"
+	    "\t * " + CandidateListLengthKey + " = [1,100]: candidates "
+	    "requested per search (default: " + CandidateListLengthDefault +
+	    ")"
 	};
 
 	IdentStageTwo::Arguments args{};
@@ -83,7 +146,15 @@ N2N::Validation::IdentStageTwo::procargs(
 	try {
 		props.reset(new BE::IO::PropertiesFile(
 		    argv[1], BE::IO::Mode::ReadOnly, {
-		    {NumProcessesKey, NumProcessesDefault}}));
+		    {NumProcessesKey, NumProcessesDefault},
+		    {LatencySummaryKey, LatencySummaryDefault},
+		    {TracePathKey, TracePathDefault},
+		    {AdaptiveTimeoutKey, AdaptiveTimeoutDefault},
+		    {SpeculationKey, SpeculationDefault},
+		    {PrefaultKey, PrefaultDefault},
+		    {PrefetchDepthKey, PrefetchDepthDefault},
+		    {GroupDelimiterKey, GroupDelimiterDefault},
+		    {CandidateListLengthKey, CandidateListLengthDefault}}));
 	} catch (const BE::Error::Exception &e) {
 		throw BE::Error::StrategyError("Could not open \"" +
 		    std::string(argv[1]) + "\" (" + e.whatString() + ")");
@@ -159,6 +230,35 @@ N2N::Validation::IdentStageTwo::procargs(
 		throw BE::Error::StrategyError(NumProcessesKey + " can't be 0");
 
 	args.prefix = props->getProperty(PrefixKey);
+	args.latencySummaryPath = props->getProperty(LatencySummaryKey);
+	args.tracePath = props->getProperty(TracePathKey);
+
+	args.adaptiveTimeoutMultiplier = props->getPropertyAsDouble(
+	    AdaptiveTimeoutKey);
+	if (args.adaptiveTimeoutMultiplier < 0)
+		throw BE::Error::StrategyError(AdaptiveTimeoutKey + " can't "
+		    "be negative");
+	args.speculationMultiplier = props->getPropertyAsDouble(
+	    SpeculationKey);
+	if (args.speculationMultiplier < 0)
+		throw BE::Error::StrategyError(SpeculationKey + " can't be "
+		    "negative");
+	args.prefault = props->getPropertyAsBoolean(PrefaultKey);
+	const auto prefetchDepth = props->getPropertyAsInteger(
+	    PrefetchDepthKey);
+	if (prefetchDepth < 0)
+		throw BE::Error::StrategyError(PrefetchDepthKey + " can't be "
+		    "negative");
+	args.prefetchDepth = static_cast<uint64_t>(prefetchDepth);
+	args.searchGroupDelimiter = props->getProperty(GroupDelimiterKey);
+
+	const auto candidateListLength = props->getPropertyAsInteger(
+	    CandidateListLengthKey);
+	if ((candidateListLength < 1) || (candidateListLength > 100))
+		throw BE::Error::StrategyError(CandidateListLengthKey + " must "
+		    "be in [1,100]");
+	args.candidateListLength = static_cast<uint16_t>(
+	    candidateListLength);
 
 	args.outputDirectory = props->getProperty(OutputDirKey);
 	if (BE::IO::Utility::makePath(args.outputDirectory, S_IRWXU | S_IRWXG)
@@ -173,35 +273,72 @@ int
 N2N::Validation::IdentStageTwo::run(
     const N2N::Validation::IdentStageTwo::Arguments &args)
 {
+	if (!args.tracePath.empty())
+		Trace::enable(args.tracePath);
+
 	auto lib = N2N::Interface::getImplementation();
 
-	BE::Framework::API<N2N::ReturnStatus> api;
+	N2N::Validation::API<N2N::ReturnStatus> api;
 	api.getWatchdog()->setInterval(
 	    10 * 60 * BE::Time::MicrosecondsPerSecond);
 
 	const auto result = api.call([&]() -> N2N::ReturnStatus {
-		return (lib->initIdentificationStageTwo(args.configDir,
-		    args.enrollDir, args.searchTemplateType));
+		const auto status = lib->initIdentificationStageTwo(
+		    args.configDir, args.enrollDir, args.searchTemplateType);
+		if (status.code != StatusCode::Success)
+			return (status);
+		return (lib->setCandidateListLength(
+		    args.candidateListLength));
 	});
 	if (!result || (result.status.code != StatusCode::Success))
 		throw BE::Error::StrategyError("initIdentificationStageTwo "
 		    "failed");
 
+	Latency::HistogramMap latencies{};
+	latencies["initIdentificationStageTwo"].record(result.elapsed);
+
+	/* Groups of searches are claimed by whichever Worker is free */
+	const auto keys = std::make_shared<const std::vector<std::string>>(
+	    Scheduling::readKeys(args.searchRSPath));
+	const auto groups = std::make_shared<const Scheduling::Groups>(
+	    Scheduling::groupKeys(*keys, args.searchGroupDelimiter));
+	if (args.numProcesses > groups->size())
+		throw BE::Error::StrategyError("Not enough processes for data "
+		    "(" + std::to_string(args.numProcesses) + " processes, "
+		    "and " + std::to_string(groups->size()) + " searches in " +
+		    args.searchRSPath + ')');
+	const auto queue = std::make_shared<WorkQueue>(groups->size());
+
 	/* Create [1,N] Workers */
 	std::vector<std::shared_ptr<BE::Process::WorkerController>> workers;
+	std::vector<std::string> latencyPaths{};
 	BE::Process::ForkManager manager{};
 	for (uint8_t i{0}; i < args.numProcesses; ++i) {
 		workers.emplace_back(manager.addWorker(
-		    std::make_shared<IdentStageTwo::Worker>(i, lib, args)));
+		    std::make_shared<IdentStageTwo::Worker>(i, lib, args, keys,
+		    groups, queue)));
 		workers.back()->setParameter(IdentStageTwo::Worker::
 		    LogPathParam, std::make_shared<std::string>(
 		    args.outputDirectory + '/' + args.prefix +
 		    std::to_string(i) + ".log" ));
+		latencyPaths.push_back(args.outputDirectory + '/' +
+		    args.prefix + std::to_string(i) + ".latency");
+		workers.back()->setParameter(IdentStageTwo::Worker::
+		    LatencyPathParam, std::make_shared<std::string>(
+		    latencyPaths.back()));
+		if (!args.searchGroupDelimiter.empty())
+			workers.back()->setParameter(IdentStageTwo::Worker::
+			    GroupLogPathParam, std::make_shared<std::string>(
+			    args.outputDirectory + '/' + args.prefix +
+			    std::to_string(i) + ".groups.log"));
 	}
 
 	/* fork and wait */
+	BE::Time::Timer wall{};
 	try {
+		wall.start();
 		manager.startWorkers();
+		wall.stop();
 	} catch (const BE::Error::Exception &e) {
 		std::cout << "A node encountered an exception (" <<
 		    e.whatString() << ")..." << std::endl;
@@ -216,40 +353,77 @@ N2N::Validation::IdentStageTwo::run(
 		}
 	}
 
+	Latency::mergeWorkerFiles(latencies, latencyPaths);
+	Latency::report(latencies, wall.elapsed(), args.latencySummaryPath);
+	Trace::merge();
+
 	return (EXIT_SUCCESS);
 }
 
+std::vector<N2N::Candidate>
+N2N::Validation::IdentStageTwo::fuseCandidates(
+    const std::vector<std::vector<Candidate>> &candidates,
+    const uint16_t candidateListLength)
+{
+	/* Best similarity of each template across all probes */
+	std::vector<Candidate> fused{};
+	std::unordered_map<std::string, uint64_t> positions{};
+	for (const auto &list : candidates) {
+		for (const auto &candidate : list) {
+			const auto it = positions.find(candidate.templateID);
+			if (it == positions.end()) {
+				positions.emplace(candidate.templateID,
+				    fused.size());
+				fused.push_back(candidate);
+			} else if (candidate.similarity >
+			    fused[it->second].similarity) {
+				fused[it->second].similarity =
+				    candidate.similarity;
+			}
+		}
+	}
+
+	std::stable_sort(fused.begin(), fused.end(),
+	    [](const Candidate &lhs, const Candidate &rhs) -> bool {
+		return (lhs.similarity > rhs.similarity);
+	});
+	if (fused.size() > candidateListLength)
+		fused.resize(candidateListLength);
+
+	return (fused);
+}
+
 /******************************************************************************/
 
 N2N::Validation::IdentStageTwo::Worker::Worker(
     uint8_t processNumber,
     const std::shared_ptr<N2N::Interface> &lib,
-    const IdentStageTwo::Arguments &args) :
+    const IdentStageTwo::Arguments &args,
+    const std::shared_ptr<const std::vector<std::string>> &keys,
+    const std::shared_ptr<const Scheduling::Groups> &groups,
+    const std::shared_ptr<WorkQueue> &queue) :
     _lib{lib},
-    _rs{BE::IO::RecordStore::openRecordStore(args.searchRSPath)},
-    _maxSearches{static_cast<uint64_t>(std::ceil(
-        this->_rs->getCount() / static_cast<float>(args.numProcesses)))},
-    _stageOneDataDir{args.stageOneDataRoot}
+    _keys{keys},
+    _groups{groups},
+    _grouped{!args.searchGroupDelimiter.empty()},
+    _searchGroupDelimiter{args.searchGroupDelimiter},
+    _candidateListLength{args.candidateListLength},
+    _queue{queue},
+    _processNumber{processNumber},
+    _stageOneDataDir{args.stageOneDataRoot},
+    _adaptiveTimeoutMultiplier{args.adaptiveTimeoutMultiplier},
+    _speculationMultiplier{args.speculationMultiplier},
+    _prefault{args.prefault},
+    _prefetchDepth{args.prefetchDepth}
 {
-	if (args.numProcesses > this->_rs->getCount())
-		throw BE::Error::StrategyError("Not enough processes for data "
-		    "(" + std::to_string(args.numProcesses) + " processes, "
-		    "and " + std::to_string(this->_rs->getCount()) + " "
-		    "searches in " + this->_rs->getPathname() + ')');
 
-	/* Naive partitioning: sequence ahead */
-	const uint64_t stopIndex{processNumber * this->_maxSearches};
-	try {
-		for (uint64_t i{0}; i < stopIndex; ++i)
-			static_cast<void>(this->_rs->sequenceKey());
-	} catch (BE::Error::ObjectDoesNotExist) {
-		/* Too few records for this many processes */
-	}
 }
 
 int32_t
 N2N::Validation::IdentStageTwo::Worker::workerMain()
 {
+	Trace::beginProcess();
+
 	std::unique_ptr<BE::IO::FileLogsheet> log;
 	try {
 		log = BE::Memory::make_unique<BE::IO::FileLogsheet>(
@@ -262,62 +436,220 @@ N2N::Validation::IdentStageTwo::Worker::workerMain()
 		    e.whatString() << std::endl;
 		return (EXIT_FAILURE);
 	}
+	std::unique_ptr<BE::IO::FileLogsheet> groupLog;
+	if (this->_grouped) {
+		try {
+			groupLog = BE::Memory::make_unique<BE::IO::FileLogsheet>(
+			    this->getParameterAsString(GroupLogPathParam),
+			    "EntryType EntryNum GroupID Probes Candidates");
+		} catch (BE::Error::Exception &e) {
+			std::cout << "Could not create " +
+			    this->getParameterAsString(GroupLogPathParam) +
+			    ": " + e.whatString() << std::endl;
+			return (EXIT_FAILURE);
+		}
+	}
 	std::string logLine{};
 	std::string dataDir{};
 
 	/* Allow 5 minutes maximum per call */
-	this->_api.getWatchdog()->setInterval(
-	    5 * 60 * BE::Time::MicrosecondsPerSecond);
+	static const uint64_t MaximumTimeout{5 * 60 *
+	    BE::Time::MicrosecondsPerSecond};
+	this->_api.getWatchdog()->setInterval(MaximumTimeout);
+
+	/* Per-process setup, kept out of the first search's latency */
+	Trace::Span initSpan{"initWorker"};
+	const auto init = this->_api.call([&]() -> N2N::ReturnStatus {
+		return (this->_lib->initWorker(this->_processNumber));
+	});
+	initSpan.end();
+	if (!init || (init.status.code != N2N::StatusCode::Success)) {
+		std::cout << "initWorker() failed in process " <<
+		    std::to_string(this->_processNumber) << std::endl;
+		return (EXIT_FAILURE);
+	}
+	this->_latencies["initWorker"].record(init.elapsed);
+
+	if (this->_prefault) {
+		Trace::Span prefaultSpan{"prefault"};
+		BE::Time::Timer timer{};
+		timer.start();
+		Warmup::prefault();
+		timer.stop();
+		this->_latencies["prefault"].record(timer.elapsed());
+	}
 
-	for (uint64_t i{0}; i < this->_maxSearches; ++i) {
-		/* Get next search template */
-		std::string key;
-		try {
-			key = this->_rs->sequenceKey();
-		} catch (BE::Error::ObjectDoesNotExist) {
-			break;
+	auto &latency = this->_latencies["identifyTemplateStageTwo"];
+	/* First search is reported apart from steady state */
+	auto &firstLatency = this->_latencies[Warmup::getFirstCallName(
+	    "identifyTemplateStageTwo")];
+	uint64_t speculativeAttempts{0}, speculativeWins{0}, discarded{0};
+
+	/*
+	 * Searches claimed ahead of time, whose stage one data is read into
+	 * the page cache by a helper thread.
+	 */
+	std::unique_ptr<Prefetcher<uint64_t>> prefetcher{};
+	if (this->_prefetchDepth > 0)
+		prefetcher.reset(new Prefetcher<uint64_t>(
+		    [this](const uint64_t item) -> uint64_t {
+			uint64_t advised{0};
+			for (const auto i : (*this->_groups)[item])
+				advised += Prefetch::adviseDirectory(
+				    this->_stageOneDataDir + '/' +
+				    (*this->_keys)[i]);
+			return (advised);
+		}));
+
+	for (;;) {
+		/* Claim the next search, or help with a straggler */
+		bool speculative{false};
+		uint64_t item{WorkQueue::None};
+		if (prefetcher == nullptr) {
+			item = this->_queue->claim();
+			if (item != WorkQueue::None)
+				this->_queue->begin(item);
+		} else {
+			while (prefetcher->size() < this->_prefetchDepth) {
+				const uint64_t next{this->_queue->claim()};
+				if (next == WorkQueue::None)
+					break;
+				prefetcher->push(next);
+			}
+
+			if (prefetcher->size() > 0) {
+				Trace::Span prefetchSpan{"prefetch"};
+				uint64_t advised{};
+				item = prefetcher->pop(advised);
+				prefetchSpan.end();
+
+				this->_queue->begin(item);
+			}
+		}
+		if (item == WorkQueue::None) {
+			const uint64_t age{Scheduling::getStragglerAge(
+			    latency, this->_speculationMultiplier)};
+			if (age == 0)
+				break;
+
+			bool exhausted{};
+			item = this->_queue->claimStraggler(age, exhausted);
+			if (item == WorkQueue::None) {
+				if (exhausted)
+					break;
+				usleep(Scheduling::PollMicroseconds);
+				continue;
+			}
+			speculative = true;
+			++speculativeAttempts;
+		}
+		const auto &members = (*this->_groups)[item];
+
+		/* Search every member of the group */
+		std::vector<API<N2N::ReturnStatus>::Result> results{};
+		std::vector<std::vector<Candidate>> candidates(members.size());
+		results.reserve(members.size());
+		for (uint64_t m{0}; m < members.size(); ++m) {
+			const std::string &key = (*this->_keys)[members[m]];
+
+			dataDir.clear();
+			dataDir = this->_stageOneDataDir + '/' + key;
+			Trace::Span chmodSpan{"chmod"};
+			chmod(dataDir.c_str(), S_IRUSR | S_IXUSR | S_IRGRP |
+			    S_IXGRP);
+			chmodSpan.end();
+
+			candidates[m].reserve(this->_candidateListLength);
+			Trace::Span apiSpan{"identifyTemplateStageTwo"};
+			results.push_back(this->_api.call(
+			    [&]() -> N2N::ReturnStatus {
+				return (this->_lib->identifyTemplateStageTwo(
+				    key, dataDir, candidates[m]));
+			}));
+			apiSpan.end();
 		}
 
-		dataDir.clear();
-		dataDir = this->_stageOneDataDir + '/' + key;
-		chmod(dataDir.c_str(), S_IRUSR | S_IXUSR | S_IRGRP | S_IXGRP);
-
-		std::vector<Candidate> candidates;
-		candidates.reserve(100);
-		const auto result = this->_api.call([&]() -> N2N::ReturnStatus {
-			return (this->_lib->identifyTemplateStageTwo(
-			    key, dataDir, candidates));
-		});
-
-		/* Logging */
-		logLine.clear();
-		logLine += key + ' ' + std::to_string(result.elapsed) + ' ' +
-		    std::to_string(to_int_type(result.currentState)) + ' ';
-		if (result) {
-			logLine += std::to_string(static_cast<
-			    std::underlying_type<N2N::StatusCode>::type>(
-			    result.status.code)) + ' ';
-
-			if (candidates.size() == 0)
-				logLine += "[<[]>] ";
-			else {
-				logLine += "[<[";
-				for (const auto &candidate : candidates)
-					logLine += candidate.templateID + ',' +
-					    std::to_string(
-					    candidate.similarity) + ';';
-				logLine.pop_back();
-				logLine += "]>] ";
+		/* First attempt to finish is the only one logged */
+		if (!this->_queue->complete(item)) {
+			++discarded;
+			continue;
+		}
+		if (speculative)
+			++speculativeWins;
+
+		Trace::Span logSpan{"log"};
+		for (uint64_t m{0}; m < members.size(); ++m) {
+			const std::string &key = (*this->_keys)[members[m]];
+			const auto &result = results[m];
+
+			if (result && (firstLatency.getCount() == 0) &&
+			    (latency.getCount() == 0)) {
+				firstLatency.record(result.elapsed);
+			} else if (result) {
+				latency.record(result.elapsed);
+				if ((latency.getCount() %
+				    Scheduling::MinimumObservations) == 0)
+					this->_api.getWatchdog()->setInterval(
+					    Scheduling::getTimeout(latency,
+					    this->_adaptiveTimeoutMultiplier,
+					    MaximumTimeout));
 			}
 
-			logLine += "[<[" +
-			    escapeNewlines(result.status.info) + "]>]";
-		} else
-			logLine += "NA [<[]>] [<[]>]";
+			/* Logging */
+			logLine.clear();
+			logLine += key + ' ' + std::to_string(result.elapsed) +
+			    ' ' + std::to_string(to_int_type(
+			    result.currentState)) + ' ';
+			if (result) {
+				logLine += std::to_string(static_cast<
+				    std::underlying_type<N2N::StatusCode>::type>(
+				    result.status.code)) + ' ' +
+				    formatCandidates(candidates[m]) + ' ';
+
+				logLine += "[<[" +
+				    escapeNewlines(result.status.info) + "]>]";
+			} else
+				logLine += "NA [<[]>] [<[]>]";
+
+			*log << logLine;
+			log->newEntry();
+
+			/* Only successful searches contribute to the group */
+			if (!result ||
+			    (result.status.code != N2N::StatusCode::Success))
+				candidates[m].clear();
+		}
+
+		if (groupLog) {
+			logLine.clear();
+			logLine += Scheduling::getGroupID(
+			    (*this->_keys)[members.front()],
+			    this->_searchGroupDelimiter) + ' ' +
+			    std::to_string(members.size()) + ' ' +
+			    formatCandidates(fuseCandidates(candidates,
+			    this->_candidateListLength));
+			*groupLog << logLine;
+			groupLog->newEntry();
+		}
+	}
+
+	if (speculativeAttempts != 0)
+		std::cout << "Searched " << speculativeAttempts << " "
+		    "straggler(s) again; " << speculativeWins << " finished "
+		    "first" << std::endl;
+	if (discarded != 0)
+		std::cout << "Discarded " << discarded << " result(s) "
+		    "finished first by another process" << std::endl;
 
-		*log << logLine;
-		log->newEntry();
+	try {
+		Latency::write(this->_latencies,
+		    this->getParameterAsString(LatencyPathParam));
+	} catch (const BE::Error::Exception &e) {
+		std::cout << "Could not write latencies for process " <<
+		    std::to_string(this->_processNumber) << " (" <<
+		    e.whatString() << ")" << std::endl;
 	}
+	Trace::flush();
 
 	return (EXIT_SUCCESS);
 }
@@ -10,6 +10,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include <be_framework_api.h>
 #include <be_io_filelogsheet.h>
@@ -17,6 +18,12 @@
 #include <be_process_forkmanager.h>
 
 #include <n2n.h>
+#include <n2nv_api.h>
+#include <n2nv_latency.h>
+#include <n2nv_prefetch.h>
+#include <n2nv_scheduling.h>
+#include <n2nv_trace.h>
+#include <n2nv_warmup.h>
 
 #ifndef N2NV_IDENTSTAGETWO_H_
 #define N2NV_IDENTSTAGETWO_H_
@@ -48,6 +55,40 @@ namespace N2N
 				N2N::InputType searchTemplateType{};
 				/** Number of processes */
 				uint8_t numProcesses{};
+				/** Number of candidates requested per search */
+				uint16_t candidateListLength{100};
+				/** Path to JSON latency summary (optional) */
+				std::string latencySummaryPath{};
+				/** Path to Chrome trace-event JSON (optional) */
+				std::string tracePath{};
+
+				/**
+				 * Multiple of the 99th percentile latency
+				 * before a call times out (0 for a fixed
+				 * timeout).
+				 */
+				double adaptiveTimeoutMultiplier{};
+				/**
+				 * Multiple of the median latency before an
+				 * idle process searches again (0 to disable).
+				 */
+				double speculationMultiplier{};
+				/**
+				 * Text ending the group ID in search keys, so
+				 * candidates of each group are also fused
+				 * (optional).
+				 */
+				std::string searchGroupDelimiter{};
+				/**
+				 * Whether search processes touch inherited
+				 * memory before their first search.
+				 */
+				bool prefault{false};
+				/**
+				 * Number of searches whose stage one data each
+				 * process reads ahead (0 to disable).
+				 */
+				uint64_t prefetchDepth{};
 			};
 
 			/**
@@ -85,24 +126,59 @@ namespace N2N
 			run(
 			    const Arguments &args);
 
+			/**
+			 * @brief
+			 * Fuse candidate lists of several searches of the same
+			 * subject.
+			 *
+			 * @param[in] candidates
+			 * Candidate lists, one per search.
+			 * @param[in] candidateListLength
+			 * Maximum number of fused candidates.
+			 *
+			 * @return
+			 * Each template ID with the highest similarity it
+			 * received from any search, sorted by descending
+			 * similarity and truncated to `candidateListLength`.
+			 */
+			std::vector<Candidate>
+			fuseCandidates(
+			    const std::vector<std::vector<Candidate>>
+			    &candidates,
+			    const uint16_t candidateListLength);
+
 			/** fork()ed object that performs stage one searching */
 			class Worker : public BE::Process::Worker
 			{
 			public:
 				/** Parameter containing path to log file */
 				static const std::string LogPathParam;
+				/** Parameter containing path to latency file */
+				static const std::string LatencyPathParam;
+				/**
+				 * Parameter containing path to fused group
+				 * log file (only set when grouped).
+				 */
+				static const std::string GroupLogPathParam;
 
 				/**
 				 * @brief
 				 * Constructor.
 				 *
 				 * @param[in] processNumber
-				 * Process number. Used to naively break apart
-				 * work.
+				 * Process number.
 				 * @param[in] lib
 				 * Shared N2N implementation.
 				 * @param[in] args
 				 * Arguments from procargs().
+				 * @param[in] keys
+				 * Keys of all search templates.
+				 * @param[in] groups
+				 * Indices into `keys` whose candidates are
+				 * fused.
+				 * @param[in] queue
+				 * Queue of indices into `groups`, shared with
+				 * all other Workers.
 				 *
 				 * @note
 				 * lib->initStageTwoIdentification() has been
@@ -111,7 +187,12 @@ namespace N2N
 				Worker(
 				    uint8_t processNumber,
 				    const std::shared_ptr<N2N::Interface> &lib,
-				    const IdentStageTwo::Arguments &args);
+				    const IdentStageTwo::Arguments &args,
+				    const std::shared_ptr<
+				    const std::vector<std::string>> &keys,
+				    const std::shared_ptr<
+				    const Scheduling::Groups> &groups,
+				    const std::shared_ptr<WorkQueue> &queue);
 
 				/** Default destructor */
 				~Worker() = default;
@@ -123,17 +204,41 @@ namespace N2N
 				/** Shared N2N implementation */
 				const std::shared_ptr<N2N::Interface> _lib{};
 
-				/** RecordStore of search templates */
-				std::shared_ptr<BE::IO::RecordStore> _rs;
-
-				/** Number of searches to perform */
-				uint64_t _maxSearches;
+				/** Keys of all search templates */
+				const std::shared_ptr<
+				    const std::vector<std::string>> _keys;
+				/** Indices into _keys fused together */
+				const std::shared_ptr<
+				    const Scheduling::Groups> _groups;
+				/** Whether groups are fused */
+				const bool _grouped;
+				/** Text ending the group ID in _keys */
+				const std::string _searchGroupDelimiter;
+				/** Number of candidates requested per search */
+				const uint16_t _candidateListLength;
+				/** Searches to perform, shared by Workers */
+				const std::shared_ptr<WorkQueue> _queue;
+
+				/** Process number */
+				const uint8_t _processNumber;
 
 				/** Location where _lib writes results */
 				const std::string _stageOneDataDir{};
 
+				/** Multiple of P99 latency before timeout */
+				const double _adaptiveTimeoutMultiplier;
+				/** Multiple of P50 latency before speculating */
+				const double _speculationMultiplier;
+				/** Whether to prefault memory before searching */
+				const bool _prefault;
+				/** Searches read ahead of the current one */
+				const uint64_t _prefetchDepth;
+
 				/** N2N API convenience wrapper */
-				BE::Framework::API<N2N::ReturnStatus> _api{};
+				API<N2N::ReturnStatus> _api{};
+
+				/** Latency of completed API calls */
+				Latency::HistogramMap _latencies{};
 			};
 		}
 	}
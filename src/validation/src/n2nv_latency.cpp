@@ -0,0 +1,326 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <be_error.h>
+#include <be_io_utility.h>
+
+#include <n2nv_latency.h>
+
+namespace BE = BiometricEvaluation;
+
+/** Percentiles reported by the summaries */
+static const std::vector<std::pair<std::string, double>> Percentiles{
+    {"P50", 50}, {"P90", 90}, {"P99", 99}, {"P99.9", 99.9}};
+
+N2N::Validation::LatencyHistogram::LatencyHistogram() :
+    _buckets((64 - SubBucketBits + 1) * SubBucketCount, 0)
+{
+
+}
+
+size_t
+N2N::Validation::LatencyHistogram::getBucket(
+    const uint64_t value)
+{
+	/* Exact below two full ranges of sub-buckets */
+	if (value < (2 * SubBucketCount))
+		return (value);
+
+	const uint8_t bitLength = 64 - __builtin_clzll(value);
+	const uint8_t shift = bitLength - (SubBucketBits + 1);
+	return (((shift + 1) * SubBucketCount) +
+	    ((value >> shift) - SubBucketCount));
+}
+
+uint64_t
+N2N::Validation::LatencyHistogram::getBucketMax(
+    const size_t bucket)
+{
+	if (bucket < (2 * SubBucketCount))
+		return (bucket);
+
+	const uint8_t shift = (bucket / SubBucketCount) - 1;
+	const uint64_t subBucket = (bucket % SubBucketCount) + SubBucketCount;
+	return (((subBucket + 1) << shift) - 1);
+}
+
+void
+N2N::Validation::LatencyHistogram::record(
+    const uint64_t microseconds)
+{
+	++this->_buckets[getBucket(microseconds)];
+	++this->_count;
+	this->_sum += microseconds;
+	this->_max = std::max(this->_max, microseconds);
+}
+
+void
+N2N::Validation::LatencyHistogram::merge(
+    const LatencyHistogram &other)
+{
+	for (size_t i{0}; i < this->_buckets.size(); ++i)
+		this->_buckets[i] += other._buckets[i];
+	this->_count += other._count;
+	this->_sum += other._sum;
+	this->_max = std::max(this->_max, other._max);
+}
+
+uint64_t
+N2N::Validation::LatencyHistogram::getCount()
+    const
+{
+	return (this->_count);
+}
+
+uint64_t
+N2N::Validation::LatencyHistogram::getMax()
+    const
+{
+	return (this->_max);
+}
+
+double
+N2N::Validation::LatencyHistogram::getMean()
+    const
+{
+	if (this->_count == 0)
+		return (0);
+	return (static_cast<double>(this->_sum) / this->_count);
+}
+
+uint64_t
+N2N::Validation::LatencyHistogram::getPercentile(
+    const double percentile)
+    const
+{
+	if (this->_count == 0)
+		return (0);
+
+	const uint64_t rank = std::max<uint64_t>(1, std::ceil(
+	    (std::min(percentile, 100.0) / 100.0) * this->_count));
+	uint64_t seen{0};
+	for (size_t i{0}; i < this->_buckets.size(); ++i) {
+		seen += this->_buckets[i];
+		if (seen >= rank)
+			return (std::min(getBucketMax(i), this->_max));
+	}
+
+	return (this->_max);
+}
+
+std::string
+N2N::Validation::LatencyHistogram::serialize()
+    const
+{
+	std::ostringstream s{};
+	s << this->_count << ' ' << this->_sum << ' ' << this->_max;
+	for (size_t i{0}; i < this->_buckets.size(); ++i)
+		if (this->_buckets[i] != 0)
+			s << ' ' << i << ':' << this->_buckets[i];
+	return (s.str());
+}
+
+N2N::Validation::LatencyHistogram
+N2N::Validation::LatencyHistogram::deserialize(
+    const std::string &serialized)
+{
+	LatencyHistogram histogram{};
+
+	std::istringstream s{serialized};
+	if (!(s >> histogram._count >> histogram._sum >> histogram._max))
+		throw BE::Error::StrategyError("Malformed latency histogram");
+
+	std::string bucket{};
+	while (s >> bucket) {
+		const auto colon = bucket.find(':');
+		if (colon == std::string::npos)
+			throw BE::Error::StrategyError("Malformed latency "
+			    "histogram bucket: " + bucket);
+
+		size_t index{};
+		uint64_t count{};
+		try {
+			index = std::stoull(bucket.substr(0, colon));
+			count = std::stoull(bucket.substr(colon + 1));
+		} catch (const std::exception &) {
+			throw BE::Error::StrategyError("Malformed latency "
+			    "histogram bucket: " + bucket);
+		}
+		if (index >= histogram._buckets.size())
+			throw BE::Error::StrategyError("Latency histogram "
+			    "bucket out of range: " + bucket);
+		histogram._buckets[index] = count;
+	}
+
+	return (histogram);
+}
+
+/******************************************************************************/
+
+std::string
+N2N::Validation::Latency::serialize(
+    const HistogramMap &histograms)
+{
+	/* One method per line: name, then histogram */
+	std::string serialized{};
+	for (const auto &h : histograms)
+		serialized += h.first + ' ' + h.second.serialize() + '\n';
+	return (serialized);
+}
+
+void
+N2N::Validation::Latency::mergeSerialized(
+    HistogramMap &histograms,
+    const std::string &serialized)
+{
+	std::istringstream s{serialized};
+	std::string line{};
+	while (std::getline(s, line)) {
+		if (line.empty())
+			continue;
+		const auto space = line.find(' ');
+		if (space == std::string::npos)
+			throw BE::Error::StrategyError("Malformed latency "
+			    "histograms");
+		histograms[line.substr(0, space)].merge(
+		    LatencyHistogram::deserialize(line.substr(space + 1)));
+	}
+}
+
+void
+N2N::Validation::Latency::write(
+    const HistogramMap &histograms,
+    const std::string &path)
+{
+	const auto serialized = serialize(histograms);
+	BE::IO::Utility::writeFile(reinterpret_cast<const uint8_t *>(
+	    serialized.data()), serialized.size(), path, std::ios_base::out |
+	    std::ios_base::trunc);
+}
+
+void
+N2N::Validation::Latency::mergeFile(
+    HistogramMap &histograms,
+    const std::string &path)
+{
+	const auto file = BE::IO::Utility::readFile(path, std::ios_base::in);
+	if (file.size() == 0)
+		return;
+	mergeSerialized(histograms, std::string(reinterpret_cast<const char *>(
+	    &file[0]), file.size()));
+}
+
+void
+N2N::Validation::Latency::printSummary(
+    std::ostream &stream,
+    const HistogramMap &histograms,
+    const uint64_t wallMicroseconds)
+{
+	const double wallSeconds = static_cast<double>(wallMicroseconds) /
+	    1000000.0;
+	const auto flags = stream.flags();
+	const auto precision = stream.precision();
+
+	stream << "Method Count Throughput Mean";
+	for (const auto &p : Percentiles)
+		stream << ' ' << p.first;
+	stream << " Max\n";
+
+	for (const auto &h : histograms) {
+		stream << h.first << ' ' << h.second.getCount() << ' ' <<
+		    std::fixed << std::setprecision(2) <<
+		    (wallSeconds > 0 ? h.second.getCount() / wallSeconds : 0) <<
+		    ' ' << h.second.getMean();
+		for (const auto &p : Percentiles)
+			stream << ' ' << h.second.getPercentile(p.second);
+		stream << ' ' << h.second.getMax() << '\n';
+	}
+	stream << "(Throughput in calls/second over " << wallSeconds <<
+	    " seconds; latencies in microseconds)" << std::endl;
+
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+void
+N2N::Validation::Latency::writeSummaryJSON(
+    const std::string &path,
+    const HistogramMap &histograms,
+    const uint64_t wallMicroseconds)
+{
+	const double wallSeconds = static_cast<double>(wallMicroseconds) /
+	    1000000.0;
+
+	std::ofstream json{path, std::ios_base::out | std::ios_base::trunc};
+	if (!json)
+		throw BE::Error::FileError("Could not open " + path);
+
+	json << "{\n\t\"wallMicroseconds\": " << wallMicroseconds << ",\n" <<
+	    "\t\"methods\": {";
+	bool first{true};
+	for (const auto &h : histograms) {
+		json << (first ? "\n" : ",\n") << "\t\t\"" << h.first <<
+		    "\": {\n" <<
+		    "\t\t\t\"count\": " << h.second.getCount() << ",\n" <<
+		    "\t\t\t\"throughput\": " << (wallSeconds > 0 ?
+		    h.second.getCount() / wallSeconds : 0) << ",\n" <<
+		    "\t\t\t\"mean\": " << h.second.getMean() << ",\n";
+		for (const auto &p : Percentiles) {
+			std::string key{p.first};
+			std::transform(key.begin(), key.end(), key.begin(),
+			    ::tolower);
+			json << "\t\t\t\"" << key << "\": " <<
+			    h.second.getPercentile(p.second) << ",\n";
+		}
+		json << "\t\t\t\"max\": " << h.second.getMax() << "\n\t\t}";
+		first = false;
+	}
+	json << "\n\t}\n}\n";
+
+	if (!json)
+		throw BE::Error::FileError("Could not write " + path);
+}
+
+void
+N2N::Validation::Latency::mergeWorkerFiles(
+    HistogramMap &histograms,
+    const std::vector<std::string> &paths)
+{
+	for (const auto &path : paths) {
+		try {
+			mergeFile(histograms, path);
+		} catch (const BE::Error::Exception &e) {
+			std::cout << "Could not merge latencies from " << path <<
+			    " (" << e.whatString() << ")" << std::endl;
+			continue;
+		}
+		std::remove(path.c_str());
+	}
+}
+
+void
+N2N::Validation::Latency::report(
+    const HistogramMap &histograms,
+    const uint64_t wallMicroseconds,
+    const std::string &jsonPath)
+{
+	printSummary(std::cout, histograms, wallMicroseconds);
+	if (!jsonPath.empty())
+		writeSummaryJSON(jsonPath, histograms, wallMicroseconds);
+}
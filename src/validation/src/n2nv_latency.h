@@ -0,0 +1,288 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifndef N2NV_LATENCY_H_
+#define N2NV_LATENCY_H_
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Histogram of call latencies.
+		 * @details
+		 * Values are bucketed log-linearly, in the style of
+		 * HdrHistogram: values below 256 are exact, and larger values
+		 * are recorded with a relative error below 1%. Recording is
+		 * constant time and never allocates.
+		 */
+		class LatencyHistogram
+		{
+		public:
+			/** Constructor */
+			LatencyHistogram();
+
+			/**
+			 * @brief
+			 * Record one observation.
+			 *
+			 * @param[in] microseconds
+			 * Observed latency.
+			 */
+			void
+			record(
+			    const uint64_t microseconds);
+
+			/**
+			 * @brief
+			 * Add all observations from another histogram.
+			 *
+			 * @param[in] other
+			 * Histogram to add.
+			 */
+			void
+			merge(
+			    const LatencyHistogram &other);
+
+			/** @return Number of observations */
+			uint64_t
+			getCount()
+			    const;
+
+			/** @return Largest observation */
+			uint64_t
+			getMax()
+			    const;
+
+			/** @return Mean of all observations */
+			double
+			getMean()
+			    const;
+
+			/**
+			 * @brief
+			 * Obtain the value at a percentile.
+			 *
+			 * @param[in] percentile
+			 * Percentile, [0,100].
+			 *
+			 * @return
+			 * Highest value equivalent to the observation at
+			 * `percentile`, or 0 if there are no observations.
+			 */
+			uint64_t
+			getPercentile(
+			    const double percentile)
+			    const;
+
+			/** @return Text representation, for merging later */
+			std::string
+			serialize()
+			    const;
+
+			/**
+			 * @brief
+			 * Parse the output of serialize().
+			 *
+			 * @param[in] serialized
+			 * Output of serialize().
+			 *
+			 * @return
+			 * Histogram represented by `serialized`.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * `serialized` is malformed.
+			 */
+			static LatencyHistogram
+			deserialize(
+			    const std::string &serialized);
+
+		private:
+			/** log2 of linear buckets per power of two */
+			static const uint8_t SubBucketBits{7};
+			/** Linear buckets per power of two */
+			static const uint64_t SubBucketCount{
+			    UINT64_C(1) << SubBucketBits};
+
+			/** @return Bucket containing `value` */
+			static size_t
+			getBucket(
+			    const uint64_t value);
+
+			/** @return Highest value in `bucket` */
+			static uint64_t
+			getBucketMax(
+			    const size_t bucket);
+
+			/** Observations per bucket */
+			std::vector<uint64_t> _buckets;
+			/** Number of observations */
+			uint64_t _count{0};
+			/** Sum of observations */
+			uint64_t _sum{0};
+			/** Largest observation */
+			uint64_t _max{0};
+		};
+
+		/** Summarizing LatencyHistograms from multiple processes */
+		namespace Latency
+		{
+			/** Histograms keyed by API method name */
+			using HistogramMap = std::map<std::string,
+			    LatencyHistogram>;
+
+			/**
+			 * @brief
+			 * Write histograms so that a parent process can
+			 * merge them.
+			 *
+			 * @param[in] histograms
+			 * Histograms to write.
+			 * @param[in] path
+			 * File to write.
+			 *
+			 * @throw BE::Error::FileError
+			 * Could not write `path`.
+			 */
+			void
+			write(
+			    const HistogramMap &histograms,
+			    const std::string &path);
+
+			/**
+			 * @brief
+			 * Merge histograms written by write() into
+			 * `histograms`.
+			 *
+			 * @param[in,out] histograms
+			 * Histograms to merge into.
+			 * @param[in] path
+			 * File written by write().
+			 *
+			 * @throw BE::Error::Exception
+			 * Could not read or parse `path`.
+			 */
+			void
+			mergeFile(
+			    HistogramMap &histograms,
+			    const std::string &path);
+
+			/** @return Text representation of `histograms` */
+			std::string
+			serialize(
+			    const HistogramMap &histograms);
+
+			/**
+			 * @brief
+			 * Merge the output of serialize() into `histograms`.
+			 *
+			 * @param[in,out] histograms
+			 * Histograms to merge into.
+			 * @param[in] serialized
+			 * Output of serialize().
+			 *
+			 * @throw BE::Error::StrategyError
+			 * `serialized` is malformed.
+			 */
+			void
+			mergeSerialized(
+			    HistogramMap &histograms,
+			    const std::string &serialized);
+
+			/**
+			 * @brief
+			 * Print count, throughput, mean, percentiles, and
+			 * maximum latency for each method.
+			 *
+			 * @param[in] stream
+			 * Where to print.
+			 * @param[in] histograms
+			 * Histograms to summarize.
+			 * @param[in] wallMicroseconds
+			 * Wall time for all calls, used for throughput.
+			 */
+			void
+			printSummary(
+			    std::ostream &stream,
+			    const HistogramMap &histograms,
+			    const uint64_t wallMicroseconds);
+
+			/**
+			 * @brief
+			 * Write the contents of printSummary() as JSON.
+			 *
+			 * @param[in] path
+			 * File to write.
+			 * @param[in] histograms
+			 * Histograms to summarize.
+			 * @param[in] wallMicroseconds
+			 * Wall time for all calls, used for throughput.
+			 *
+			 * @throw BE::Error::FileError
+			 * Could not write `path`.
+			 */
+			void
+			writeSummaryJSON(
+			    const std::string &path,
+			    const HistogramMap &histograms,
+			    const uint64_t wallMicroseconds);
+
+			/**
+			 * @brief
+			 * Merge and then remove the files written by write()
+			 * from each worker.
+			 * @details
+			 * Files that cannot be read (e.g., from a worker that
+			 * crashed) are reported on standard output and left
+			 * in place.
+			 *
+			 * @param[in,out] histograms
+			 * Histograms to merge into.
+			 * @param[in] paths
+			 * Files written by write().
+			 */
+			void
+			mergeWorkerFiles(
+			    HistogramMap &histograms,
+			    const std::vector<std::string> &paths);
+
+			/**
+			 * @brief
+			 * Print a summary to standard output and optionally
+			 * save it as JSON.
+			 *
+			 * @param[in] histograms
+			 * Histograms to summarize.
+			 * @param[in] wallMicroseconds
+			 * Wall time for all calls, used for throughput.
+			 * @param[in] jsonPath
+			 * Where to write the JSON summary, or empty to skip.
+			 *
+			 * @throw BE::Error::FileError
+			 * Could not write `jsonPath`.
+			 */
+			void
+			report(
+			    const HistogramMap &histograms,
+			    const uint64_t wallMicroseconds,
+			    const std::string &jsonPath);
+		}
+	}
+}
+
+#endif /* N2NV_LATENCY_H_ */
@@ -8,13 +8,21 @@
  * about its quality, reliability, or any other characteristic.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
 
 #include <be_data_interchange_an2k.h>
 #include <be_io_archiverecstore.h>
+#include <be_io_compressedrecstore.h>
 #include <be_io_propertiesfile.h>
 #include <be_text.h>
+#include <be_time_timer.h>
 
 #include <n2nv_makeTemplates.h>
 
@@ -22,6 +30,188 @@ using namespace BiometricEvaluation::Framework::Enumeration;
 
 const std::string N2N::Validation::MakeTemplates::Worker::ORSPathParam{"_oRS"};
 const std::string N2N::Validation::MakeTemplates::Worker::LogPathParam{"_log"};
+const std::string N2N::Validation::MakeTemplates::Worker::LatencyPathParam{
+    "_latency"};
+const std::string N2N::Validation::MakeTemplates::Worker::QualityPathParam{
+    "_quality"};
+const std::string N2N::Validation::MakeTemplates::Worker::HashPathParam{
+    "_hash"};
+
+/** NFIQ2 value of a capture whose quality was not calculated */
+static const uint8_t NFIQ2NotCalculated{254};
+/** NFIQ2 value of a capture whose quality could not be calculated */
+static const uint8_t NFIQ2Error{255};
+/** Highest NFIQ2 quality value */
+static const uint8_t NFIQ2Maximum{100};
+
+/**
+ * @brief
+ * Combine per-process NFIQ2 counts and remove their files.
+ *
+ * @param[in] paths
+ * Files written by Worker::workerMain(), each a line per NFIQ2 value
+ * ("<value> <count>") followed by "Skipped <count>".
+ * @param[out] qualities
+ * Number of captures with each NFIQ2 value.
+ * @param[out] skipped
+ * Number of captures not passed.
+ */
+static void
+mergeQualityFiles(
+    const std::vector<std::string> &paths,
+    std::vector<uint64_t> &qualities,
+    uint64_t &skipped)
+{
+	qualities.assign(256, 0);
+	skipped = 0;
+	for (const auto &path : paths) {
+		std::ifstream file{path};
+		if (!file) {
+			std::cout << "Could not merge qualities from " <<
+			    path << std::endl;
+			continue;
+		}
+
+		std::string value{};
+		uint64_t count{};
+		while (file >> value >> count) {
+			if (value == "Skipped")
+				skipped += count;
+			else
+				qualities.at(std::stoul(value)) += count;
+		}
+		file.close();
+		std::remove(path.c_str());
+	}
+}
+
+/**
+ * @brief
+ * Print the distribution of NFIQ2 values of all captures.
+ *
+ * @param[in] qualities
+ * Number of captures with each NFIQ2 value.
+ * @param[in] skipped
+ * Number of captures not passed.
+ */
+static void
+printQualitySummary(
+    const std::vector<uint64_t> &qualities,
+    const uint64_t skipped)
+{
+	static const uint8_t BinWidth{20};
+
+	std::cout << "NFIQ2 Count\n";
+	for (uint16_t low{0}; low < NFIQ2Maximum; low += BinWidth) {
+		/* Last bin includes the maximum */
+		const uint16_t high{static_cast<uint16_t>(((low + BinWidth) >=
+		    NFIQ2Maximum) ? NFIQ2Maximum : (low + BinWidth - 1))};
+		uint64_t count{0};
+		for (uint16_t q{low}; q <= high; ++q)
+			count += qualities[q];
+		std::cout << '[' << low << ',' << high << "] " << count <<
+		    '\n';
+	}
+	std::cout << "NotCalculated " << qualities[NFIQ2NotCalculated] <<
+	    "\nError " << qualities[NFIQ2Error] << "\nSkipped " << skipped <<
+	    std::endl;
+}
+
+/**
+ * @brief
+ * Hash the contents of a template (64-bit FNV-1a).
+ *
+ * @param[in] tmpl
+ * Template to hash.
+ *
+ * @return
+ * Hash of `tmpl`, as 16 hexadecimal digits.
+ */
+static std::string
+hashTemplate(
+    const BE::Memory::uint8Array &tmpl)
+{
+	uint64_t hash{UINT64_C(0xCBF29CE484222325)};
+	for (uint64_t i{0}; i < tmpl.size(); ++i) {
+		hash ^= tmpl[i];
+		hash *= UINT64_C(0x100000001B3);
+	}
+
+	std::ostringstream out{};
+	out << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return (out.str());
+}
+
+/**
+ * @brief
+ * Print how many output templates have identical contents.
+ *
+ * @param[in] paths
+ * Files written by Worker::workerMain(), each a line per template
+ * ("<key> <hash>").
+ */
+static void
+printDuplicateSummary(
+    const std::vector<std::string> &paths)
+{
+	std::map<std::string, uint64_t> hashes{};
+	uint64_t count{0};
+	for (const auto &path : paths) {
+		std::ifstream file{path};
+		std::string key{}, hash{};
+		while (file >> key >> hash) {
+			++hashes[hash];
+			++count;
+		}
+	}
+
+	/* Equal hashes only suggest duplicates; finalization confirms */
+	std::cout << "Templates UniqueHashes Duplicates\n" << count << ' ' <<
+	    hashes.size() << ' ' << (count - hashes.size()) << std::endl;
+}
+
+/**
+ * @brief
+ * Print the compression ratio and decode throughput of output templates.
+ *
+ * @param[in] paths
+ * Paths to RecordStores of output templates.
+ */
+static void
+printCompressionSummary(
+    const std::vector<std::string> &paths)
+{
+	uint64_t count{0}, raw{0}, stored{0}, elapsed{0};
+	for (const auto &path : paths) {
+		try {
+			const auto rs = BE::IO::RecordStore::openRecordStore(
+			    path, BE::IO::Mode::ReadOnly);
+			BE::Time::Timer decode{};
+			decode.start();
+			for (;;) {
+				try {
+					raw += rs->sequence().data.size();
+					++count;
+				} catch (BE::Error::ObjectDoesNotExist) {
+					break;
+				}
+			}
+			decode.stop();
+			elapsed += decode.elapsed();
+			stored += rs->getSpaceUsed();
+		} catch (const BE::Error::Exception &e) {
+			std::cout << "Could not measure compression of " <<
+			    path << " (" << e.whatString() << ")" << std::endl;
+		}
+	}
+
+	const double seconds{elapsed / 1000000.0};
+	std::cout << "Templates RawBytes StoredBytes Ratio DecodeMiBps\n" <<
+	    count << ' ' << raw << ' ' << stored << ' ' << std::fixed <<
+	    std::setprecision(2) << ((stored == 0) ? 0 :
+	    (static_cast<double>(raw) / stored)) << ' ' << ((seconds <= 0) ?
+	    0 : ((raw / (1024.0 * 1024.0)) / seconds)) << std::endl;
+}
 
 N2N::Validation::MakeTemplates::Arguments
 N2N::Validation::MakeTemplates::procargs(
@@ -35,6 +225,13 @@ N2N::Validation::MakeTemplates::procargs(
 	static const std::string OutputDirKey{"Output Directory"};
 	static const std::string StandardRSKey{"Standard RecordStore"};
 	static const std::string ProprietaryRSKey{"Proprietary RecordStore"};
+	static const std::string QualityRSKey{"Quality RecordStore"};
+	static const std::string OrderByQualityKey{"Order By Quality"};
+	static const std::string MinimumQualityKey{"Minimum Quality"};
+	static const std::string TemplateCompressionKey{"Template "
+	    "Compression"};
+	static const std::string LatencySummaryKey{"Latency Summary"};
+	static const std::string TracePathKey{"Trace Path"};
 
 	static const std::string TemplateTypeValueEnrollment{"Enrollment"};
 	static const std::string TemplateTypeValueSearchLatent{"Search Latent"};
@@ -44,6 +241,12 @@ N2N::Validation::MakeTemplates::procargs(
 	static const std::string NumProcessesDefault{"1"};
 	static const std::string OutputDirDefault{"."};
 	static const std::string PrefixDefault{""};
+	static const std::string LatencySummaryDefault{""};
+	static const std::string TracePathDefault{""};
+	static const std::string QualityRSDefault{""};
+	static const std::string OrderByQualityDefault{"No"};
+	static const std::string MinimumQualityDefault{"0"};
+	static const std::string TemplateCompressionDefault{"None"};
 
 	static const std::string usage{"Usage: " + std::string(argv[0]) + " "
 	    "<properties.conf>\n\nRequired properties:\n"
@@ -58,7 +261,18 @@ N2N::Validation::MakeTemplates::procargs(
 	    NumProcessesDefault + ")\n"
 	    "\t * " + PrefixKey + " = (default: " + PrefixDefault + ")\n"
 	    "\t * " + OutputDirKey + " = /path/to/directory (default: " +
-	    OutputDirDefault + ")"
+	    OutputDirDefault + ")\n"
+	    "\t * " + LatencySummaryKey + " = /path/to/summary.json (default: "
+	    "none)\n"
+	    "\t * " + TracePathKey + " = /path/to/trace.json (default: none)\n"
+	    "\t * " + QualityRSKey + " = /path/to/RecordStore (NFIQ2 values "
+	    "per subject; default: none)\n"
+	    "\t * " + OrderByQualityKey + " = Yes/No (default: " +
+	    OrderByQualityDefault + ")\n"
+	    "\t * " + MinimumQualityKey + " = [0,100] (skip captures of lower "
+	    "NFIQ2; default: " + MinimumQualityDefault + ")\n"
+	    "\t * " + TemplateCompressionKey + " = None, GZIP (default: " +
+	    TemplateCompressionDefault + ")"
 	};
 
 	MakeTemplates::Arguments args;
@@ -71,7 +285,13 @@ N2N::Validation::MakeTemplates::procargs(
 		    argv[1], BE::IO::Mode::ReadOnly, {
 			{NumProcessesKey, NumProcessesDefault},
 			{OutputDirKey, OutputDirDefault},
-			{PrefixKey, PrefixDefault}
+			{PrefixKey, PrefixDefault},
+			{LatencySummaryKey, LatencySummaryDefault},
+			{TracePathKey, TracePathDefault},
+			{QualityRSKey, QualityRSDefault},
+			{OrderByQualityKey, OrderByQualityDefault},
+			{MinimumQualityKey, MinimumQualityDefault},
+			{TemplateCompressionKey, TemplateCompressionDefault}
 		    }));
 	} catch (const BE::Error::Exception &e) {
 		throw BE::Error::StrategyError("Could not open \"" +
@@ -128,6 +348,26 @@ N2N::Validation::MakeTemplates::procargs(
 		throw BE::Error::StrategyError(NumProcessesKey + " can't be 0");
 	args.prefix = props->getProperty(PrefixKey);
 	args.outputDirectory = props->getProperty(OutputDirKey);
+	args.latencySummaryPath = props->getProperty(LatencySummaryKey);
+	args.tracePath = props->getProperty(TracePathKey);
+	args.qualityRSPath = props->getProperty(QualityRSKey);
+	args.orderByQuality = props->getPropertyAsBoolean(OrderByQualityKey);
+	const auto minimumQuality = props->getPropertyAsInteger(
+	    MinimumQualityKey);
+	if ((minimumQuality < 0) || (minimumQuality > NFIQ2Maximum))
+		throw BE::Error::StrategyError(MinimumQualityKey + " must be "
+		    "in [0,100]");
+	args.minimumQuality = static_cast<uint8_t>(minimumQuality);
+	if ((args.orderByQuality || (args.minimumQuality != 0)) &&
+	    args.qualityRSPath.empty())
+		throw BE::Error::StrategyError(OrderByQualityKey + " and " +
+		    MinimumQualityKey + " require " + QualityRSKey);
+	const auto compression = props->getProperty(TemplateCompressionKey);
+	if (BE::Text::caseInsensitiveCompare(compression, "GZIP"))
+		args.templateCompression = "GZIP";
+	else if (!BE::Text::caseInsensitiveCompare(compression, "None"))
+		throw BE::Error::StrategyError("Invalid value for property: " +
+		    TemplateCompressionKey + '\n' + usage);
 	if (BE::IO::Utility::makePath(args.outputDirectory, S_IRWXU) != 0)
 		throw BE::Error::StrategyError("Could not make directory (" +
 		    BE::Error::errorStr() + ')');
@@ -139,6 +379,9 @@ int
 N2N::Validation::MakeTemplates::run(
     const N2N::Validation::MakeTemplates::Arguments &args)
 {
+	if (!args.tracePath.empty())
+		Trace::enable(args.tracePath);
+
 	/* Initialize pre-fork */
 	const auto lib = N2N::Interface::getImplementation();
 	switch (args.templateType) {
@@ -155,21 +398,53 @@ N2N::Validation::MakeTemplates::run(
 
 	/* Create [1,P] Workers */
 	BE::Process::ForkManager manager{};
+	std::vector<std::string> latencyPaths{};
+	std::vector<std::string> qualityPaths{};
+	std::vector<std::string> outputPaths{};
+	std::vector<std::string> hashPaths{};
 	for (uint8_t i{0}; i < args.numProcesses; ++i) {
 		auto worker = manager.addWorker(
 		    std::make_shared<MakeTemplates::Worker>(i, lib, args));
 
 		/* Record paths to open after the fork */
+		outputPaths.push_back(args.outputDirectory + '/' +
+		    args.prefix + std::to_string(i) + ".rs");
 		worker->setParameter(Worker::ORSPathParam,
-		    std::make_shared<std::string>(args.outputDirectory + '/' +
-		    args.prefix + std::to_string(i) + ".rs"));
+		    std::make_shared<std::string>(outputPaths.back()));
 		worker->setParameter(Worker::LogPathParam,
 		    std::make_shared<std::string>(args.outputDirectory + '/' +
 		    args.prefix + std::to_string(i) + ".log"));
+		latencyPaths.push_back(args.outputDirectory + '/' +
+		    args.prefix + std::to_string(i) + ".latency");
+		worker->setParameter(Worker::LatencyPathParam,
+		    std::make_shared<std::string>(latencyPaths.back()));
+		qualityPaths.push_back(args.outputDirectory + '/' +
+		    args.prefix + std::to_string(i) + ".quality");
+		worker->setParameter(Worker::QualityPathParam,
+		    std::make_shared<std::string>(qualityPaths.back()));
+		hashPaths.push_back(args.outputDirectory + '/' +
+		    args.prefix + std::to_string(i) + ".hashes");
+		worker->setParameter(Worker::HashPathParam,
+		    std::make_shared<std::string>(hashPaths.back()));
 	}
 
 	/* fork and wait */
+	BE::Time::Timer wall{};
+	wall.start();
 	manager.startWorkers();
+	wall.stop();
+
+	Latency::HistogramMap latencies{};
+	Latency::mergeWorkerFiles(latencies, latencyPaths);
+	Latency::report(latencies, wall.elapsed(), args.latencySummaryPath);
+	std::vector<uint64_t> qualities{};
+	uint64_t skipped{};
+	mergeQualityFiles(qualityPaths, qualities, skipped);
+	printQualitySummary(qualities, skipped);
+	printDuplicateSummary(hashPaths);
+	if (!args.templateCompression.empty())
+		printCompressionSummary(outputPaths);
+	Trace::merge();
 
 	return (EXIT_SUCCESS);
 }
@@ -184,12 +459,18 @@ N2N::Validation::MakeTemplates::Worker::Worker(
     _lib{lib},
     _templateType{args.templateType},
     _sRS{BE::IO::RecordStore::openRecordStore(args.standardRSPath)},
+    _orderByQuality{args.orderByQuality},
+    _minimumQuality{args.minimumQuality},
+    _templateCompression{args.templateCompression},
     _maxRecords{static_cast<uint64_t>(std::ceil(
         _sRS->getCount() / static_cast<float>(args.numProcesses)))}
 {
 	if (!args.proprietaryRSPath.empty())
 		this->_pRS = BE::IO::RecordStore::openRecordStore(
 		    args.proprietaryRSPath);
+	if (!args.qualityRSPath.empty())
+		this->_qRS = BE::IO::RecordStore::openRecordStore(
+		    args.qualityRSPath);
 	if (args.numProcesses > _sRS->getCount())
 		throw BE::Error::StrategyError("Not enough processes for data");
 
@@ -206,35 +487,72 @@ N2N::Validation::MakeTemplates::Worker::Worker(
 int32_t
 N2N::Validation::MakeTemplates::Worker::workerMain()
 {
-	BE::IO::ArchiveRecordStore oRS{this->getParameterAsString(ORSPathParam),
-	    ""};
+	Trace::beginProcess();
+
+	/* Records are compressed individually, so remain randomly accessible */
+	std::shared_ptr<BE::IO::RecordStore> oRS{};
+	if (this->_templateCompression.empty())
+		oRS = std::make_shared<BE::IO::ArchiveRecordStore>(
+		    this->getParameterAsString(ORSPathParam), "");
+	else
+		oRS = std::make_shared<BE::IO::CompressedRecordStore>(
+		    this->getParameterAsString(ORSPathParam), "",
+		    BE::IO::RecordStore::Kind::Archive,
+		    this->_templateCompression);
+	std::ofstream hashes{this->getParameterAsString(HashPathParam),
+	    std::ios_base::out | std::ios_base::trunc};
 	BE::IO::FileLogsheet log{this->getParameterAsString(LogPathParam),
 	    "EntryType EntryNum TemplateID NumStandardInput "
 	    "NumProprietaryInput Time TemplateSize APIState RetCode RetInfo"};
 
+	auto &latency = this->_latencies[this->_templateType ==
+	    Type::Enrollment ? "makeEnrollmentTemplate" : "makeSearchTemplate"];
+
 	BE::Memory::uint8Array outputTemplate{};
 	std::string logLine{};
 	/* Naive partitioning requires us to sequence instead of for-range */
 	for(uint64_t i{0}; i < this->_maxRecords; ++i) {
 		/* Get next subject's imagery (ANSI/NIST-ITL file) */
 		BE::IO::RecordStore::Record record;
+		Trace::Span sequenceSpan{"sequence"};
 		try {
 			record = this->_sRS->sequence();
 		} catch (BE::Error::ObjectDoesNotExist) {
 			break;
 		}
-		const auto standardCaptures = Worker::makeFingerImage(
-		    record.data);
+		sequenceSpan.end();
+
+		Trace::Span parseSpan{"makeFingerImage"};
+		auto standardCaptures = Worker::makeFingerImage(record.data);
+		parseSpan.end();
+
+		/* Precomputed quality lets the best captures go first */
+		Trace::Span qualitySpan{"loadQualities"};
+		const auto qualities = this->loadQualities(record.key,
+		    standardCaptures.size());
+		for (uint64_t c{0}; c < standardCaptures.size(); ++c) {
+			standardCaptures[c].nfiq2 = qualities[c];
+			++this->_qualities[qualities[c]];
+		}
+		this->_skipped += this->prioritizeByQuality(standardCaptures);
+		qualitySpan.end();
 
 		/* Proprietary captures are optional */
+		Trace::Span proprietarySpan{"loadProprietaryImages"};
 		const auto proprietaryCaptures =
 		    this->loadProprietaryImages(record.key);
+		proprietarySpan.end();
 
 		/* Call template generation method */
+		Trace::Span apiSpan{"makeTemplate"};
 		const auto result = this->makeSingleTemplate(standardCaptures,
 		    proprietaryCaptures, outputTemplate);
+		apiSpan.end();
+		if (result)
+			latency.record(result.elapsed);
 
 		/* Logging */
+		Trace::Span logSpan{"log"};
 		logLine.clear();
 		logLine += record.key + ' ' +
 		    std::to_string(standardCaptures.size()) + ' ' +
@@ -252,8 +570,10 @@ N2N::Validation::MakeTemplates::Worker::workerMain()
 			logLine += "NA [<[]>]";
 		log << logLine;
 		log.newEntry();
+		logSpan.end();
 
 		/* Write template */
+		Trace::Span insertSpan{"insert"};
 		switch (this->_templateType) {
 		case Type::Enrollment:
 			/*
@@ -261,7 +581,9 @@ N2N::Validation::MakeTemplates::Worker::workerMain()
 			 * ReturnStatus, will be provided to the enrollment set
 			 * generation step."
 			 */
-			oRS.insert(record.key, outputTemplate);
+			oRS->insert(record.key, outputTemplate);
+			hashes << record.key << ' ' <<
+			    hashTemplate(outputTemplate) << '\n';
 			break;
 		case Type::SearchLatent:
 			/* FALLTHROUGH */
@@ -271,12 +593,35 @@ N2N::Validation::MakeTemplates::Worker::workerMain()
 			 * two-stage identification methods."
 			 */
 			if (result && (result.status.code ==
-			    StatusCode::Success))
-				oRS.insert(record.key, outputTemplate);
+			    StatusCode::Success)) {
+				oRS->insert(record.key, outputTemplate);
+				hashes << record.key << ' ' <<
+				    hashTemplate(outputTemplate) << '\n';
+			}
 			break;
 		}
 	}
 
+	try {
+		Latency::write(this->_latencies,
+		    this->getParameterAsString(LatencyPathParam));
+	} catch (const BE::Error::Exception &e) {
+		std::cout << "Could not write latencies to " <<
+		    this->getParameterAsString(LatencyPathParam) << " (" <<
+		    e.whatString() << ")" << std::endl;
+	}
+	std::string qualityCounts{};
+	for (uint16_t q{0}; q < this->_qualities.size(); ++q)
+		if (this->_qualities[q] != 0)
+			qualityCounts += std::to_string(q) + ' ' +
+			    std::to_string(this->_qualities[q]) + '\n';
+	qualityCounts += "Skipped " + std::to_string(this->_skipped) + '\n';
+	BE::IO::Utility::writeFile(reinterpret_cast<const uint8_t *>(
+	    qualityCounts.data()), qualityCounts.size(),
+	    this->getParameterAsString(QualityPathParam), std::ios_base::out |
+	    std::ios_base::trunc);
+	Trace::flush();
+
 	return (EXIT_SUCCESS);
 }
 
@@ -290,25 +635,22 @@ N2N::Validation::MakeTemplates::Worker::makeSingleTemplate(
 	std::fill(out.begin(), out.end(), 0);
 	out.resize(0);
 
-	/* Remove this branch from timing */
-	std::function<N2N::ReturnStatus(void)> apiFunction;
+	/* Branch outside of timing; each lambda is called directly */
 	switch (this->_templateType) {
 	case Type::Enrollment:
-		apiFunction = [&]() -> N2N::ReturnStatus {
+		return (this->_api.call([&]() -> N2N::ReturnStatus {
 			return (this->_lib->makeEnrollmentTemplate(sIn, pIn,
 			    out));
-		};
-		break;
+		}));
 	case Type::SearchLatent:
 		/* FALLTHROUGH */
 	case Type::SearchCapture:
-		apiFunction = [&]() -> N2N::ReturnStatus {
+		return (this->_api.call([&]() -> N2N::ReturnStatus {
 			return (this->_lib->makeSearchTemplate(sIn, pIn, out));
-		};
-		break;
+		}));
 	}
 
-	return (this->_api.call(apiFunction));
+	throw BE::Error::NotImplemented("Template type");
 }
 
 std::vector<N2N::FingerImage>
@@ -323,7 +665,7 @@ N2N::Validation::MakeTemplates::Worker::makeFingerImage(
 	fingerImages.reserve(captures.size());
 	for (const auto &c : captures)
 		fingerImages.emplace_back(c.getPositions().front(),
-		    c.getImpressionType(), /* TODO: NFIQ2 */ 254,
+		    c.getImpressionType(), NFIQ2NotCalculated,
 		    std::make_shared<BE::Image::Raw>(
 		    BE::Image::Image::getRawImage(c.getImage())));
 
@@ -352,6 +694,77 @@ N2N::Validation::MakeTemplates::Worker::loadProprietaryImages(
 	return (pData);
 }
 
+std::vector<uint8_t>
+N2N::Validation::MakeTemplates::Worker::loadQualities(
+    const std::string &subjectID,
+    const uint64_t count)
+{
+	std::vector<uint8_t> qualities(count, NFIQ2NotCalculated);
+	if (this->_qRS == nullptr)
+		return (qualities);
+
+	BE::Memory::uint8Array record{};
+	try {
+		record = this->_qRS->read(subjectID);
+	} catch (BE::Error::ObjectDoesNotExist) {
+		return (qualities);
+	}
+
+	std::istringstream values{std::string(reinterpret_cast<const char *>(
+	    &record[0]), record.size())};
+	std::string value{};
+	for (uint64_t c{0}; (c < count) && (values >> value); ++c) {
+		try {
+			const auto q = std::stoul(value);
+			qualities[c] = ((q <= NFIQ2Maximum) ||
+			    (q == NFIQ2NotCalculated)) ?
+			    static_cast<uint8_t>(q) : NFIQ2Error;
+		} catch (const std::exception&) {
+			qualities[c] = NFIQ2Error;
+		}
+	}
+
+	return (qualities);
+}
+
+uint64_t
+N2N::Validation::MakeTemplates::Worker::prioritizeByQuality(
+    std::vector<N2N::FingerImage> &images)
+    const
+{
+	if (!this->_orderByQuality && (this->_minimumQuality == 0))
+		return (0);
+
+	/* Unknown quality ranks below every known quality */
+	const auto rank = [](const N2N::FingerImage &image) -> int16_t {
+		return ((image.nfiq2 <= NFIQ2Maximum) ? image.nfiq2 : -1);
+	};
+	if (this->_orderByQuality)
+		std::stable_sort(images.begin(), images.end(),
+		    [&](const N2N::FingerImage &a, const N2N::FingerImage &b) {
+			return (rank(a) > rank(b));
+		    });
+	if ((this->_minimumQuality == 0) || images.empty())
+		return (0);
+
+	/* Unknown quality is not low quality, so never skipped */
+	const auto best = std::max_element(images.cbegin(), images.cend(),
+	    [&](const N2N::FingerImage &a, const N2N::FingerImage &b) {
+		return (rank(a) < rank(b));
+	    }) - images.cbegin();
+	std::vector<N2N::FingerImage> kept{};
+	kept.reserve(images.size());
+	for (uint64_t i{0}; i < images.size(); ++i)
+		if ((static_cast<int64_t>(i) == best) ||
+		    (images[i].nfiq2 > NFIQ2Maximum) ||
+		    (images[i].nfiq2 >= this->_minimumQuality))
+			kept.push_back(images[i]);
+
+	const uint64_t skipped{images.size() - kept.size()};
+	images = std::move(kept);
+	return (skipped);
+}
+
 /******************************************************************************/
 
 int
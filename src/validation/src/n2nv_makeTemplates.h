@@ -22,6 +22,9 @@
 #include <be_process_forkmanager.h>
 
 #include <n2n.h>
+#include <n2nv_api.h>
+#include <n2nv_latency.h>
+#include <n2nv_trace.h>
 
 namespace BE = BiometricEvaluation;
 
@@ -55,6 +58,23 @@ namespace N2N
 				std::string standardRSPath{};
 				/** Path to RecordStore of proprietary input */
 				std::string proprietaryRSPath{};
+				/**
+				 * Path to RecordStore of precomputed NFIQ2
+				 * values (optional).
+				 */
+				std::string qualityRSPath{};
+				/** Whether fingers are passed best first */
+				bool orderByQuality{false};
+				/**
+				 * NFIQ2 value below which captures are not
+				 * passed (0 to pass all).
+				 */
+				uint8_t minimumQuality{};
+				/**
+				 * Compressor of output templates, as named by
+				 * CompressedRecordStore (empty for none).
+				 */
+				std::string templateCompression{};
 
 				/** Path to configuration directory */
 				std::string configDir{};
@@ -62,6 +82,10 @@ namespace N2N
 				std::string outputDirectory{};
 				/** File name prefix */
 				std::string prefix{};
+				/** Path to JSON latency summary (optional) */
+				std::string latencySummaryPath{};
+				/** Path to Chrome trace-event JSON (optional) */
+				std::string tracePath{};
 			};
 
 			/**
@@ -107,6 +131,15 @@ namespace N2N
 				static const std::string ORSPathParam;
 				/** Parameter containing path to log file */
 				static const std::string LogPathParam;
+				/** Parameter containing path to latency file */
+				static const std::string LatencyPathParam;
+				/** Parameter containing path to quality file */
+				static const std::string QualityPathParam;
+				/**
+				 * Parameter containing path to file of
+				 * template content hashes.
+				 */
+				static const std::string HashPathParam;
 
 				/**
 				 * @brief
@@ -184,6 +217,54 @@ namespace N2N
 				loadProprietaryImages(
 				    const std::string &subjectID);
 
+				/**
+				 * @brief
+				 * Load precomputed NFIQ2 values for a subject.
+				 * @details
+				 * The quality RecordStore holds one record per
+				 * subject: whitespace-separated NFIQ2 values,
+				 * one per capture, in the order of captures in
+				 * the subject's ANSI/NIST-ITL file.
+				 *
+				 * @param[in] subjectID
+				 * Subject ID whose values should be loaded.
+				 * @param[in] count
+				 * Number of captures of the subject.
+				 *
+				 * @return
+				 * `count` NFIQ2 values. Values not provided
+				 * are 254 (not calculated), and values that
+				 * can't be parsed are 255 (error).
+				 */
+				std::vector<uint8_t>
+				loadQualities(
+				    const std::string &subjectID,
+				    const uint64_t count);
+
+				/**
+				 * @brief
+				 * Order and filter a subject's captures by
+				 * NFIQ2 value.
+				 * @details
+				 * When ordering, captures are sorted by
+				 * descending NFIQ2 value, followed by those
+				 * whose value is unknown. Captures with a
+				 * known value below the minimum quality are
+				 * removed, except that the best capture is
+				 * always kept.
+				 *
+				 * @param[in,out] images
+				 * Captures of one subject, with NFIQ2 values
+				 * set.
+				 *
+				 * @return
+				 * Number of captures removed.
+				 */
+				uint64_t
+				prioritizeByQuality(
+				    std::vector<N2N::FingerImage> &images)
+				    const;
+
 				/** Default destructor */
 				~Worker() = default;
 
@@ -201,12 +282,30 @@ namespace N2N
 				std::shared_ptr<BE::IO::RecordStore> _sRS;
 				/** RecordStore of proprietary imagery */
 				std::shared_ptr<BE::IO::RecordStore> _pRS;
+				/** RecordStore of NFIQ2 values */
+				std::shared_ptr<BE::IO::RecordStore> _qRS;
+
+				/** Whether fingers are passed best first */
+				const bool _orderByQuality;
+				/** NFIQ2 value below which captures skipped */
+				const uint8_t _minimumQuality;
+				/** Compressor of output templates, or empty */
+				const std::string _templateCompression;
 
 				/** Maximum number of records to enroll */
 				uint64_t _maxRecords{};
 
 				/** N2N API convenience wrapper */
-				BE::Framework::API<N2N::ReturnStatus> _api{};
+				API<N2N::ReturnStatus> _api{};
+
+				/** Latency of completed API calls */
+				Latency::HistogramMap _latencies{};
+
+				/** Number of captures with each NFIQ2 value */
+				std::vector<uint64_t> _qualities =
+				    std::vector<uint64_t>(256);
+				/** Number of captures not passed */
+				uint64_t _skipped{};
 			};
 		}
 	}
@@ -0,0 +1,316 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include <n2nv_memory.h>
+#include <n2nv_prefetch.h>
+
+/** Root of the cgroup v2 hierarchy */
+static const std::string ControlGroupRoot{"/sys/fs/cgroup"};
+/** Time between samples */
+static const std::chrono::milliseconds SampleInterval{100};
+
+/**
+ * @brief
+ * Read a single value from a file.
+ *
+ * @param[in] path
+ * Path to file.
+ * @param[out] value
+ * First value in file.
+ *
+ * @return
+ * true if `value` was read.
+ */
+static bool
+readValue(
+    const std::string &path,
+    uint64_t &value)
+{
+	std::ifstream file{path};
+	return (static_cast<bool>(file >> value));
+}
+
+/**
+ * @brief
+ * Replace the contents of a control file.
+ *
+ * @param[in] path
+ * Path to file.
+ * @param[in] value
+ * New contents.
+ *
+ * @return
+ * true if `value` was accepted.
+ */
+static bool
+writeValue(
+    const std::string &path,
+    const std::string &value)
+{
+	std::ofstream file{path};
+	file << value;
+	file.close();
+	return (!file.fail());
+}
+
+/**
+ * @return
+ * Path to the cgroup v2 control group of this process, or empty if
+ * there is none.
+ */
+static std::string
+getControlGroup()
+{
+	/* cgroup v2 is the entry of hierarchy 0 */
+	std::ifstream file{"/proc/self/cgroup"};
+	std::string line{};
+	while (std::getline(file, line))
+		if (line.compare(0, 3, "0::") == 0)
+			return (ControlGroupRoot + line.substr(3));
+	return ("");
+}
+
+/**
+ * @param[in] group
+ * Path to control group.
+ *
+ * @return
+ * Whether children of `group` have the memory controller.
+ */
+static bool
+hasMemoryController(
+    const std::string &group)
+{
+	std::ifstream file{group + "/cgroup.subtree_control"};
+	std::string controller{};
+	while (file >> controller)
+		if (controller == "memory")
+			return (true);
+	return (false);
+}
+
+/**
+ * @param[in] pid
+ * Process ID.
+ *
+ * @return
+ * Proportional set size of `pid` in bytes, or resident set size where
+ * proportional set size is unavailable. 0 if `pid` has exited.
+ */
+static uint64_t
+getProcessMemory(
+    const pid_t pid)
+{
+	const std::string proc{"/proc/" + std::to_string(pid)};
+
+	std::ifstream rollup{proc + "/smaps_rollup"};
+	std::string line{};
+	while (std::getline(rollup, line)) {
+		if (line.compare(0, 4, "Pss:") != 0)
+			continue;
+		uint64_t kib{};
+		if (std::istringstream(line.substr(4)) >> kib)
+			return (kib * 1024);
+	}
+
+	std::ifstream statm{proc + "/statm"};
+	uint64_t size{}, resident{};
+	if (statm >> size >> resident)
+		return (resident *
+		    static_cast<uint64_t>(sysconf(_SC_PAGESIZE)));
+	return (0);
+}
+
+/**
+ * @param[in] root
+ * Process ID.
+ *
+ * @return
+ * Bytes used by `root` and all of its descendants.
+ */
+static uint64_t
+getProcessTreeMemory(
+    const pid_t root)
+{
+	std::multimap<pid_t, pid_t> children{};
+	std::unique_ptr<DIR, int(*)(DIR*)> proc(::opendir("/proc"),
+	    closedir);
+	if (proc != nullptr) {
+		struct dirent *entry;
+		while ((entry = readdir(proc.get())) != nullptr) {
+			const pid_t pid{static_cast<pid_t>(
+			    std::atol(entry->d_name))};
+			if (pid <= 0)
+				continue;
+
+			/* Parent follows state, after the parenthesized name */
+			std::ifstream stat{"/proc/" + std::string(
+			    entry->d_name) + "/stat"};
+			std::string contents{};
+			std::getline(stat, contents);
+			const auto end = contents.rfind(')');
+			if (end == std::string::npos)
+				continue;
+			std::istringstream fields{contents.substr(end + 1)};
+			std::string state{};
+			pid_t parent{};
+			if (fields >> state >> parent)
+				children.emplace(parent, pid);
+		}
+	}
+
+	uint64_t bytes{0};
+	std::vector<pid_t> pending{root};
+	while (!pending.empty()) {
+		const pid_t pid{pending.back()};
+		pending.pop_back();
+		bytes += getProcessMemory(pid);
+
+		const auto range = children.equal_range(pid);
+		for (auto it = range.first; it != range.second; ++it)
+			pending.push_back(it->second);
+	}
+	return (bytes);
+}
+
+/******************************************************************************/
+
+N2N::Validation::MemoryMonitor::MemoryMonitor(
+    const std::string &name,
+    const uint64_t budget) :
+    _budget{budget},
+    _pid{getpid()}
+{
+	/* Control groups must be delegated; otherwise fall back to sampling */
+	this->_parentGroup = getControlGroup();
+	if (!this->_parentGroup.empty() &&
+	    hasMemoryController(this->_parentGroup)) {
+		const std::string group{this->_parentGroup + "/n2nv-" + name +
+		    '-' + std::to_string(this->_pid)};
+		if (mkdir(group.c_str(), S_IRWXU | S_IRGRP | S_IXGRP |
+		    S_IROTH | S_IXOTH) == 0) {
+			/* No swap, which would hide use beyond the budget */
+			bool limited{true};
+			if (budget != 0) {
+				limited = writeValue(group + "/memory.max",
+				    std::to_string(budget));
+				writeValue(group + "/memory.swap.max", "0");
+			}
+
+			if (limited && writeValue(group + "/cgroup.procs",
+			    "0")) {
+				this->_group = group;
+				this->_method = Method::ControlGroup;
+			} else {
+				rmdir(group.c_str());
+			}
+		}
+	}
+
+	this->_thread = Prefetch::startQuietThread(
+	    [this]() { this->run(); });
+}
+
+N2N::Validation::MemoryMonitor::Method
+N2N::Validation::MemoryMonitor::getMethod()
+    const
+{
+	return (this->_method);
+}
+
+uint64_t
+N2N::Validation::MemoryMonitor::sample()
+    const
+{
+	if (this->_method == Method::ControlGroup) {
+		uint64_t current{0};
+		readValue(this->_group + "/memory.current", current);
+		return (current);
+	}
+	return (getProcessTreeMemory(this->_pid));
+}
+
+void
+N2N::Validation::MemoryMonitor::run()
+{
+	std::unique_lock<std::mutex> lock{this->_mutex};
+	do {
+		lock.unlock();
+		const uint64_t bytes{this->sample()};
+		lock.lock();
+		this->_samples.push_back(bytes);
+	} while (!this->_changed.wait_for(lock, SampleInterval,
+	    [this]() { return (this->_stopping); }));
+}
+
+N2N::Validation::MemoryMonitor::Usage
+N2N::Validation::MemoryMonitor::stop()
+{
+	Usage usage{};
+	if (!this->_thread.joinable())
+		return (usage);
+
+	{
+		std::lock_guard<std::mutex> lock{this->_mutex};
+		this->_stopping = true;
+		this->_changed.notify_all();
+	}
+	this->_thread.join();
+
+	if (!this->_samples.empty()) {
+		usage.peak = *std::max_element(this->_samples.cbegin(),
+		    this->_samples.cend());
+		auto middle = this->_samples.begin() +
+		    (this->_samples.size() / 2);
+		std::nth_element(this->_samples.begin(), middle,
+		    this->_samples.end());
+		usage.steady = *middle;
+	}
+
+	if (this->_method == Method::ControlGroup) {
+		/* The kernel records peaks between samples (Linux 5.19) */
+		uint64_t peak{};
+		if (readValue(this->_group + "/memory.peak", peak))
+			usage.peak = std::max(usage.peak, peak);
+
+		std::ifstream events{this->_group + "/memory.events"};
+		std::string event{};
+		uint64_t count{};
+		while (events >> event >> count)
+			if (event == "oom_kill")
+				usage.oomKills = count;
+
+		writeValue(this->_parentGroup + "/cgroup.procs", "0");
+		rmdir(this->_group.c_str());
+	}
+
+	usage.exceeded = (this->_budget != 0) &&
+	    ((usage.peak > this->_budget) || (usage.oomKills != 0));
+	return (usage);
+}
+
+N2N::Validation::MemoryMonitor::~MemoryMonitor()
+{
+	this->stop();
+}
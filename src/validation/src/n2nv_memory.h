@@ -0,0 +1,141 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_MEMORY_H_
+#define N2NV_MEMORY_H_
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Memory used by a process and all of its descendants.
+		 * @details
+		 * Where the cgroup v2 memory controller is delegated to this
+		 * process, the process moves itself into a child control
+		 * group, whose limit enforces the budget. Otherwise, the
+		 * proportional set size of the process tree is sampled, so
+		 * pages shared after fork() are counted once.
+		 */
+		class MemoryMonitor
+		{
+		public:
+			/** How memory is measured */
+			enum class Method
+			{
+				/** Charges to a cgroup v2 control group */
+				ControlGroup,
+				/** Sampling /proc of each process */
+				Sampling
+			};
+
+			/** Memory used while monitored */
+			struct Usage
+			{
+				/** Most bytes used at once */
+				uint64_t peak{};
+				/** Median of bytes used in each sample */
+				uint64_t steady{};
+				/** Processes killed for exceeding the budget */
+				uint64_t oomKills{};
+				/** Whether the budget was exceeded */
+				bool exceeded{false};
+			};
+
+			/**
+			 * @brief
+			 * Constructor. Starts monitoring the calling process.
+			 *
+			 * @param[in] name
+			 * Name of the control group, made unique by the
+			 * process ID.
+			 * @param[in] budget
+			 * Bytes the process tree may use, or 0 for no limit.
+			 */
+			MemoryMonitor(
+			    const std::string &name,
+			    const uint64_t budget);
+
+			/** @return How memory is measured */
+			Method
+			getMethod()
+			    const;
+
+			/**
+			 * @brief
+			 * Stop monitoring.
+			 * @details
+			 * When using a control group, the calling process
+			 * returns to its original group and the child group is
+			 * removed.
+			 *
+			 * @return
+			 * Memory used while monitored.
+			 *
+			 * @note
+			 * Descendants should have exited.
+			 */
+			Usage
+			stop();
+
+			/** Destructor, stopping if needed */
+			~MemoryMonitor();
+
+			MemoryMonitor(const MemoryMonitor&) = delete;
+			MemoryMonitor& operator=(const MemoryMonitor&) = delete;
+
+		private:
+			/** @return Bytes used now */
+			uint64_t
+			sample()
+			    const;
+
+			/** Sample until stopped */
+			void
+			run();
+
+			/** Bytes the process tree may use, or 0 */
+			const uint64_t _budget;
+			/** Monitored process */
+			const pid_t _pid;
+			/** How memory is measured */
+			Method _method{Method::Sampling};
+			/** Control group the process started in */
+			std::string _parentGroup{};
+			/** Control group created for the process */
+			std::string _group{};
+
+			/** Protects all members below */
+			std::mutex _mutex{};
+			/** Signaled when _stopping changes */
+			std::condition_variable _changed{};
+			/** Whether the sampling thread should exit */
+			bool _stopping{false};
+			/** Bytes used at each sample */
+			std::vector<uint64_t> _samples{};
+
+			/** Sampling thread */
+			std::thread _thread{};
+		};
+	}
+}
+
+#endif /* N2NV_MEMORY_H_ */
@@ -0,0 +1,408 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <be_error.h>
+
+#include <n2nv_network.h>
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags{MSG_NOSIGNAL};
+#else
+static const int SendFlags{0};
+#endif
+
+/** Size of the fixed portion of a framed message */
+static const size_t HeaderLength{1 + 4 + 4 + 8};
+
+/** Largest payload accepted from a peer (4 GiB) */
+static const uint64_t MaxPayloadLength{UINT64_C(4) * 1024 * 1024 * 1024};
+/** Largest key or name accepted from a peer, which are paths at most */
+static const uint64_t MaxFieldLength{PATH_MAX};
+
+/**
+ * @brief
+ * Split an address into its components.
+ *
+ * @param[in] address
+ * `unix:/path/to/socket` or `tcp:host:port`.
+ * @param[out] unixPath
+ * Path to UNIX socket, or empty if TCP.
+ * @param[out] host
+ * TCP host name, or empty.
+ * @param[out] port
+ * TCP port, or empty.
+ */
+static void
+parseAddress(
+    const std::string &address,
+    std::string &unixPath,
+    std::string &host,
+    std::string &port)
+{
+	static const std::string UnixPrefix{"unix:"};
+	static const std::string TCPPrefix{"tcp:"};
+
+	unixPath.clear();
+	host.clear();
+	port.clear();
+
+	if (address.compare(0, UnixPrefix.size(), UnixPrefix) == 0) {
+		unixPath = address.substr(UnixPrefix.size());
+		if (unixPath.empty() ||
+		    (unixPath.size() >= sizeof(sockaddr_un::sun_path)))
+			throw BE::Error::StrategyError("Invalid UNIX socket "
+			    "path: " + address);
+	} else if (address.compare(0, TCPPrefix.size(), TCPPrefix) == 0) {
+		const auto hostPort = address.substr(TCPPrefix.size());
+		const auto colon = hostPort.rfind(':');
+		if (colon == std::string::npos)
+			throw BE::Error::StrategyError("Missing port: " +
+			    address);
+		host = hostPort.substr(0, colon);
+		port = hostPort.substr(colon + 1);
+		if (port.empty())
+			throw BE::Error::StrategyError("Missing port: " +
+			    address);
+	} else {
+		throw BE::Error::StrategyError("Address must begin with " +
+		    UnixPrefix + " or " + TCPPrefix + ": " + address);
+	}
+}
+
+/** Write exactly `length` bytes to `fd` */
+static void
+writeAll(
+    int fd,
+    const uint8_t *buffer,
+    uint64_t length)
+{
+	while (length > 0) {
+		const auto written = ::send(fd, buffer, length, SendFlags);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			throw BE::Error::FileError("Could not write to socket "
+			    "(" + BE::Error::errorStr() + ')');
+		}
+		buffer += written;
+		length -= written;
+	}
+}
+
+/** Read exactly `length` bytes from `fd` */
+static void
+readAll(
+    int fd,
+    uint8_t *buffer,
+    uint64_t length)
+{
+	while (length > 0) {
+		const auto numRead = ::recv(fd, buffer, length, 0);
+		if (numRead < 0) {
+			if (errno == EINTR)
+				continue;
+			throw BE::Error::FileError("Could not read from socket "
+			    "(" + BE::Error::errorStr() + ')');
+		}
+		if (numRead == 0)
+			throw BE::Error::FileError("Peer closed connection");
+		buffer += numRead;
+		length -= numRead;
+	}
+}
+
+/** Serialize `value` big-endian into `buffer` */
+static void
+encode(
+    uint8_t *buffer,
+    uint64_t value,
+    uint8_t numBytes)
+{
+	for (uint8_t i{0}; i < numBytes; ++i)
+		buffer[i] = (value >> (8 * (numBytes - i - 1))) & 0xFF;
+}
+
+/** Deserialize big-endian `numBytes` from `buffer` */
+static uint64_t
+decode(
+    const uint8_t *buffer,
+    uint8_t numBytes)
+{
+	uint64_t value{0};
+	for (uint8_t i{0}; i < numBytes; ++i)
+		value = (value << 8) | buffer[i];
+	return (value);
+}
+
+/******************************************************************************/
+
+N2N::Validation::Network::Connection::Connection(
+    int fd) :
+    _fd{fd}
+{
+#ifdef SO_NOSIGPIPE
+	int on{1};
+	::setsockopt(this->_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+
+std::shared_ptr<N2N::Validation::Network::Connection>
+N2N::Validation::Network::Connection::connect(
+    const std::string &address,
+    const uint32_t timeoutSeconds,
+    const std::function<bool()> &stopRequested)
+{
+	std::string unixPath{}, host{}, port{};
+	parseAddress(address, unixPath, host, port);
+
+	std::string lastError{};
+	for (uint32_t attempt{0}; attempt <= timeoutSeconds; ++attempt) {
+		if (attempt != 0) {
+			::sleep(1);
+			if (stopRequested && stopRequested()) {
+				lastError = "stop requested";
+				break;
+			}
+		}
+
+		if (!unixPath.empty()) {
+			const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (fd < 0)
+				throw BE::Error::StrategyError("Could not "
+				    "create socket (" + BE::Error::errorStr() +
+				    ')');
+
+			sockaddr_un sun{};
+			sun.sun_family = AF_UNIX;
+			std::strncpy(sun.sun_path, unixPath.c_str(),
+			    sizeof(sun.sun_path) - 1);
+			if (::connect(fd, reinterpret_cast<sockaddr *>(&sun),
+			    sizeof(sun)) == 0)
+				return (std::make_shared<Connection>(fd));
+			lastError = BE::Error::errorStr();
+			::close(fd);
+			continue;
+		}
+
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo *results{nullptr};
+		const int rv = ::getaddrinfo(host.empty() ? nullptr :
+		    host.c_str(), port.c_str(), &hints, &results);
+		if (rv != 0) {
+			lastError = ::gai_strerror(rv);
+			continue;
+		}
+		std::unique_ptr<addrinfo, void(*)(addrinfo*)> resultsGuard(
+		    results, ::freeaddrinfo);
+
+		for (addrinfo *ai{results}; ai != nullptr; ai = ai->ai_next) {
+			const int fd = ::socket(ai->ai_family, ai->ai_socktype,
+			    ai->ai_protocol);
+			if (fd < 0) {
+				lastError = BE::Error::errorStr();
+				continue;
+			}
+			if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+				return (std::make_shared<Connection>(fd));
+			lastError = BE::Error::errorStr();
+			::close(fd);
+		}
+	}
+
+	throw BE::Error::StrategyError("Could not connect to " + address +
+	    " (" + lastError + ')');
+}
+
+void
+N2N::Validation::Network::Connection::send(
+    const Message &message)
+{
+	if ((message.key.size() > MaxFieldLength) ||
+	    (message.name.size() > MaxFieldLength))
+		throw BE::Error::FileError("Message key or name too long");
+
+	uint8_t header[HeaderLength];
+	header[0] = static_cast<uint8_t>(message.type);
+	encode(header + 1, message.key.size(), 4);
+	encode(header + 5, message.name.size(), 4);
+	encode(header + 9, message.data.size(), 8);
+
+	writeAll(this->_fd, header, HeaderLength);
+	writeAll(this->_fd, reinterpret_cast<const uint8_t *>(
+	    message.key.data()), message.key.size());
+	writeAll(this->_fd, reinterpret_cast<const uint8_t *>(
+	    message.name.data()), message.name.size());
+	writeAll(this->_fd, message.data, message.data.size());
+}
+
+N2N::Validation::Network::Message
+N2N::Validation::Network::Connection::receive()
+{
+	uint8_t header[HeaderLength];
+	readAll(this->_fd, header, HeaderLength);
+
+	Message message{};
+	message.type = static_cast<MessageType>(header[0]);
+	const uint64_t keyLength{decode(header + 1, 4)};
+	const uint64_t nameLength{decode(header + 5, 4)};
+	const uint64_t dataLength{decode(header + 9, 8)};
+	if (dataLength > MaxPayloadLength)
+		throw BE::Error::FileError("Message payload too large (" +
+		    std::to_string(dataLength) + " bytes)");
+	if ((keyLength > MaxFieldLength) || (nameLength > MaxFieldLength))
+		throw BE::Error::FileError("Message key or name too long (" +
+		    std::to_string(keyLength) + ", " +
+		    std::to_string(nameLength) + " bytes)");
+
+	message.key.resize(keyLength);
+	if (keyLength > 0)
+		readAll(this->_fd, reinterpret_cast<uint8_t *>(
+		    &message.key[0]), keyLength);
+	message.name.resize(nameLength);
+	if (nameLength > 0)
+		readAll(this->_fd, reinterpret_cast<uint8_t *>(
+		    &message.name[0]), nameLength);
+	message.data.resize(dataLength);
+	readAll(this->_fd, message.data, dataLength);
+
+	return (message);
+}
+
+N2N::Validation::Network::Connection::~Connection()
+{
+	if (this->_fd >= 0)
+		::close(this->_fd);
+}
+
+/******************************************************************************/
+
+N2N::Validation::Network::Listener::Listener(
+    const std::string &address)
+{
+	std::string host{}, port{};
+	parseAddress(address, this->_unixPath, host, port);
+
+	if (!this->_unixPath.empty()) {
+		this->_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (this->_fd < 0)
+			throw BE::Error::StrategyError("Could not create "
+			    "socket (" + BE::Error::errorStr() + ')');
+
+		/* Remove socket left behind from a previous run */
+		::unlink(this->_unixPath.c_str());
+
+		sockaddr_un sun{};
+		sun.sun_family = AF_UNIX;
+		std::strncpy(sun.sun_path, this->_unixPath.c_str(),
+		    sizeof(sun.sun_path) - 1);
+		if (::bind(this->_fd, reinterpret_cast<sockaddr *>(&sun),
+		    sizeof(sun)) != 0) {
+			const auto error = BE::Error::errorStr();
+			::close(this->_fd);
+			throw BE::Error::StrategyError("Could not bind " +
+			    address + " (" + error + ')');
+		}
+	} else {
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE;
+		addrinfo *results{nullptr};
+		const int rv = ::getaddrinfo(host.empty() ? nullptr :
+		    host.c_str(), port.c_str(), &hints, &results);
+		if (rv != 0)
+			throw BE::Error::StrategyError("Could not resolve " +
+			    address + " (" + ::gai_strerror(rv) + ')');
+		std::unique_ptr<addrinfo, void(*)(addrinfo*)> resultsGuard(
+		    results, ::freeaddrinfo);
+
+		std::string lastError{};
+		for (addrinfo *ai{results}; ai != nullptr; ai = ai->ai_next) {
+			this->_fd = ::socket(ai->ai_family, ai->ai_socktype,
+			    ai->ai_protocol);
+			if (this->_fd < 0) {
+				lastError = BE::Error::errorStr();
+				continue;
+			}
+
+			int on{1};
+			::setsockopt(this->_fd, SOL_SOCKET, SO_REUSEADDR, &on,
+			    sizeof(on));
+			if (::bind(this->_fd, ai->ai_addr, ai->ai_addrlen) ==
+			    0)
+				break;
+			lastError = BE::Error::errorStr();
+			::close(this->_fd);
+			this->_fd = -1;
+		}
+		if (this->_fd < 0)
+			throw BE::Error::StrategyError("Could not bind " +
+			    address + " (" + lastError + ')');
+	}
+
+	if (::listen(this->_fd, SOMAXCONN) != 0) {
+		const auto error = BE::Error::errorStr();
+		::close(this->_fd);
+		throw BE::Error::StrategyError("Could not listen on " +
+		    address + " (" + error + ')');
+	}
+}
+
+std::shared_ptr<N2N::Validation::Network::Connection>
+N2N::Validation::Network::Listener::accept(
+    const uint32_t timeoutSeconds)
+{
+	for (;;) {
+		if (timeoutSeconds != 0) {
+			pollfd pfd{};
+			pfd.fd = this->_fd;
+			pfd.events = POLLIN;
+			const int rv = ::poll(&pfd, 1, timeoutSeconds * 1000);
+			if (rv == 0)
+				throw BE::Error::StrategyError("Timed out "
+				    "waiting for connection");
+			if (rv < 0) {
+				if (errno == EINTR)
+					continue;
+				throw BE::Error::FileError("Could not wait for "
+				    "connection (" + BE::Error::errorStr() +
+				    ')');
+			}
+		}
+
+		const int fd = ::accept(this->_fd, nullptr, nullptr);
+		if (fd >= 0)
+			return (std::make_shared<Connection>(fd));
+		if (errno != EINTR)
+			throw BE::Error::FileError("Could not accept "
+			    "connection (" + BE::Error::errorStr() + ')');
+	}
+}
+
+N2N::Validation::Network::Listener::~Listener()
+{
+	if (this->_fd >= 0)
+		::close(this->_fd);
+	if (!this->_unixPath.empty())
+		::unlink(this->_unixPath.c_str());
+}
@@ -0,0 +1,226 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <be_memory_autoarray.h>
+
+#ifndef N2NV_NETWORK_H_
+#define N2NV_NETWORK_H_
+
+namespace BE = BiometricEvaluation;
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/** Transport between a stage one coordinator and its agents */
+		namespace Network
+		{
+			/** Kinds of messages exchanged */
+			enum class MessageType : uint8_t
+			{
+				/** Agent -> coordinator: `key` is node number */
+				Hello = 1,
+				/** Coordinator -> agent: one search template */
+				Search = 2,
+				/** Coordinator -> agent: no more searches */
+				EndOfSearches = 3,
+				/**
+				 * Agent -> coordinator: one stage one file.
+				 * `key` is the search ID, `name` is the path
+				 * relative to the search's data directory.
+				 */
+				StageOneData = 4,
+				/** Agent -> coordinator: node succeeded */
+				Done = 5,
+				/** Agent -> coordinator: `name` is reason */
+				Failed = 6,
+				/**
+				 * Agent -> coordinator: `data` is the node's
+				 * serialized latency histograms.
+				 */
+				Latency = 7
+			};
+
+			/** A single framed message */
+			struct Message
+			{
+				/** Constructor */
+				Message() = default;
+
+				/**
+				 * @brief
+				 * Constructor.
+				 *
+				 * @param[in] type
+				 * Kind of message.
+				 * @param[in] key
+				 * Message key.
+				 * @param[in] name
+				 * Message name.
+				 */
+				Message(
+				    const MessageType type,
+				    const std::string &key = "",
+				    const std::string &name = "") :
+				    type{type},
+				    key{key},
+				    name{name} {}
+
+				/** Kind of message */
+				MessageType type{MessageType::Failed};
+				/** Primary identifier (meaning varies) */
+				std::string key{};
+				/** Secondary identifier (meaning varies) */
+				std::string name{};
+				/** Payload */
+				BE::Memory::uint8Array data{};
+			};
+
+			/** A connected stream socket */
+			class Connection
+			{
+			public:
+				/**
+				 * @brief
+				 * Constructor.
+				 *
+				 * @param[in] fd
+				 * Connected socket. Closed on destruction.
+				 */
+				Connection(
+				    int fd);
+
+				/**
+				 * @brief
+				 * Connect to a listening coordinator.
+				 *
+				 * @param[in] address
+				 * `unix:/path/to/socket` or `tcp:host:port`.
+				 * @param[in] timeoutSeconds
+				 * Seconds to keep retrying while the
+				 * coordinator is not yet listening.
+				 * @param[in] stopRequested
+				 * Checked before each retry. Retrying stops
+				 * once it returns true (optional).
+				 *
+				 * @return
+				 * Connected socket.
+				 *
+				 * @throw BE::Error::StrategyError
+				 * Malformed address or connection failure.
+				 */
+				static std::shared_ptr<Connection>
+				connect(
+				    const std::string &address,
+				    const uint32_t timeoutSeconds = 60,
+				    const std::function<bool()> &stopRequested =
+				    nullptr);
+
+				/**
+				 * @brief
+				 * Send a message.
+				 *
+				 * @param[in] message
+				 * Message to send.
+				 *
+				 * @throw BE::Error::FileError
+				 * Error writing to socket, or key or name
+				 * longer than PATH_MAX.
+				 */
+				void
+				send(
+				    const Message &message);
+
+				/**
+				 * @brief
+				 * Block until a message is received.
+				 *
+				 * @return
+				 * Received message.
+				 *
+				 * @throw BE::Error::FileError
+				 * Error reading from socket, peer closed the
+				 * connection, or the message is too large.
+				 * Key and name are at most PATH_MAX bytes,
+				 * and data at most 4 GiB.
+				 */
+				Message
+				receive();
+
+				/** Destructor */
+				~Connection();
+
+				Connection(const Connection&) = delete;
+				Connection &operator=(const Connection&) = delete;
+			private:
+				/** Connected socket */
+				int _fd{-1};
+			};
+
+			/** A listening stream socket */
+			class Listener
+			{
+			public:
+				/**
+				 * @brief
+				 * Constructor.
+				 *
+				 * @param[in] address
+				 * `unix:/path/to/socket` or `tcp:host:port`.
+				 * An empty host binds all interfaces.
+				 *
+				 * @throw BE::Error::StrategyError
+				 * Malformed address or could not listen.
+				 */
+				Listener(
+				    const std::string &address);
+
+				/**
+				 * @brief
+				 * Block until a peer connects.
+				 *
+				 * @param[in] timeoutSeconds
+				 * Seconds to wait for a peer, or 0 to wait
+				 * indefinitely.
+				 *
+				 * @return
+				 * Connection to the peer.
+				 *
+				 * @throw BE::Error::FileError
+				 * Error accepting connection.
+				 * @throw BE::Error::StrategyError
+				 * No peer connected within `timeoutSeconds`.
+				 */
+				std::shared_ptr<Connection>
+				accept(
+				    const uint32_t timeoutSeconds = 0);
+
+				/** Destructor */
+				~Listener();
+
+				Listener(const Listener&) = delete;
+				Listener &operator=(const Listener&) = delete;
+			private:
+				/** Listening socket */
+				int _fd{-1};
+				/** Path to UNIX socket, removed on destruction */
+				std::string _unixPath{};
+			};
+		}
+	}
+}
+
+#endif /* N2NV_NETWORK_H_ */
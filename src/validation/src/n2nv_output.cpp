@@ -0,0 +1,395 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <utility>
+
+#ifdef N2NV_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <be_error.h>
+
+#include <n2nv_output.h>
+#include <n2nv_prefetch.h>
+
+/** @return Monotonic time, in microseconds */
+static uint64_t
+now()
+{
+	struct timespec ts{};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((static_cast<uint64_t>(ts.tv_sec) * 1000000) +
+	    (ts.tv_nsec / 1000));
+}
+
+/** Flags used to create output files */
+static const int OpenFlags{O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC};
+/** Permissions of output files, before umask */
+static const mode_t OpenMode{S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP |
+    S_IROTH | S_IWOTH};
+
+/**
+ * @brief
+ * Write a file with write(2).
+ *
+ * @param[in] path
+ * Path of file to create or replace.
+ * @param[in] data
+ * Contents of file.
+ *
+ * @return
+ * Reason the file could not be written, or empty on success.
+ */
+static std::string
+writeFile(
+    const std::string &path,
+    const BE::Memory::uint8Array &data)
+{
+	const int fd{open(path.c_str(), OpenFlags, OpenMode)};
+	if (fd == -1)
+		return ("Could not open " + path + " (" +
+		    BE::Error::errorStr() + ')');
+
+	uint64_t written{0};
+	while (written < data.size()) {
+		const ssize_t rv{::write(fd, data + written,
+		    data.size() - written)};
+		if ((rv == -1) && (errno == EINTR))
+			continue;
+		if (rv <= 0) {
+			const std::string error{"Could not write " + path +
+			    " (" + BE::Error::errorStr() + ')'};
+			close(fd);
+			return (error);
+		}
+		written += static_cast<uint64_t>(rv);
+	}
+
+	if (close(fd) != 0)
+		return ("Could not close " + path + " (" +
+		    BE::Error::errorStr() + ')');
+	return ("");
+}
+
+/******************************************************************************/
+
+struct N2N::Validation::OutputQueue::Ring
+{
+#ifdef N2NV_HAVE_LIBURING
+	/** Submission and completion queues */
+	struct io_uring ring{};
+#endif
+};
+
+N2N::Validation::OutputQueue::OutputQueue(
+    const uint64_t depth) :
+    _depth{depth}
+{
+	if (depth == 0)
+		throw BE::Error::StrategyError("Output queue depth can't be 0");
+
+#ifdef N2NV_HAVE_LIBURING
+	/* Kernels may be too old, or may forbid io_uring */
+	this->_ring.reset(new Ring{});
+	if (io_uring_queue_init(static_cast<unsigned>(depth),
+	    &this->_ring->ring, 0) == 0) {
+		this->_backend = Backend::IOUring;
+		this->_threads.push_back(Prefetch::startQuietThread(
+		    [this]() { this->runRing(); }));
+		return;
+	}
+	this->_ring.reset();
+#endif
+
+	for (uint64_t i{0}; i < depth; ++i)
+		this->_threads.push_back(Prefetch::startQuietThread(
+		    [this]() { this->runThread(); }));
+}
+
+void
+N2N::Validation::OutputQueue::write(
+    const std::string &path,
+    BE::Memory::uint8Array &&data)
+{
+	Request request{};
+	request.path = path;
+	request.data = std::move(data);
+	request.queued = now();
+
+	std::lock_guard<std::mutex> lock{this->_mutex};
+	request.sequence = this->_queued++;
+	this->_unwritten.insert(request.sequence);
+	this->_pending.push_back(std::move(request));
+	this->_changed.notify_all();
+}
+
+void
+N2N::Validation::OutputQueue::wait()
+{
+	this->wait(std::numeric_limits<uint64_t>::max());
+}
+
+void
+N2N::Validation::OutputQueue::wait(
+    const uint64_t queued)
+{
+	std::unique_lock<std::mutex> lock{this->_mutex};
+	this->_changed.wait(lock, [this, queued]() {
+		return (this->_unwritten.empty() ||
+		    (*this->_unwritten.begin() >= queued));
+	});
+
+	if (this->_error.empty())
+		return;
+	const std::string error{this->_error};
+	this->_error.clear();
+	throw BE::Error::StrategyError(error);
+}
+
+uint64_t
+N2N::Validation::OutputQueue::getQueued()
+    const
+{
+	std::lock_guard<std::mutex> lock{this->_mutex};
+	return (this->_queued);
+}
+
+void
+N2N::Validation::OutputQueue::sync(
+    const std::string &directory)
+{
+	const int fd{open(directory.c_str(), O_RDONLY | O_DIRECTORY)};
+	if (fd == -1)
+		throw BE::Error::StrategyError("Could not open " + directory +
+		    " (" + BE::Error::errorStr() + ')');
+
+#ifdef __linux__
+	/* Only the file system written to, not every mounted one */
+	const int rv{syncfs(fd)};
+#else
+	::sync();
+	const int rv{0};
+#endif
+	const std::string error{BE::Error::errorStr()};
+	close(fd);
+	if (rv != 0)
+		throw BE::Error::StrategyError("Could not sync " + directory +
+		    " (" + error + ')');
+}
+
+N2N::Validation::OutputQueue::Backend
+N2N::Validation::OutputQueue::getBackend()
+    const
+{
+	return (this->_backend);
+}
+
+N2N::Validation::LatencyHistogram
+N2N::Validation::OutputQueue::getQueuedLatency()
+    const
+{
+	std::lock_guard<std::mutex> lock{this->_mutex};
+	return (this->_queuedLatency);
+}
+
+void
+N2N::Validation::OutputQueue::finish(
+    const uint64_t sequence,
+    const std::string &error)
+{
+	if (!error.empty() && this->_error.empty())
+		this->_error = error;
+	this->_unwritten.erase(sequence);
+	this->_changed.notify_all();
+}
+
+void
+N2N::Validation::OutputQueue::runThread()
+{
+	std::unique_lock<std::mutex> lock{this->_mutex};
+	for (;;) {
+		this->_changed.wait(lock, [this]() {
+			return (this->_stopping || !this->_pending.empty());
+		});
+		if (this->_pending.empty())
+			return;
+
+		Request request{std::move(this->_pending.front())};
+		this->_pending.pop_front();
+		this->_queuedLatency.record(now() - request.queued);
+		lock.unlock();
+
+		const std::string error{writeFile(request.path,
+		    request.data)};
+
+		lock.lock();
+		this->finish(request.sequence, error);
+	}
+}
+
+void
+N2N::Validation::OutputQueue::runRing()
+{
+#ifdef N2NV_HAVE_LIBURING
+	/** File whose write is in the ring */
+	struct InFlight
+	{
+		/** File being written */
+		Request request;
+		/** Open descriptor of request.path */
+		int fd;
+		/** Bytes of request.data written */
+		uint64_t written;
+	};
+	struct io_uring &ring = this->_ring->ring;
+	const auto submitWrite = [&ring](InFlight &file) {
+		struct io_uring_sqe *sqe{io_uring_get_sqe(&ring)};
+		io_uring_prep_write(sqe, file.fd, file.request.data +
+		    file.written, static_cast<unsigned>(
+		    file.request.data.size() - file.written), file.written);
+		io_uring_sqe_set_data(sqe, &file);
+	};
+
+	std::list<InFlight> inFlight{};
+	std::vector<std::pair<uint64_t, std::string>> finished{};
+	for (;;) {
+		/* Report finished files and take as many as fit the ring */
+		std::deque<Request> batch{};
+		{
+			std::unique_lock<std::mutex> lock{this->_mutex};
+			for (const auto &file : finished)
+				this->finish(file.first, file.second);
+			finished.clear();
+
+			if (inFlight.empty())
+				this->_changed.wait(lock, [this]() {
+					return (this->_stopping ||
+					    !this->_pending.empty());
+				});
+			if (inFlight.empty() && this->_pending.empty())
+				return;
+
+			const uint64_t start{now()};
+			while (!this->_pending.empty() && ((inFlight.size() +
+			    batch.size()) < this->_depth)) {
+				this->_queuedLatency.record(start -
+				    this->_pending.front().queued);
+				batch.push_back(std::move(
+				    this->_pending.front()));
+				this->_pending.pop_front();
+			}
+		}
+
+		/* Every file in the batch is submitted with one syscall */
+		for (auto &request : batch) {
+			const int fd{open(request.path.c_str(), OpenFlags,
+			    OpenMode)};
+			if (fd == -1) {
+				finished.emplace_back(request.sequence,
+				    "Could not open " + request.path + " (" +
+				    BE::Error::errorStr() + ')');
+				continue;
+			}
+			if (request.data.size() == 0) {
+				close(fd);
+				finished.emplace_back(request.sequence, "");
+				continue;
+			}
+			inFlight.push_back({std::move(request), fd, 0});
+			submitWrite(inFlight.back());
+		}
+		if (!batch.empty())
+			io_uring_submit(&ring);
+		if (inFlight.empty())
+			continue;
+
+		struct io_uring_cqe *cqe{nullptr};
+		const int rv{io_uring_wait_cqe(&ring, &cqe)};
+		if (rv == -EINTR)
+			continue;
+		if (rv < 0) {
+			for (const auto &file : inFlight) {
+				close(file.fd);
+				finished.emplace_back(file.request.sequence,
+				    "Could not write " + file.request.path +
+				    " (" + std::strerror(-rv) + ')');
+			}
+			inFlight.clear();
+			continue;
+		}
+
+		/* Reap every completion available */
+		bool resubmit{false};
+		do {
+			InFlight *file{static_cast<InFlight *>(
+			    io_uring_cqe_get_data(cqe))};
+			const int res{cqe->res};
+			io_uring_cqe_seen(&ring, cqe);
+
+			std::string error{};
+			if (res < 0) {
+				error = "Could not write " +
+				    file->request.path + " (" +
+				    std::strerror(-res) + ')';
+			} else if (res == 0) {
+				error = "Could not write " +
+				    file->request.path + " (no progress)";
+			} else {
+				/* Short writes continue where they ended */
+				file->written += static_cast<uint64_t>(res);
+				if (file->written < file->request.data.size()) {
+					submitWrite(*file);
+					resubmit = true;
+					continue;
+				}
+			}
+
+			if ((close(file->fd) != 0) && error.empty())
+				error = "Could not close " +
+				    file->request.path + " (" +
+				    BE::Error::errorStr() + ')';
+			finished.emplace_back(file->request.sequence, error);
+			inFlight.remove_if([&](const InFlight &f) {
+				return (&f == file);
+			});
+		} while (io_uring_peek_cqe(&ring, &cqe) == 0);
+		if (resubmit)
+			io_uring_submit(&ring);
+	}
+#endif
+}
+
+N2N::Validation::OutputQueue::~OutputQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock{this->_mutex};
+		this->_stopping = true;
+		this->_changed.notify_all();
+	}
+	for (auto &thread : this->_threads)
+		thread.join();
+
+#ifdef N2NV_HAVE_LIBURING
+	if (this->_ring)
+		io_uring_queue_exit(&this->_ring->ring);
+#endif
+}
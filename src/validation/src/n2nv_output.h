@@ -0,0 +1,215 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_OUTPUT_H_
+#define N2NV_OUTPUT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <n2n.h>
+#include <n2nv_latency.h>
+
+namespace BE = BiometricEvaluation;
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Writer of stage one data that does not block searching.
+		 * @details
+		 * When built with liburing (N2NV_HAVE_LIBURING), files are
+		 * written through io_uring by one helper thread. Otherwise,
+		 * or when the kernel refuses io_uring, a pool of helper
+		 * threads writes files with write(2).
+		 */
+		class OutputQueue : public N2N::AsyncWriter
+		{
+		public:
+			/** Mechanism used to write files */
+			enum class Backend
+			{
+				/** Writes submitted to an io_uring */
+				IOUring,
+				/** write(2) from a pool of threads */
+				Threads
+			};
+
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param[in] depth
+			 * Maximum number of files written at once.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * depth is 0.
+			 */
+			explicit OutputQueue(
+			    const uint64_t depth);
+
+			void
+			write(
+			    const std::string &path,
+			    BE::Memory::uint8Array &&data)
+			    override;
+
+			/**
+			 * @brief
+			 * Wait for every queued file to be written.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * A file queued since the last call could not be
+			 * written.
+			 */
+			void
+			wait();
+
+			/**
+			 * @brief
+			 * Wait for the files queued before a point to be
+			 * written, leaving later files in flight.
+			 *
+			 * @param[in] queued
+			 * Value of getQueued() at that point.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * A file queued since the last call could not be
+			 * written.
+			 */
+			void
+			wait(
+			    const uint64_t queued);
+
+			/** @return Number of files ever queued */
+			uint64_t
+			getQueued()
+			    const;
+
+			/**
+			 * @brief
+			 * Make files written durable.
+			 *
+			 * @param[in] directory
+			 * Directory on the file system written to.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * File system could not be synchronized.
+			 *
+			 * @note
+			 * Call wait() first.
+			 */
+			void
+			sync(
+			    const std::string &directory);
+
+			/** @return Mechanism used to write files */
+			Backend
+			getBackend()
+			    const;
+
+			/**
+			 * @return
+			 * Microseconds each file waited before its write
+			 * started.
+			 */
+			LatencyHistogram
+			getQueuedLatency()
+			    const;
+
+			/** Destructor, waiting for queued files */
+			~OutputQueue();
+
+			OutputQueue(const OutputQueue&) = delete;
+			OutputQueue& operator=(const OutputQueue&) = delete;
+
+		private:
+			/** One file to write */
+			struct Request
+			{
+				/** Path of file */
+				std::string path{};
+				/** Contents of file */
+				BE::Memory::uint8Array data{};
+				/** Time write() was called */
+				uint64_t queued{};
+				/** Order in which write() was called */
+				uint64_t sequence{};
+			};
+
+			/** io_uring and files in flight, when used */
+			struct Ring;
+
+			/** Write files from the queue until destroyed */
+			void
+			runThread();
+
+			/** Submit files from the queue until destroyed */
+			void
+			runRing();
+
+			/**
+			 * @brief
+			 * Record a file whose write has finished.
+			 *
+			 * @param[in] sequence
+			 * Request::sequence of the file.
+			 * @param[in] error
+			 * Reason the file could not be written, or empty.
+			 *
+			 * @note
+			 * _mutex must be held.
+			 */
+			void
+			finish(
+			    const uint64_t sequence,
+			    const std::string &error);
+
+			/** Maximum number of files written at once */
+			const uint64_t _depth;
+			/** Mechanism used to write files */
+			Backend _backend{Backend::Threads};
+			/** State of the io_uring backend */
+			std::unique_ptr<Ring> _ring;
+
+			/** Protects all members below */
+			mutable std::mutex _mutex{};
+			/** Signaled when any member below changes */
+			std::condition_variable _changed{};
+			/** Files not yet started */
+			std::deque<Request> _pending{};
+			/** Number of files ever queued */
+			uint64_t _queued{0};
+			/** Sequences of files queued and not yet written */
+			std::set<uint64_t> _unwritten{};
+			/** First failure since the last wait() */
+			std::string _error{};
+			/** Time files waited before being started */
+			LatencyHistogram _queuedLatency{};
+			/** Whether helper threads should exit */
+			bool _stopping{false};
+
+			/** Helper threads */
+			std::vector<std::thread> _threads{};
+		};
+	}
+}
+
+#endif /* N2NV_OUTPUT_H_ */
@@ -0,0 +1,62 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include <n2nv_prefetch.h>
+
+std::thread
+N2N::Validation::Prefetch::startQuietThread(
+    const std::function<void()> &function)
+{
+	/* New threads inherit the signal mask of the creating thread */
+	sigset_t all{}, previous{};
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	std::thread thread{function};
+	pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+	return (thread);
+}
+
+uint64_t
+N2N::Validation::Prefetch::adviseDirectory(
+    const std::string &path)
+{
+	std::unique_ptr<DIR, int(*)(DIR*)> dir(::opendir(path.c_str()),
+	    closedir);
+	if (dir == nullptr)
+		return (0);
+
+	uint64_t advised{0};
+	struct dirent *entry;
+	while ((entry = readdir(dir.get())) != nullptr) {
+		const int fd{openat(dirfd(dir.get()), entry->d_name,
+		    O_RDONLY | O_NOFOLLOW)};
+		if (fd == -1)
+			continue;
+
+		struct stat sb{};
+		if ((fstat(fd, &sb) == 0) && S_ISREG(sb.st_mode) &&
+		    (posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0))
+			advised += sb.st_size;
+		close(fd);
+	}
+
+	return (advised);
+}
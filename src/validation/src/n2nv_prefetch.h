@@ -0,0 +1,242 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_PREFETCH_H_
+#define N2NV_PREFETCH_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/** Reading input ahead of the searches that need it */
+		namespace Prefetch
+		{
+			/**
+			 * @brief
+			 * Start a thread that receives no signals.
+			 * @details
+			 * Watchdogs interrupt API calls with signals, which
+			 * must be delivered to the thread making the call.
+			 *
+			 * @param[in] function
+			 * Function run by the thread.
+			 *
+			 * @return
+			 * Running thread.
+			 */
+			std::thread
+			startQuietThread(
+			    const std::function<void()> &function);
+
+			/**
+			 * @brief
+			 * Ask the kernel to read every file in a directory
+			 * into the page cache.
+			 * @details
+			 * Uses posix_fadvise(POSIX_FADV_WILLNEED), which starts
+			 * reading without waiting for it to finish.
+			 *
+			 * @param[in] path
+			 * Path to directory. Subdirectories are not read.
+			 *
+			 * @return
+			 * Bytes of files advised (0 if `path` cannot be
+			 * opened).
+			 */
+			uint64_t
+			adviseDirectory(
+			    const std::string &path);
+		}
+
+		/**
+		 * @brief
+		 * Bounded queue of work items fetched by a helper thread.
+		 * @details
+		 * Items are fetched in the order pushed, one at a time, so
+		 * whatever `fetch` reads is only used by the helper thread
+		 * while items are outstanding.
+		 */
+		template<typename T>
+		class Prefetcher
+		{
+		public:
+			/** Function that fetches one item */
+			using Fetch = std::function<T(uint64_t item)>;
+
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param[in] fetch
+			 * Function called on the helper thread for each
+			 * item pushed.
+			 */
+			Prefetcher(
+			    const Fetch &fetch) :
+			    _fetch{fetch}
+			{
+				this->_thread = Prefetch::startQuietThread(
+				    [this]() { this->run(); });
+			}
+
+			/**
+			 * @brief
+			 * Queue an item to be fetched.
+			 *
+			 * @param[in] item
+			 * Item to fetch.
+			 */
+			void
+			push(
+			    const uint64_t item)
+			{
+				std::lock_guard<std::mutex> lock{this->_mutex};
+				this->_pending.push_back(item);
+				this->_changed.notify_all();
+			}
+
+			/** @return Items pushed and not yet popped */
+			uint64_t
+			size()
+			    const
+			{
+				std::lock_guard<std::mutex> lock{this->_mutex};
+				return (this->_pending.size() +
+				    this->_fetched.size());
+			}
+
+			/**
+			 * @brief
+			 * Obtain the oldest item pushed, waiting for it to be
+			 * fetched.
+			 *
+			 * @param[out] value
+			 * Value returned from fetching the item.
+			 *
+			 * @return
+			 * Item.
+			 *
+			 * @throw
+			 * Exception thrown while fetching the item.
+			 *
+			 * @note
+			 * size() must not be 0.
+			 */
+			uint64_t
+			pop(
+			    T &value)
+			{
+				std::unique_lock<std::mutex> lock{this->_mutex};
+				this->_changed.wait(lock, [this]() {
+					return (!this->_fetched.empty());
+				});
+
+				Fetched fetched{std::move(
+				    this->_fetched.front())};
+				this->_fetched.pop_front();
+				lock.unlock();
+
+				if (fetched.error)
+					std::rethrow_exception(fetched.error);
+				value = std::move(fetched.value);
+				return (fetched.item);
+			}
+
+			/** Destructor, waiting for the current fetch */
+			~Prefetcher()
+			{
+				{
+					std::lock_guard<std::mutex> lock{
+					    this->_mutex};
+					this->_stopping = true;
+					this->_changed.notify_all();
+				}
+				this->_thread.join();
+			}
+
+			Prefetcher(const Prefetcher&) = delete;
+			Prefetcher& operator=(const Prefetcher&) = delete;
+
+		private:
+			/** Result of fetching one item */
+			struct Fetched
+			{
+				/** Item fetched */
+				uint64_t item{};
+				/** Value returned from fetching */
+				T value{};
+				/** Exception thrown from fetching */
+				std::exception_ptr error{};
+			};
+
+			/** Fetch pushed items until destroyed */
+			void
+			run()
+			{
+				std::unique_lock<std::mutex> lock{this->_mutex};
+				for (;;) {
+					this->_changed.wait(lock, [this]() {
+						return (this->_stopping ||
+						    !this->_pending.empty());
+					});
+					if (this->_stopping)
+						return;
+
+					Fetched fetched{};
+					fetched.item = this->_pending.front();
+					lock.unlock();
+					try {
+						fetched.value = this->_fetch(
+						    fetched.item);
+					} catch (...) {
+						fetched.error =
+						    std::current_exception();
+					}
+					lock.lock();
+
+					/* Fetched before pending, in order */
+					this->_pending.pop_front();
+					this->_fetched.push_back(
+					    std::move(fetched));
+					this->_changed.notify_all();
+				}
+			}
+
+			/** Function that fetches one item */
+			const Fetch _fetch;
+
+			/** Protects all members below */
+			mutable std::mutex _mutex{};
+			/** Signaled when any member below changes */
+			std::condition_variable _changed{};
+			/** Items pushed, not yet fetched */
+			std::deque<uint64_t> _pending{};
+			/** Items fetched, not yet popped */
+			std::deque<Fetched> _fetched{};
+			/** Whether the helper thread should exit */
+			bool _stopping{false};
+
+			/** Helper thread */
+			std::thread _thread{};
+		};
+	}
+}
+
+#endif /* N2NV_PREFETCH_H_ */
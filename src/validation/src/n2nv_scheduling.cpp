@@ -0,0 +1,327 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <sys/mman.h>
+
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <unordered_map>
+
+#include <be_error.h>
+#include <be_io_recordstore.h>
+
+#include <n2nv_scheduling.h>
+
+namespace BE = BiometricEvaluation;
+
+/** @return Monotonic time, in microseconds */
+static uint64_t
+now()
+{
+	struct timespec ts{};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((static_cast<uint64_t>(ts.tv_sec) * 1000000) +
+	    (ts.tv_nsec / 1000));
+}
+
+N2N::Validation::WorkQueue::WorkQueue(
+    const uint64_t count) :
+    _count{count}
+{
+	/* Lock-free atomics are address-free, so may be shared by processes */
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics must be "
+	    "lock-free");
+
+	this->_size = sizeof(std::atomic<uint64_t>) + (sizeof(Item) * count);
+	void *mapping = mmap(nullptr, this->_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		throw BE::Error::StrategyError("Could not map work queue (" +
+		    BE::Error::errorStr() + ')');
+
+	this->_next = new (mapping) std::atomic<uint64_t>{0};
+	this->_items = reinterpret_cast<Item *>(this->_next + 1);
+	for (uint64_t i{0}; i < count; ++i) {
+		Item *item = new (&this->_items[i]) Item;
+		item->start = 0;
+		item->attempts = 0;
+		item->complete = false;
+	}
+}
+
+uint64_t
+N2N::Validation::WorkQueue::getCount()
+    const
+{
+	return (this->_count);
+}
+
+uint64_t
+N2N::Validation::WorkQueue::claim()
+{
+	/* Cheap check keeps _next from growing without bound */
+	if (this->_next->load(std::memory_order_relaxed) >= this->_count)
+		return (None);
+
+	/* Not a straggler candidate until begin() */
+	const uint64_t item{this->_next->fetch_add(1)};
+	if (item >= this->_count)
+		return (None);
+	return (item);
+}
+
+void
+N2N::Validation::WorkQueue::begin(
+    const uint64_t item)
+{
+	/* Start is visible to claimStraggler() before the attempt is */
+	this->_items[item].start = now();
+	this->_items[item].attempts = 1;
+}
+
+uint64_t
+N2N::Validation::WorkQueue::claimStraggler(
+    const uint64_t minimumAge,
+    bool &exhausted)
+{
+	exhausted = true;
+
+	const uint64_t currentTime{now()};
+	for (uint64_t i{0}; i < this->_count; ++i) {
+		Item &item = this->_items[i];
+		if (item.complete)
+			continue;
+
+		uint8_t attempts{item.attempts};
+		/* Claimed, but first attempt not yet started */
+		if (attempts == 0) {
+			exhausted = false;
+			continue;
+		}
+		if (attempts > 1)
+			continue;
+
+		exhausted = false;
+		if ((currentTime - item.start) < minimumAge)
+			continue;
+		if (item.attempts.compare_exchange_strong(attempts, 2))
+			return (i);
+	}
+
+	return (None);
+}
+
+bool
+N2N::Validation::WorkQueue::complete(
+    const uint64_t item)
+{
+	bool expected{false};
+	return (this->_items[item].complete.compare_exchange_strong(expected,
+	    true));
+}
+
+N2N::Validation::WorkQueue::~WorkQueue()
+{
+	munmap(this->_next, this->_size);
+}
+
+/******************************************************************************/
+
+/** @return Bits of `value`, which fit in a lock-free atomic */
+static uint64_t
+toBits(
+    const double value)
+{
+	uint64_t bits{};
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits);
+}
+
+/** @return double whose bits are `bits` */
+static double
+fromBits(
+    const uint64_t bits)
+{
+	double value{};
+	std::memcpy(&value, &bits, sizeof(value));
+	return (value);
+}
+
+N2N::Validation::ThresholdTable::ThresholdTable(
+    const std::vector<std::string> &keys) :
+    _count{keys.size()}
+{
+	for (uint64_t i{0}; i < keys.size(); ++i)
+		this->_index.emplace(keys[i], i);
+
+	/* Same constraints as WorkQueue */
+	this->_size = std::max<size_t>(1, keys.size()) *
+	    sizeof(std::atomic<uint64_t>);
+	void *mapping = mmap(nullptr, this->_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		throw BE::Error::StrategyError("Could not map threshold table "
+		    "(" + BE::Error::errorStr() + ')');
+
+	this->_thresholds = reinterpret_cast<std::atomic<uint64_t> *>(
+	    mapping);
+	const uint64_t lowest{toBits(std::numeric_limits<double>::lowest())};
+	for (uint64_t i{0}; i < keys.size(); ++i)
+		new (&this->_thresholds[i]) std::atomic<uint64_t>{lowest};
+}
+
+double
+N2N::Validation::ThresholdTable::getThreshold(
+    const std::string &searchID)
+    const
+{
+	const auto it = this->_index.find(searchID);
+	if (it == this->_index.end())
+		return (std::numeric_limits<double>::lowest());
+
+	return (fromBits(this->_thresholds[it->second].load(
+	    std::memory_order_relaxed)));
+}
+
+void
+N2N::Validation::ThresholdTable::raiseThreshold(
+    const std::string &searchID,
+    const double similarity)
+{
+	const auto it = this->_index.find(searchID);
+	if ((it == this->_index.end()) || std::isnan(similarity))
+		return;
+
+	std::atomic<uint64_t> &threshold = this->_thresholds[it->second];
+	uint64_t current{threshold.load(std::memory_order_relaxed)};
+	while (fromBits(current) < similarity) {
+		if (threshold.compare_exchange_weak(current,
+		    toBits(similarity), std::memory_order_relaxed))
+			break;
+	}
+}
+
+uint64_t
+N2N::Validation::ThresholdTable::getRaisedCount()
+    const
+{
+	const double lowest{std::numeric_limits<double>::lowest()};
+
+	uint64_t count{0};
+	for (uint64_t i{0}; i < this->_count; ++i)
+		if (fromBits(this->_thresholds[i].load()) > lowest)
+			++count;
+	return (count);
+}
+
+N2N::Validation::ThresholdTable::~ThresholdTable()
+{
+	munmap(this->_thresholds, this->_size);
+}
+
+/******************************************************************************/
+
+uint64_t
+N2N::Validation::Scheduling::getTimeout(
+    const LatencyHistogram &latency,
+    const double multiplier,
+    const uint64_t maximum)
+{
+	if ((multiplier <= 0) || (latency.getCount() < MinimumObservations))
+		return (maximum);
+
+	const uint64_t timeout{static_cast<uint64_t>(multiplier *
+	    latency.getPercentile(99))};
+	return (std::min(maximum, std::max(MinimumTimeout, timeout)));
+}
+
+uint64_t
+N2N::Validation::Scheduling::getStragglerAge(
+    const LatencyHistogram &latency,
+    const double multiplier)
+{
+	if ((multiplier <= 0) || (latency.getCount() < MinimumObservations))
+		return (0);
+
+	return (std::max<uint64_t>(1, static_cast<uint64_t>(multiplier *
+	    latency.getPercentile(50))));
+}
+
+std::vector<std::string>
+N2N::Validation::Scheduling::readKeys(
+    const std::string &path)
+{
+	const auto rs = BE::IO::RecordStore::openRecordStore(path);
+
+	std::vector<std::string> keys{};
+	keys.reserve(rs->getCount());
+	for (;;) {
+		try {
+			keys.push_back(rs->sequenceKey());
+		} catch (BE::Error::ObjectDoesNotExist) {
+			break;
+		}
+	}
+
+	return (keys);
+}
+
+std::string
+N2N::Validation::Scheduling::getGroupID(
+    const std::string &key,
+    const std::string &delimiter)
+{
+	return (key.substr(0, key.find(delimiter)));
+}
+
+N2N::Validation::Scheduling::Groups
+N2N::Validation::Scheduling::groupKeys(
+    const std::vector<std::string> &keys,
+    const std::string &delimiter)
+{
+	Groups groups{};
+	if (delimiter.empty()) {
+		groups.reserve(keys.size());
+		for (uint64_t i{0}; i < keys.size(); ++i)
+			groups.push_back({i});
+		return (groups);
+	}
+
+	std::unordered_map<std::string, uint64_t> groupIndex{};
+	for (uint64_t i{0}; i < keys.size(); ++i) {
+		const auto inserted = groupIndex.emplace(getGroupID(keys[i],
+		    delimiter), groups.size());
+		if (inserted.second)
+			groups.emplace_back();
+		groups[inserted.first->second].push_back(i);
+	}
+
+	return (groups);
+}
+
+uint64_t
+N2N::Validation::Scheduling::getProcessorCount()
+{
+#ifdef __linux__
+	/* Affinity reflects taskset and cpuset limits */
+	cpu_set_t set{};
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		return (std::max(1, CPU_COUNT(&set)));
+#endif
+	return (std::max(1u, std::thread::hardware_concurrency()));
+}
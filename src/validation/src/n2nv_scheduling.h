@@ -0,0 +1,335 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_SCHEDULING_H_
+#define N2NV_SCHEDULING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <n2n.h>
+#include <n2nv_latency.h>
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Queue of searches shared by fork()ed workers.
+		 * @details
+		 * Constructed in the parent before forking. Items are
+		 * claimed in order by whichever worker is free, so one slow
+		 * search delays only itself. Once the queue is empty, idle
+		 * workers may claim a second attempt at a search that has
+		 * been running for too long. The first attempt to complete
+		 * an item wins.
+		 */
+		class WorkQueue
+		{
+		public:
+			/** Value returned when there is no item to claim */
+			static const uint64_t None{UINT64_MAX};
+
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param[in] count
+			 * Number of items, identified by [0, count).
+			 *
+			 * @throw BE::Error::StrategyError
+			 * Could not map shared memory.
+			 */
+			explicit WorkQueue(
+			    const uint64_t count);
+
+			/** @return Number of items */
+			uint64_t
+			getCount()
+			    const;
+
+			/**
+			 * @brief
+			 * Claim the next item never before claimed.
+			 * @details
+			 * The item is only reserved. Call begin() when its
+			 * first attempt starts.
+			 *
+			 * @return
+			 * Item, or None if all items have been claimed.
+			 */
+			uint64_t
+			claim();
+
+			/**
+			 * @brief
+			 * Record that the first attempt at an item has
+			 * started.
+			 * @details
+			 * Items claimed ahead of time would otherwise
+			 * appear to be straggling while waiting to start.
+			 *
+			 * @param[in] item
+			 * Item returned from claim().
+			 */
+			void
+			begin(
+			    const uint64_t item);
+
+			/**
+			 * @brief
+			 * Claim a second attempt at an incomplete item.
+			 *
+			 * @param[in] minimumAge
+			 * Microseconds the first attempt must have been
+			 * running.
+			 * @param[out] exhausted
+			 * Set to true when no item could ever be claimed,
+			 * because every item is complete or already has a
+			 * second attempt.
+			 *
+			 * @return
+			 * Item, or None if no item can be claimed now.
+			 */
+			uint64_t
+			claimStraggler(
+			    const uint64_t minimumAge,
+			    bool &exhausted);
+
+			/**
+			 * @brief
+			 * Mark an item complete.
+			 *
+			 * @param[in] item
+			 * Item returned from claim() or claimStraggler().
+			 *
+			 * @return
+			 * true if this attempt is the first to complete
+			 * `item`, false if its result should be discarded.
+			 */
+			bool
+			complete(
+			    const uint64_t item);
+
+			/** Destructor */
+			~WorkQueue();
+
+			WorkQueue(const WorkQueue&) = delete;
+			WorkQueue& operator=(const WorkQueue&) = delete;
+
+		private:
+			/** State of one item */
+			struct Item
+			{
+				/** Time the first attempt started */
+				std::atomic<uint64_t> start;
+				/** Attempts claimed */
+				std::atomic<uint8_t> attempts;
+				/** Whether an attempt has completed */
+				std::atomic<bool> complete;
+			};
+
+			/** Number of items */
+			const uint64_t _count;
+			/** Size of shared mapping */
+			size_t _size{};
+			/** Next item to claim(), in shared mapping */
+			std::atomic<uint64_t> *_next{};
+			/** Items, in shared mapping */
+			Item *_items{};
+		};
+
+		/**
+		 * @brief
+		 * Running similarity threshold of each search, shared by
+		 * fork()ed nodes.
+		 * @details
+		 * Constructed in the parent before forking, like WorkQueue.
+		 * Thresholds only ever increase.
+		 */
+		class ThresholdTable : public N2N::SearchThresholds
+		{
+		public:
+			/**
+			 * @brief
+			 * Constructor.
+			 *
+			 * @param[in] keys
+			 * Search IDs that may be given a threshold.
+			 *
+			 * @throw BE::Error::StrategyError
+			 * Could not map shared memory.
+			 */
+			explicit ThresholdTable(
+			    const std::vector<std::string> &keys);
+
+			double
+			getThreshold(
+			    const std::string &searchID)
+			    const
+			    override;
+
+			void
+			raiseThreshold(
+			    const std::string &searchID,
+			    const double similarity)
+			    override;
+
+			/** @return Number of searches given a threshold */
+			uint64_t
+			getRaisedCount()
+			    const;
+
+			/** Destructor */
+			~ThresholdTable();
+
+			ThresholdTable(const ThresholdTable&) = delete;
+			ThresholdTable& operator=(const ThresholdTable&) =
+			    delete;
+
+		private:
+			/** Number of thresholds */
+			const uint64_t _count;
+			/** Index of each search ID into _thresholds */
+			std::unordered_map<std::string, uint64_t> _index{};
+			/** Size of shared mapping */
+			size_t _size{};
+			/** Bits of each double threshold, in shared mapping */
+			std::atomic<uint64_t> *_thresholds{};
+		};
+
+		/** Scheduling searches across processes */
+		namespace Scheduling
+		{
+			/** Observations needed before adapting */
+			static const uint64_t MinimumObservations{32};
+			/** Shortest adaptive timeout, in microseconds */
+			static const uint64_t MinimumTimeout{1000000};
+
+			/**
+			 * @brief
+			 * Obtain a watchdog interval from observed latency.
+			 *
+			 * @param[in] latency
+			 * Latency of completed calls.
+			 * @param[in] multiplier
+			 * Multiple of the 99th percentile latency allowed,
+			 * or 0 to always use `maximum`.
+			 * @param[in] maximum
+			 * Longest timeout, used until enough calls complete.
+			 *
+			 * @return
+			 * Timeout, in microseconds, in
+			 * [MinimumTimeout, maximum].
+			 */
+			uint64_t
+			getTimeout(
+			    const LatencyHistogram &latency,
+			    const double multiplier,
+			    const uint64_t maximum);
+
+			/**
+			 * @brief
+			 * Obtain the age after which a search should be
+			 * attempted again.
+			 *
+			 * @param[in] latency
+			 * Latency of completed calls.
+			 * @param[in] multiplier
+			 * Multiple of the median latency allowed, or 0 to
+			 * disable speculation.
+			 *
+			 * @return
+			 * Age in microseconds, or 0 if speculation should
+			 * not happen (yet).
+			 */
+			uint64_t
+			getStragglerAge(
+			    const LatencyHistogram &latency,
+			    const double multiplier);
+
+			/** Polling interval when waiting for stragglers */
+			static const uint64_t PollMicroseconds{10000};
+
+			/**
+			 * @brief
+			 * Read every key of a RecordStore, so WorkQueue items
+			 * can be mapped to keys.
+			 *
+			 * @param[in] path
+			 * Path to RecordStore.
+			 *
+			 * @return
+			 * Keys in sequence order.
+			 *
+			 * @throw BE::Error::Exception
+			 * Could not open or read `path`.
+			 */
+			std::vector<std::string>
+			readKeys(
+			    const std::string &path);
+
+			/** Indices into keys of searches performed together */
+			using Groups = std::vector<std::vector<uint64_t>>;
+
+			/**
+			 * @brief
+			 * Obtain the group ID of a search.
+			 *
+			 * @param[in] key
+			 * Key of search template.
+			 * @param[in] delimiter
+			 * Text ending the group ID within `key`.
+			 *
+			 * @return
+			 * Text of `key` before the first `delimiter`, or all
+			 * of `key` if there is none.
+			 */
+			std::string
+			getGroupID(
+			    const std::string &key,
+			    const std::string &delimiter);
+
+			/**
+			 * @brief
+			 * Group searches sharing a group ID.
+			 *
+			 * @param[in] keys
+			 * Keys of all search templates.
+			 * @param[in] delimiter
+			 * Text ending the group ID within each key, or empty
+			 * to search each key on its own.
+			 *
+			 * @return
+			 * Groups in order of their first key. WorkQueue items
+			 * index this.
+			 */
+			Groups
+			groupKeys(
+			    const std::vector<std::string> &keys,
+			    const std::string &delimiter);
+
+			/**
+			 * @return
+			 * Number of processors this process may run on (at
+			 * least 1).
+			 */
+			uint64_t
+			getProcessorCount();
+		}
+	}
+}
+
+#endif /* N2NV_SCHEDULING_H_ */
@@ -0,0 +1,176 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <be_error.h>
+#include <be_text.h>
+
+#include <n2nv_trace.h>
+
+namespace BE = BiometricEvaluation;
+
+bool N2N::Validation::Trace::Enabled{false};
+
+/** One recorded span */
+struct Event
+{
+	/** Name of the span */
+	const char *name;
+	/** Start time, in nanoseconds */
+	uint64_t start;
+	/** Duration, in nanoseconds */
+	uint64_t duration;
+};
+
+/** Path of the merged trace */
+static std::string TracePath{};
+/** Ring buffer of this process' spans */
+static std::vector<Event> Events{};
+/** Number of spans recorded by this process (including overwritten) */
+static uint64_t EventCount{0};
+
+/** Suffix of per-process trace files */
+static const std::string ProcessFileSuffix{".trace"};
+
+/**
+ * @brief
+ * Write a time in nanoseconds as fractional microseconds.
+ *
+ * @param[in] stream
+ * Stream to write to.
+ * @param[in] nanoseconds
+ * Time to write.
+ */
+static void
+writeMicroseconds(
+    std::ostream &stream,
+    const uint64_t nanoseconds)
+{
+	stream << (nanoseconds / 1000) << '.' << std::setw(3) <<
+	    std::setfill('0') << (nanoseconds % 1000);
+}
+
+void
+N2N::Validation::Trace::record(
+    const char *name,
+    const uint64_t start,
+    const uint64_t end)
+    noexcept
+{
+	Events[EventCount++ & (Capacity - 1)] = {name, start, end - start};
+}
+
+void
+N2N::Validation::Trace::enable(
+    const std::string &path)
+{
+	TracePath = path;
+	Events.resize(Capacity);
+	EventCount = 0;
+	Enabled = true;
+}
+
+void
+N2N::Validation::Trace::beginProcess()
+{
+	EventCount = 0;
+}
+
+void
+N2N::Validation::Trace::flush()
+{
+	if (!Enabled || (EventCount == 0))
+		return;
+
+	const std::string path{TracePath + '.' + std::to_string(getpid()) +
+	    ProcessFileSuffix};
+	std::ofstream file{path, std::ios_base::out | std::ios_base::trunc};
+
+	const uint64_t first{EventCount > Capacity ? EventCount - Capacity : 0};
+	for (uint64_t i{first}; i < EventCount; ++i) {
+		const Event &event = Events[i & (Capacity - 1)];
+		file << event.start << ' ' << event.duration << ' ' <<
+		    event.name << '\n';
+	}
+	if (!file)
+		std::cout << "Could not write trace " << path << std::endl;
+	else if (first != 0)
+		std::cout << "Trace buffer full: " << first << " oldest spans "
+		    "from process " << getpid() << " not written" << std::endl;
+
+	EventCount = 0;
+}
+
+void
+N2N::Validation::Trace::merge()
+{
+	if (!Enabled)
+		return;
+	flush();
+
+	const std::string dir{BE::Text::dirname(TracePath)};
+	const std::string prefix{BE::Text::basename(TracePath) + '.'};
+	DIR *dirp = opendir(dir.c_str());
+	if (dirp == nullptr)
+		throw BE::Error::FileError("Could not open " + dir);
+	std::vector<std::string> names{};
+	for (struct dirent *entry = readdir(dirp); entry != nullptr;
+	    entry = readdir(dirp)) {
+		const std::string name{entry->d_name};
+		if ((name.size() > prefix.size() + ProcessFileSuffix.size()) &&
+		    (name.compare(0, prefix.size(), prefix) == 0) &&
+		    (name.compare(name.size() - ProcessFileSuffix.size(),
+		    ProcessFileSuffix.size(), ProcessFileSuffix) == 0))
+			names.push_back(name);
+	}
+	closedir(dirp);
+
+	std::ofstream json{TracePath, std::ios_base::out |
+	    std::ios_base::trunc};
+	if (!json)
+		throw BE::Error::FileError("Could not open " + TracePath);
+	json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool firstEvent{true};
+	for (const auto &name : names) {
+		const std::string pid{name.substr(prefix.size(), name.size() -
+		    prefix.size() - ProcessFileSuffix.size())};
+		const std::string path{dir + '/' + name};
+
+		std::ifstream file{path};
+		uint64_t start{}, duration{};
+		std::string spanName{};
+		while (file >> start >> duration >> spanName) {
+			json << (firstEvent ? "\n" : ",\n") << "{\"name\":\"" <<
+			    spanName << "\",\"cat\":\"n2nv\",\"ph\":\"X\","
+			    "\"pid\":" << pid << ",\"tid\":" << pid <<
+			    ",\"ts\":";
+			writeMicroseconds(json, start);
+			json << ",\"dur\":";
+			writeMicroseconds(json, duration);
+			json << '}';
+			firstEvent = false;
+		}
+		std::remove(path.c_str());
+	}
+	json << "\n]}\n";
+
+	if (!json)
+		throw BE::Error::FileError("Could not write " + TracePath);
+}
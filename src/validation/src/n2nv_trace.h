@@ -0,0 +1,171 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_TRACE_H_
+#define N2NV_TRACE_H_
+
+#include <time.h>
+
+#include <cstdint>
+#include <string>
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/**
+		 * @brief
+		 * Timing of the phases of each worker's loop.
+		 * @details
+		 * Each process records spans into its own fixed-size ring
+		 * buffer, without locks or allocation. Buffers are written
+		 * when processes finish and merged into a single Chrome
+		 * trace-event JSON file (viewable with chrome://tracing or
+		 * Perfetto). When tracing is not enabled, a Span costs one
+		 * branch.
+		 */
+		namespace Trace
+		{
+			/** Maximum spans retained per process */
+			static const uint64_t Capacity{UINT64_C(1) << 16};
+
+			/** Whether this process records spans */
+			extern bool Enabled;
+
+			/** @return Monotonic time, in nanoseconds */
+			inline uint64_t
+			now()
+			{
+				struct timespec ts{};
+				clock_gettime(CLOCK_MONOTONIC, &ts);
+				return ((static_cast<uint64_t>(ts.tv_sec) *
+				    UINT64_C(1000000000)) + ts.tv_nsec);
+			}
+
+			/**
+			 * @brief
+			 * Add a span to this process' ring buffer.
+			 * @details
+			 * The oldest span is overwritten when the buffer
+			 * is full.
+			 *
+			 * @param[in] name
+			 * Name of the span. Must be a string literal
+			 * without whitespace.
+			 * @param[in] start
+			 * Start time, from now().
+			 * @param[in] end
+			 * End time, from now().
+			 */
+			void
+			record(
+			    const char *name,
+			    const uint64_t start,
+			    const uint64_t end)
+			    noexcept;
+
+			/** Records its own lifetime as a span */
+			class Span
+			{
+			public:
+				/**
+				 * @brief
+				 * Constructor.
+				 *
+				 * @param[in] name
+				 * Name of the span. Must be a string literal
+				 * without whitespace.
+				 */
+				explicit Span(
+				    const char *name) :
+				    _name{Enabled ? name : nullptr},
+				    _start{Enabled ? now() : 0}
+				{
+
+				}
+
+				/** End the span before leaving scope */
+				void
+				end()
+				{
+					if (this->_name != nullptr) {
+						record(this->_name,
+						    this->_start, now());
+						this->_name = nullptr;
+					}
+				}
+
+				/** Destructor, ending the span */
+				~Span()
+				{
+					this->end();
+				}
+
+				Span(const Span&) = delete;
+				Span& operator=(const Span&) = delete;
+
+			private:
+				/** Name of the span, or nullptr if ended */
+				const char *_name;
+				/** Start time */
+				uint64_t _start;
+			};
+
+			/**
+			 * @brief
+			 * Start recording spans in this process and all
+			 * processes subsequently fork()ed from it.
+			 *
+			 * @param[in] path
+			 * Path of the merged JSON trace file. Per-process
+			 * files are written beside it.
+			 */
+			void
+			enable(
+			    const std::string &path);
+
+			/**
+			 * @brief
+			 * Discard spans inherited from a parent process.
+			 * @note
+			 * Call at the start of each Worker::workerMain().
+			 */
+			void
+			beginProcess();
+
+			/**
+			 * @brief
+			 * Write this process' spans so they may be merged.
+			 * @details
+			 * Does nothing when tracing is not enabled. Failure
+			 * is reported on stdout, but is not fatal.
+			 */
+			void
+			flush();
+
+			/**
+			 * @brief
+			 * Merge the files written by flush() from all
+			 * processes into a Chrome trace-event JSON file.
+			 * @details
+			 * Per-process files are removed once merged. Does
+			 * nothing when tracing is not enabled.
+			 *
+			 * @throw BE::Error::FileError
+			 * Could not write the JSON file.
+			 */
+			void
+			merge();
+		}
+	}
+}
+
+#endif /* N2NV_TRACE_H_ */
@@ -0,0 +1,82 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <n2nv_warmup.h>
+
+uint64_t
+N2N::Validation::Warmup::prefault()
+{
+	const uint64_t pageSize{static_cast<uint64_t>(sysconf(_SC_PAGESIZE))};
+	std::ifstream maps{"/proc/self/maps"};
+
+	uint64_t touched{0};
+	std::string line{};
+	while (std::getline(maps, line)) {
+		/* start-end perms offset dev inode [path] */
+		std::istringstream fields{line};
+		std::string range{}, perms{}, dev{}, path{};
+		uint64_t offset{}, inode{};
+		fields >> range >> perms >> std::hex >> offset >> dev >>
+		    std::dec >> inode;
+		std::getline(fields >> std::ws, path);
+		if (perms.empty() || (perms[0] != 'r'))
+			continue;
+
+		const auto dash = range.find('-');
+		if (dash == std::string::npos)
+			continue;
+		const uint64_t start{std::stoull(range.substr(0, dash),
+		    nullptr, 16)};
+		uint64_t end{std::stoull(range.substr(dash + 1), nullptr, 16)};
+
+		if (inode != 0) {
+			/* Reading past the end of a file raises SIGBUS */
+			struct stat sb{};
+			if ((stat(path.c_str(), &sb) != 0) ||
+			    !S_ISREG(sb.st_mode))
+				continue;
+			if (static_cast<uint64_t>(sb.st_size) <= offset)
+				continue;
+			end = std::min(end, start +
+			    (static_cast<uint64_t>(sb.st_size) - offset));
+			madvise(reinterpret_cast<void *>(start), end - start,
+			    MADV_WILLNEED);
+		} else if (!path.empty() && (path != "[heap]") &&
+		    (path.compare(0, 6, "[stack") != 0)) {
+			/* Kernel pseudo-mappings (e.g., [vvar]) */
+			continue;
+		}
+
+		for (uint64_t page{start}; page < end; page += pageSize) {
+			static_cast<void>(*reinterpret_cast<volatile const
+			    uint8_t *>(page));
+			touched += pageSize;
+		}
+	}
+
+	return (touched);
+}
+
+std::string
+N2N::Validation::Warmup::getFirstCallName(
+    const std::string &method)
+{
+	return (method + ".firstCall");
+}
@@ -0,0 +1,59 @@
+/*
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) and the Intelligence Advanced Research Projects Activity
+ * (IARPA) by employees of the Federal Government in the course of their
+ * official duties. Pursuant to title 17 Section 105 of the United States Code,
+ * this software is not subject to copyright protection and is in the public
+ * domain. NIST and IARPA assume no responsibility whatsoever for its use by
+ * other parties, and makes no guarantees, expressed or implied, about its
+ * quality, reliability, or any other characteristic.
+ */
+
+#ifndef N2NV_WARMUP_H_
+#define N2NV_WARMUP_H_
+
+#include <cstdint>
+#include <string>
+
+namespace N2N
+{
+	namespace Validation
+	{
+		/** Preparing fork()ed processes before timed calls */
+		namespace Warmup
+		{
+			/**
+			 * @brief
+			 * Fault in every readable page mapped by this process.
+			 * @details
+			 * Pages are only read, so copy-on-write pages inherited
+			 * from the parent stay shared. Pages of memory-mapped
+			 * files are read ahead first. Pages past the end of a
+			 * mapped file are not touched.
+			 *
+			 * @return
+			 * Number of bytes touched.
+			 */
+			uint64_t
+			prefault();
+
+			/**
+			 * @brief
+			 * Obtain the name under which the first call of a
+			 * method is recorded.
+			 *
+			 * @param[in] method
+			 * Name of the method.
+			 *
+			 * @return
+			 * `method` suffixed to distinguish first calls from
+			 * steady state.
+			 */
+			std::string
+			getFirstCallName(
+			    const std::string &method);
+		}
+	}
+}
+
+#endif /* N2NV_WARMUP_H_ */